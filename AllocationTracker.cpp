@@ -0,0 +1,233 @@
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CALLER_ADDRESS() _ReturnAddress()
+#else
+#define CALLER_ADDRESS() __builtin_return_address(0)
+#endif
+
+// Open addressing table of call sites. Fixed size so recording never allocates; sites past capacity are dropped.
+static const size_t CALL_SITE_CAPACITY = 1024;
+
+struct CallSiteEntry {
+	std::atomic<uintptr_t> address{ 0 };
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> bytes{ 0 };
+};
+
+static CallSiteEntry callSites[CALL_SITE_CAPACITY];
+static std::atomic<bool> callSiteTracking{ false };
+static std::atomic<uint64_t> totalAllocations{ 0 };
+static std::atomic<uint64_t> totalBytes{ 0 };
+static std::atomic<uint64_t> totalFrees{ 0 };
+static std::atomic<uint64_t> frameStartAllocations{ 0 };
+static std::atomic<uint64_t> frameStartBytes{ 0 };
+
+void AllocationTracker::recordAllocation(size_t size, const void* callSite) {
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+	if (!callSiteTracking.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	const uintptr_t address = reinterpret_cast<uintptr_t>(callSite);
+	size_t slot = (address >> 4) % CALL_SITE_CAPACITY;
+	for (size_t probe = 0; probe < CALL_SITE_CAPACITY; probe++) {
+		CallSiteEntry& entry = callSites[(slot + probe) % CALL_SITE_CAPACITY];
+		uintptr_t existing = entry.address.load(std::memory_order_relaxed);
+		if (existing == 0 && entry.address.compare_exchange_strong(existing, address, std::memory_order_relaxed)) {
+			existing = address;
+		}
+		if (existing == address) {
+			entry.count.fetch_add(1, std::memory_order_relaxed);
+			entry.bytes.fetch_add(size, std::memory_order_relaxed);
+			return;
+		}
+	}
+}
+
+void AllocationTracker::recordFree() {
+	totalFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocationTracker::setCallSiteTracking(bool enabled) {
+	callSiteTracking.store(enabled, std::memory_order_relaxed);
+}
+
+void AllocationTracker::resetCallSites() {
+	for (CallSiteEntry& entry : callSites) {
+		entry.address.store(0, std::memory_order_relaxed);
+		entry.count.store(0, std::memory_order_relaxed);
+		entry.bytes.store(0, std::memory_order_relaxed);
+	}
+}
+
+void AllocationTracker::beginFrame() {
+	frameStartAllocations.store(totalAllocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	frameStartBytes.store(totalBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::getFrameAllocationCount() {
+	return totalAllocations.load(std::memory_order_relaxed) - frameStartAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::getFrameAllocatedBytes() {
+	return totalBytes.load(std::memory_order_relaxed) - frameStartBytes.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::getTotalAllocationCount() {
+	return totalAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::getTotalFreeCount() {
+	return totalFrees.load(std::memory_order_relaxed);
+}
+
+size_t AllocationTracker::getTopCallSites(CallSite* out, size_t maxCount) {
+	size_t found = 0;
+	for (const CallSiteEntry& entry : callSites) {
+		uintptr_t address = entry.address.load(std::memory_order_relaxed);
+		if (address == 0) {
+			continue;
+		}
+		CallSite site = { reinterpret_cast<const void*>(address), entry.count.load(std::memory_order_relaxed), entry.bytes.load(std::memory_order_relaxed) };
+		// Insertion into a small sorted array, keeps this free of allocations as well
+		size_t position = std::min(found, maxCount);
+		while (position > 0 && out[position - 1].count < site.count) {
+			if (position < maxCount) {
+				out[position] = out[position - 1];
+			}
+			position--;
+		}
+		if (position < maxCount) {
+			out[position] = site;
+			found = std::min(found + 1, maxCount);
+		}
+	}
+	return found;
+}
+
+void AllocationTracker::printCallSites(std::ostream& out, size_t maxCount) {
+	CallSite sites[16];
+	size_t count = getTopCallSites(sites, std::min(maxCount, size_t(16)));
+	for (size_t i = 0; i < count; i++) {
+		out << "  " << sites[i].address << ": " << sites[i].count << " allocations, " << sites[i].bytes << " bytes" << std::endl;
+	}
+}
+
+// Replacements for the global allocation functions. Each one captures its own return address, which is the call site.
+
+static void* allocateOrThrow(size_t size) {
+	void* memory = malloc(size != 0 ? size : 1);
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+static void* allocateAligned(size_t size, std::align_val_t alignment) {
+	size_t align = static_cast<size_t>(alignment);
+#ifdef _WIN32
+	void* memory = _aligned_malloc(size != 0 ? size : 1, align);
+#else
+	void* memory = aligned_alloc(align, (std::max(size, size_t(1)) + align - 1) / align * align);
+#endif
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+static void freeAligned(void* memory) {
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+void* operator new(size_t size) {
+	AllocationTracker::recordAllocation(size, CALLER_ADDRESS());
+	return allocateOrThrow(size);
+}
+
+void* operator new[](size_t size) {
+	AllocationTracker::recordAllocation(size, CALLER_ADDRESS());
+	return allocateOrThrow(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	AllocationTracker::recordAllocation(size, CALLER_ADDRESS());
+	return malloc(size != 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	AllocationTracker::recordAllocation(size, CALLER_ADDRESS());
+	return malloc(size != 0 ? size : 1);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	AllocationTracker::recordAllocation(size, CALLER_ADDRESS());
+	return allocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	AllocationTracker::recordAllocation(size, CALLER_ADDRESS());
+	return allocateAligned(size, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+	if (memory != nullptr) {
+		AllocationTracker::recordFree();
+		free(memory);
+	}
+}
+
+void operator delete[](void* memory) noexcept {
+	operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+	operator delete(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+	operator delete(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+	if (memory != nullptr) {
+		AllocationTracker::recordFree();
+		freeAligned(memory);
+	}
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept {
+	operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept {
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept {
+	operator delete(memory, alignment);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Counts every heap allocation made through the global operator new / delete, which AllocationTracker.cpp replaces.
+// Totals are always kept. While call site tracking is on, allocations are also bucketed by the address that called
+// operator new, so a steady state allocation can be traced back to its source with the debugger or the .pdb.
+// Memory taken with malloc directly (GLFW, the Vulkan loader, VulkanHostAllocator's backing blocks) is not seen.
+class AllocationTracker {
+public:
+	struct CallSite {
+		const void* address;
+		uint64_t count;
+		uint64_t bytes;
+	};
+
+	// Called by the replaced operator new / delete. Must not allocate.
+	static void recordAllocation(size_t size, const void* callSite);
+	static void recordFree();
+
+	static void setCallSiteTracking(bool enabled);
+	static void resetCallSites();
+
+	// Start a new frame, the frame counters restart from zero
+	static void beginFrame();
+	static uint64_t getFrameAllocationCount();
+	static uint64_t getFrameAllocatedBytes();
+
+	static uint64_t getTotalAllocationCount();
+	static uint64_t getTotalFreeCount();
+
+	// Call sites recorded since the last resetCallSites, most frequent first. Returns how many were written.
+	static size_t getTopCallSites(CallSite* out, size_t maxCount);
+	static void printCallSites(std::ostream& out, size_t maxCount);
+};
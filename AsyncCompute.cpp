@@ -0,0 +1,103 @@
+#include "AsyncCompute.h"
+
+#include <stdexcept>
+
+void AsyncComputeQueue::create(VkDevice device, const DeviceDispatch& dispatch, VkQueue queue, uint32_t computeFamily, uint32_t graphicsFamily, uint32_t frameCount, const VkAllocationCallbacks* pAllocator) {
+	this->dispatch = &dispatch;
+	this->queue = queue;
+	queueFamilies[0] = graphicsFamily;
+	queueFamilies[1] = computeFamily;
+	pendingSemaphore = VK_NULL_HANDLE;
+	if (!isAsync()) {
+		return;
+	}
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = computeFamily;
+	if (vkCreateCommandPool(device, &poolInfo, pAllocator, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create async compute command pool!");
+	}
+	commandBuffers.resize(frameCount);
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = frameCount;
+	if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate async compute command buffers!");
+	}
+	semaphores.resize(frameCount);
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	for (VkSemaphore& semaphore : semaphores) {
+		if (vkCreateSemaphore(device, &semaphoreInfo, pAllocator, &semaphore) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create async compute semaphore!");
+		}
+	}
+}
+
+void AsyncComputeQueue::destroy(VkDevice device, const VkAllocationCallbacks* pAllocator) {
+	for (VkSemaphore semaphore : semaphores) {
+		vkDestroySemaphore(device, semaphore, pAllocator);
+	}
+	semaphores.clear();
+	if (commandPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(device, commandPool, pAllocator);
+		commandPool = VK_NULL_HANDLE;
+	}
+	commandBuffers.clear();
+	queue = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer AsyncComputeQueue::begin(uint32_t frameIndex, VkCommandBuffer graphicsCommandBuffer) {
+	if (!isAsync()) {
+		return graphicsCommandBuffer;
+	}
+	VkCommandBuffer commandBuffer = commandBuffers[frameIndex];
+	dispatch->vkResetCommandBuffer(commandBuffer, 0);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (dispatch->vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording async compute command buffer!");
+	}
+	return commandBuffer;
+}
+
+void AsyncComputeQueue::end(uint32_t frameIndex, VkCommandBuffer commandBuffer, VkPipelineStageFlags consumerStages, VkAccessFlags consumerAccess) {
+	if (!isAsync()) {
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = consumerAccess;
+		dispatch->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, consumerStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		return;
+	}
+	if (dispatch->vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record async compute command buffer!");
+	}
+	// The semaphore signal makes every write visible to the waiting submission, no barrier needed
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &semaphores[frameIndex];
+	if (dispatch->vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit async compute work!");
+	}
+	pendingSemaphore = semaphores[frameIndex];
+	pendingStages = consumerStages;
+}
+
+bool AsyncComputeQueue::takeWait(VkSemaphore& semaphore, VkPipelineStageFlags& stages) {
+	if (pendingSemaphore == VK_NULL_HANDLE) {
+		return false;
+	}
+	semaphore = pendingSemaphore;
+	stages = pendingStages;
+	pendingSemaphore = VK_NULL_HANDLE;
+	return true;
+}
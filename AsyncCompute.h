@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanDispatch.h"
+
+#include <cstdint>
+#include <vector>
+
+// Compute work independent of the frame's rasterization, run on a compute-only queue family so it fills the graphics
+// queue's bubbles (vertex bound and fixed function stretches leave the shader cores idle).
+// A frame's compute work is recorded between begin() and end(), and submitted ahead of the frame's graphics work,
+// which waits on its semaphore only at the stages that consume the results. Without a dedicated family, or with
+// asyncCompute=off, begin() returns the graphics command buffer and end() records a barrier instead, so callers record
+// the work the same way either way.
+//
+// Buffers written on one queue and read on the other use concurrent sharing between getQueueFamilies(), which avoids
+// queue family ownership transfers. Each frame in flight has its own command buffer and semaphore; reusing them is
+// safe once the frame's fence has signalled, as the graphics submission that waited on the semaphore has completed.
+class AsyncComputeQueue {
+public:
+	// queue may be VK_NULL_HANDLE, and then the compute work is recorded on the graphics queue
+	void create(VkDevice device, const DeviceDispatch& dispatch, VkQueue queue, uint32_t computeFamily, uint32_t graphicsFamily, uint32_t frameCount, const VkAllocationCallbacks* pAllocator);
+	void destroy(VkDevice device, const VkAllocationCallbacks* pAllocator);
+	bool isAsync() const { return queue != VK_NULL_HANDLE; }
+
+	// The families that access buffers shared between compute and graphics work, one when they are the same
+	const uint32_t* getQueueFamilies() const { return queueFamilies; }
+	uint32_t getQueueFamilyCount() const { return isAsync() ? 2 : 1; }
+
+	// Start frameIndex's compute work: its own command buffer, or graphicsCommandBuffer when not async
+	VkCommandBuffer begin(uint32_t frameIndex, VkCommandBuffer graphicsCommandBuffer);
+	// Submit the work, or make it visible to later graphics work, at consumerStages with consumerAccess
+	void end(uint32_t frameIndex, VkCommandBuffer commandBuffer, VkPipelineStageFlags consumerStages, VkAccessFlags consumerAccess);
+	// The semaphore the frame's graphics submission must wait on, if compute work was submitted this frame.
+	// Clears the pending submission.
+	bool takeWait(VkSemaphore& semaphore, VkPipelineStageFlags& stages);
+
+private:
+	const DeviceDispatch* dispatch = nullptr;
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t queueFamilies[2] = {};
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> commandBuffers;
+	std::vector<VkSemaphore> semaphores;
+
+	// Set by end() until the graphics submission takes it
+	VkSemaphore pendingSemaphore = VK_NULL_HANDLE;
+	VkPipelineStageFlags pendingStages = 0;
+};
@@ -0,0 +1,228 @@
+#include "BenchmarkSweep.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+	std::vector<std::string> splitValues(const std::string& text) {
+		std::vector<std::string> values;
+		size_t start = 0;
+		for (;;) {
+			size_t comma = text.find(',', start);
+			std::string value = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+			value.erase(0, value.find_first_not_of(" \t"));
+			value.erase(value.find_last_not_of(" \t") + 1);
+			if (!value.empty()) {
+				values.push_back(value);
+			}
+			if (comma == std::string::npos) {
+				return values;
+			}
+			start = comma + 1;
+		}
+	}
+
+	// gpu_profile.json becomes gpu_profile_run3.json for run 3
+	std::string numberPath(const std::string& path, size_t run) {
+		size_t dot = path.find_last_of('.');
+		size_t slash = path.find_last_of("/\\");
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+			dot = path.size();
+		}
+		return path.substr(0, dot) + "_run" + std::to_string(run) + path.substr(dot);
+	}
+
+	// Nearest rank percentile of sorted values
+	double percentile(const std::vector<double>& sorted, double fraction) {
+		size_t rank = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+		return sorted[std::min(rank, sorted.size() - 1)];
+	}
+}
+
+void printRunSummary(const RunSummary& summary, std::ostream& out) {
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+	out << summary.frames << " frames after warmup: cpu " << summary.cpuMilliseconds << " ms, gpu " << summary.gpuMilliseconds
+		<< " ms, frame p50 " << summary.medianFrameMilliseconds << " ms, p99 " << summary.p99FrameMilliseconds << " ms, "
+		<< summary.framesPerSecond << " fps" << std::endl;
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void FrameSampler::reset(uint32_t capacity) {
+	samples.clear();
+	samples.reserve(capacity);
+}
+
+void FrameSampler::add(double frameMilliseconds, double cpuMilliseconds, double gpuMilliseconds) {
+	if (samples.size() < samples.capacity()) {
+		samples.push_back({ frameMilliseconds, cpuMilliseconds, gpuMilliseconds });
+	}
+}
+
+RunSummary FrameSampler::summarize() const {
+	RunSummary summary;
+	summary.completed = true;
+	summary.frames = static_cast<uint32_t>(samples.size());
+	if (samples.empty()) {
+		return summary;
+	}
+	std::vector<double> frameTimes;
+	frameTimes.reserve(samples.size());
+	double frameTotal = 0.0;
+	for (const Sample& sample : samples) {
+		frameTimes.push_back(sample.frameMilliseconds);
+		frameTotal += sample.frameMilliseconds;
+		summary.cpuMilliseconds += sample.cpuMilliseconds;
+		summary.gpuMilliseconds += sample.gpuMilliseconds;
+	}
+	summary.cpuMilliseconds /= static_cast<double>(samples.size());
+	summary.gpuMilliseconds /= static_cast<double>(samples.size());
+	std::sort(frameTimes.begin(), frameTimes.end());
+	summary.medianFrameMilliseconds = percentile(frameTimes, 0.5);
+	summary.p99FrameMilliseconds = percentile(frameTimes, 0.99);
+	summary.framesPerSecond = frameTotal > 0.0 ? 1000.0 * static_cast<double>(samples.size()) / frameTotal : 0.0;
+	return summary;
+}
+
+void BenchmarkSweep::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open sweep " + path + "!");
+	}
+	axes.clear();
+	rows.clear();
+	// Every value is applied to a scratch configuration, so a typo fails now rather than hours into the sweep
+	RuntimeConfig scratch;
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r") == std::string::npos) {
+			continue;
+		}
+		Axis axis;
+		std::string values;
+		if (!splitSetting(line, axis.key, values)) {
+			throw std::runtime_error("Expected key = values on line " + std::to_string(lineNumber) + " of " + path + "!");
+		}
+		axis.values = splitValues(values);
+		if (axis.values.empty()) {
+			throw std::runtime_error("No values for " + axis.key + " in " + path + "!");
+		}
+		for (const std::string& value : axis.values) {
+			scratch.set(axis.key, value);
+		}
+		axes.push_back(axis);
+	}
+}
+
+size_t BenchmarkSweep::getRunCount() const {
+	size_t count = 1;
+	for (const Axis& axis : axes) {
+		count *= axis.values.size();
+	}
+	return count;
+}
+
+void BenchmarkSweep::run(const RuntimeConfig& base, const std::string& profileBasePath, const std::function<RunSummary(const RuntimeConfig&, const std::string&)>& runOne) {
+	rows.clear();
+	size_t runCount = getRunCount();
+	// One index per axis, counted like the digits of a number with the last axis changing fastest
+	std::vector<size_t> indices(axes.size(), 0);
+	for (size_t run = 0; run < runCount; run++) {
+		Row row;
+		RuntimeConfig config = base;
+		if (config.frames == 0) {
+			config.frames = DEFAULT_FRAMES;
+		}
+		std::cout << "Sweep run " << run + 1 << "/" << runCount << ":";
+		for (size_t i = 0; i < axes.size(); i++) {
+			const std::string& value = axes[i].values[indices[i]];
+			config.set(axes[i].key, value);
+			row.values.push_back(value);
+			std::cout << " " << axes[i].key << "=" << value;
+		}
+		std::cout << std::endl;
+		row.profilePath = numberPath(profileBasePath, run + 1);
+		try {
+			row.summary = runOne(config, row.profilePath);
+		}
+		catch (const std::exception& e) {
+			row.summary = RunSummary{};
+			row.summary.error = e.what();
+			std::cerr << "Sweep run " << run + 1 << " failed: " << e.what() << std::endl;
+		}
+		rows.push_back(row);
+
+		for (size_t i = axes.size(); i-- > 0;) {
+			if (++indices[i] < axes[i].values.size()) {
+				break;
+			}
+			indices[i] = 0;
+		}
+	}
+}
+
+void BenchmarkSweep::print(std::ostream& out) const {
+	if (rows.empty()) {
+		return;
+	}
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+	// Each setting column is as wide as its key or its longest value
+	std::vector<size_t> widths;
+	for (const Axis& axis : axes) {
+		size_t width = axis.key.size();
+		for (const std::string& value : axis.values) {
+			width = std::max(width, value.size());
+		}
+		widths.push_back(width + 2);
+	}
+	out << "Benchmark sweep, " << rows.size() << " runs:" << std::endl << " ";
+	for (size_t i = 0; i < axes.size(); i++) {
+		out << std::setw(static_cast<int>(widths[i])) << axes[i].key;
+	}
+	out << "    frames    cpu ms    gpu ms    p50 ms    p99 ms       fps" << std::endl;
+	for (const Row& row : rows) {
+		out << " ";
+		for (size_t i = 0; i < row.values.size(); i++) {
+			out << std::setw(static_cast<int>(widths[i])) << row.values[i];
+		}
+		const RunSummary& summary = row.summary;
+		if (!summary.completed) {
+			out << "  failed: " << summary.error << std::endl;
+			continue;
+		}
+		out << std::setw(10) << summary.frames << std::setw(10) << summary.cpuMilliseconds << std::setw(10) << summary.gpuMilliseconds
+			<< std::setw(10) << summary.medianFrameMilliseconds << std::setw(10) << summary.p99FrameMilliseconds
+			<< std::setw(10) << summary.framesPerSecond << std::endl;
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void BenchmarkSweep::writeCsv(const std::string& path) const {
+	if (rows.empty()) {
+		return;
+	}
+	std::ofstream file(path, std::ios::trunc);
+	for (const Axis& axis : axes) {
+		file << axis.key << ",";
+	}
+	file << "completed,frames,cpuMs,gpuMs,p50FrameMs,p99FrameMs,fps,profile\n";
+	for (const Row& row : rows) {
+		for (const std::string& value : row.values) {
+			file << value << ",";
+		}
+		const RunSummary& summary = row.summary;
+		file << (summary.completed ? 1 : 0) << "," << summary.frames << "," << summary.cpuMilliseconds << "," << summary.gpuMilliseconds << ","
+			<< summary.medianFrameMilliseconds << "," << summary.p99FrameMilliseconds << "," << summary.framesPerSecond << "," << row.profilePath << "\n";
+	}
+}
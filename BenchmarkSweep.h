@@ -0,0 +1,83 @@
+#pragma once
+
+#include "RuntimeConfig.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// What one benchmark run measured, over the frames after its warmup
+struct RunSummary {
+	bool completed = false;
+	// Why the run failed, when it didn't complete
+	std::string error;
+	uint32_t frames = 0;
+	double cpuMilliseconds = 0.0;
+	double gpuMilliseconds = 0.0;
+	// Frame to frame time, which includes waiting on the GPU and presentation
+	double medianFrameMilliseconds = 0.0;
+	double p99FrameMilliseconds = 0.0;
+	double framesPerSecond = 0.0;
+};
+
+void printRunSummary(const RunSummary& summary, std::ostream& out);
+
+// Per-frame times for a RunSummary, kept in storage reserved before the frame loop so sampling never allocates.
+// Frames beyond the capacity are dropped.
+class FrameSampler {
+public:
+	void reset(uint32_t capacity);
+	void add(double frameMilliseconds, double cpuMilliseconds, double gpuMilliseconds);
+	RunSummary summarize() const;
+
+private:
+	struct Sample {
+		double frameMilliseconds;
+		double cpuMilliseconds;
+		double gpuMilliseconds;
+	};
+
+	std::vector<Sample> samples;
+};
+
+// Benchmark sweep over the runtime configuration (--sweep <file>).
+// The file lists values per setting, "key = value1, value2, ..." with any RuntimeConfig key, # starting a comment;
+// every combination of the values is run in turn on top of the base configuration. A run that fails is recorded
+// with its error and the sweep moves on, so one unsupported combination doesn't lose the rest.
+// Results are printed as a table and written as CSV, one row per combination. The CSV holds whole-frame times; each
+// run's per-pass GPU timings and pipeline statistics go to a profile of its own, named in the row's profile column.
+class BenchmarkSweep {
+public:
+	// Frames per run when the base configuration doesn't set them
+	static constexpr uint32_t DEFAULT_FRAMES = 600;
+
+	// Throws if a key or value is invalid, before anything has run
+	void load(const std::string& path);
+	// Number of combinations
+	size_t getRunCount() const;
+
+	// Run every combination, runOne renders with a configuration and reports what it measured. It writes the run's GPU
+	// profile to the path it is given: profileBasePath with the run's number before the extension.
+	void run(const RuntimeConfig& base, const std::string& profileBasePath, const std::function<RunSummary(const RuntimeConfig&, const std::string&)>& runOne);
+
+	void print(std::ostream& out) const;
+	void writeCsv(const std::string& path) const;
+
+private:
+	struct Axis {
+		std::string key;
+		std::vector<std::string> values;
+	};
+
+	struct Row {
+		// One value per axis
+		std::vector<std::string> values;
+		std::string profilePath;
+		RunSummary summary;
+	};
+
+	std::vector<Axis> axes;
+	std::vector<Row> rows;
+};
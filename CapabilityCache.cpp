@@ -0,0 +1,359 @@
+#include "CapabilityCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+static const char* CACHE_MAGIC = "VulkanCapabilityCache";
+static const uint32_t CACHE_FORMAT_VERSION = 2;
+
+// Formats whose support the renderer depends on, probed once per device
+static const VkFormat probedFormats[] = {
+	VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_B8G8R8A8_SRGB,
+	VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R32_SFLOAT,
+	VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT,
+};
+
+// Plain structs are stored as hex so the file stays line based. A size mismatch (different SDK headers) invalidates the cache.
+template<typename T>
+static std::string toHex(const T& value) {
+	std::ostringstream out;
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+	for (size_t i = 0; i < sizeof(T); i++) {
+		out << std::hex << std::setw(2) << std::setfill('0') << static_cast<uint32_t>(bytes[i]);
+	}
+	return out.str();
+}
+
+template<typename T>
+static bool fromHex(const std::string& text, T& value) {
+	if (text.size() != sizeof(T) * 2) {
+		return false;
+	}
+	uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
+	for (size_t i = 0; i < sizeof(T); i++) {
+		bytes[i] = static_cast<uint8_t>(std::stoul(text.substr(i * 2, 2), nullptr, 16));
+	}
+	return true;
+}
+
+// Rest of the line after the fields already extracted, without the separating space
+static std::string remainder(std::istringstream& line) {
+	std::string rest;
+	std::getline(line, rest);
+	if (!rest.empty() && rest[0] == ' ') {
+		rest.erase(0, 1);
+	}
+	return rest;
+}
+
+static void copyName(char* destination, size_t capacity, const std::string& name) {
+	size_t length = std::min(name.size(), capacity - 1);
+	memcpy(destination, name.data(), length);
+	destination[length] = '\0';
+}
+
+void CapabilityCache::load(const std::string& path) {
+	std::ifstream file(path);
+	std::string magic;
+	uint32_t formatVersion = 0;
+	if (!(file >> magic >> formatVersion) || magic != CACHE_MAGIC || formatVersion != CACHE_FORMAT_VERSION) {
+		return;
+	}
+
+	std::string text;
+	std::getline(file, text);
+	DeviceCapabilities* device = nullptr;
+	bool valid = true;
+	try {
+		while (valid && std::getline(file, text)) {
+			std::istringstream line(text);
+			std::string tag;
+			line >> tag;
+			if (tag == "loader") {
+				line >> loaderVersion;
+				instanceProbed = true;
+			}
+			else if (tag == "layer") {
+				VkLayerProperties layer{};
+				line >> layer.specVersion >> layer.implementationVersion;
+				copyName(layer.layerName, VK_MAX_EXTENSION_NAME_SIZE, remainder(line));
+				instanceLayers.push_back(layer);
+			}
+			else if (tag == "instanceExtension" || tag == "extension") {
+				VkExtensionProperties extension{};
+				line >> extension.specVersion;
+				copyName(extension.extensionName, VK_MAX_EXTENSION_NAME_SIZE, remainder(line));
+				if (tag == "extension" && device != nullptr) {
+					device->extensions.push_back(extension);
+				}
+				else {
+					instanceExtensions.push_back(extension);
+				}
+			}
+			else if (tag == "device") {
+				devices.emplace_back();
+				device = &devices.back();
+				uint32_t type = 0;
+				line >> device->vendorID >> device->deviceID >> device->driverVersion >> device->apiVersion >> type;
+				device->deviceType = static_cast<VkPhysicalDeviceType>(type);
+				device->deviceName = remainder(line);
+			}
+			else if (tag == "features" && device != nullptr) {
+				valid = fromHex(remainder(line), device->features);
+			}
+			else if (tag == "limits" && device != nullptr) {
+				valid = fromHex(remainder(line), device->limits);
+			}
+			else if (tag == "queueFamily" && device != nullptr) {
+				VkQueueFamilyProperties family{};
+				line >> family.queueFlags >> family.queueCount >> family.timestampValidBits
+					>> family.minImageTransferGranularity.width >> family.minImageTransferGranularity.height >> family.minImageTransferGranularity.depth;
+				device->queueFamilies.push_back(family);
+			}
+			else if (tag == "format" && device != nullptr) {
+				uint32_t format = 0;
+				VkFormatProperties properties{};
+				line >> format >> properties.linearTilingFeatures >> properties.optimalTilingFeatures >> properties.bufferFeatures;
+				device->formats.push_back({ static_cast<VkFormat>(format), properties });
+			}
+			else if (!tag.empty()) {
+				valid = false;
+			}
+		}
+	}
+	catch (const std::exception&) {
+		valid = false;
+	}
+
+	// A damaged or foreign file is treated as no cache at all
+	if (!valid) {
+		loaderVersion = 0;
+		instanceProbed = false;
+		instanceLayers.clear();
+		instanceExtensions.clear();
+		devices.clear();
+	}
+}
+
+void CapabilityCache::save(const std::string& path) const {
+	if (!dirty) {
+		return;
+	}
+	std::ofstream file(path, std::ios::trunc);
+	file << CACHE_MAGIC << " " << CACHE_FORMAT_VERSION << "\n";
+	file << "loader " << loaderVersion << "\n";
+	for (const VkLayerProperties& layer : instanceLayers) {
+		file << "layer " << layer.specVersion << " " << layer.implementationVersion << " " << layer.layerName << "\n";
+	}
+	for (const VkExtensionProperties& extension : instanceExtensions) {
+		file << "instanceExtension " << extension.specVersion << " " << extension.extensionName << "\n";
+	}
+	std::vector<bool> seen = getSeenDevices();
+	for (size_t i = 0; i < devices.size(); i++) {
+		if (!seen[i]) {
+			continue;
+		}
+		const DeviceCapabilities& device = devices[i];
+		file << "device " << device.vendorID << " " << device.deviceID << " " << device.driverVersion << " " << device.apiVersion << " "
+			<< static_cast<uint32_t>(device.deviceType) << " " << device.deviceName << "\n";
+		file << "features " << toHex(device.features) << "\n";
+		file << "limits " << toHex(device.limits) << "\n";
+		for (const VkExtensionProperties& extension : device.extensions) {
+			file << "extension " << extension.specVersion << " " << extension.extensionName << "\n";
+		}
+		for (const VkQueueFamilyProperties& family : device.queueFamilies) {
+			file << "queueFamily " << family.queueFlags << " " << family.queueCount << " " << family.timestampValidBits << " "
+				<< family.minImageTransferGranularity.width << " " << family.minImageTransferGranularity.height << " " << family.minImageTransferGranularity.depth << "\n";
+		}
+		for (const auto& format : device.formats) {
+			file << "format " << static_cast<uint32_t>(format.first) << " " << format.second.linearTilingFeatures << " "
+				<< format.second.optimalTilingFeatures << " " << format.second.bufferFeatures << "\n";
+		}
+	}
+}
+
+std::vector<bool> CapabilityCache::getSeenDevices() const {
+	std::vector<bool> seen(devices.size(), false);
+	for (const auto& handle : deviceHandles) {
+		seen[handle.second] = true;
+	}
+	return seen;
+}
+
+const VkFormatProperties* DeviceCapabilities::findFormat(VkFormat format) const {
+	for (const auto& entry : formats) {
+		if (entry.first == format) {
+			return &entry.second;
+		}
+	}
+	return nullptr;
+}
+
+const std::vector<VkLayerProperties>& CapabilityCache::getInstanceLayers() {
+	probeInstance();
+	return instanceLayers;
+}
+
+const std::vector<VkExtensionProperties>& CapabilityCache::getInstanceExtensions() {
+	probeInstance();
+	return instanceExtensions;
+}
+
+// Re-enumerate layers and instance extensions only when the loader changed since the snapshot was taken
+void CapabilityCache::probeInstance() {
+	uint32_t currentLoader = VK_API_VERSION_1_0;
+	vkEnumerateInstanceVersion(&currentLoader);
+	if (instanceProbed && currentLoader == loaderVersion) {
+		return;
+	}
+	loaderVersion = currentLoader;
+	instanceLayers = enumerate<VkLayerProperties>([](uint32_t* count, VkLayerProperties* layers) {
+		return vkEnumerateInstanceLayerProperties(count, layers);
+	});
+	instanceExtensions = enumerate<VkExtensionProperties>([](uint32_t* count, VkExtensionProperties* extensions) {
+		return vkEnumerateInstanceExtensionProperties(nullptr, count, extensions);
+	});
+	instanceProbed = true;
+	dirty = true;
+}
+
+const DeviceCapabilities& CapabilityCache::getDevice(VkPhysicalDevice device) {
+	auto known = deviceHandles.find(device);
+	if (known != deviceHandles.end()) {
+		return devices[known->second];
+	}
+
+	// The key is cheap to read; only fall back to the full probe when no snapshot entry matches it
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	size_t index = 0;
+	for (; index < devices.size(); index++) {
+		const DeviceCapabilities& cached = devices[index];
+		if (cached.vendorID == properties.vendorID && cached.deviceID == properties.deviceID && cached.driverVersion == properties.driverVersion && cached.apiVersion == properties.apiVersion) {
+			break;
+		}
+	}
+	if (index == devices.size()) {
+		devices.emplace_back();
+		probeDevice(device, properties, devices.back());
+	}
+	deviceHandles[device] = index;
+	return devices[index];
+}
+
+void CapabilityCache::probeDevice(VkPhysicalDevice device, const VkPhysicalDeviceProperties& properties, DeviceCapabilities& capabilities) {
+	capabilities.vendorID = properties.vendorID;
+	capabilities.deviceID = properties.deviceID;
+	capabilities.driverVersion = properties.driverVersion;
+	capabilities.apiVersion = properties.apiVersion;
+	capabilities.deviceType = properties.deviceType;
+	capabilities.deviceName = properties.deviceName;
+	capabilities.limits = properties.limits;
+	vkGetPhysicalDeviceFeatures(device, &capabilities.features);
+
+	capabilities.extensions = enumerate<VkExtensionProperties>([device](uint32_t* count, VkExtensionProperties* extensions) {
+		return vkEnumerateDeviceExtensionProperties(device, nullptr, count, extensions);
+	});
+	// Queue family queries return nothing to signal truncation, so a full buffer means try again with a bigger one
+	capabilities.queueFamilies = enumerate<VkQueueFamilyProperties>([device](uint32_t* count, VkQueueFamilyProperties* families) {
+		uint32_t capacity = *count;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, count, families);
+		return *count == capacity ? VK_INCOMPLETE : VK_SUCCESS;
+	});
+	for (VkFormat format : probedFormats) {
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(device, format, &formatProperties);
+		capabilities.formats.push_back({ format, formatProperties });
+	}
+	dirty = true;
+}
+
+static std::string jsonString(const std::string& text) {
+	std::string quoted = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+		}
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+static std::string versionString(uint32_t version) {
+	std::ostringstream out;
+	out << VK_API_VERSION_MAJOR(version) << "." << VK_API_VERSION_MINOR(version) << "." << VK_API_VERSION_PATCH(version);
+	return out.str();
+}
+
+void CapabilityCache::writeJson(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	file << "{\n  \"loaderVersion\": " << jsonString(versionString(loaderVersion)) << ",\n";
+
+	file << "  \"layers\": [";
+	for (size_t i = 0; i < instanceLayers.size(); i++) {
+		file << (i ? ", " : "") << jsonString(instanceLayers[i].layerName);
+	}
+	file << "],\n  \"instanceExtensions\": [";
+	for (size_t i = 0; i < instanceExtensions.size(); i++) {
+		file << (i ? ", " : "") << jsonString(instanceExtensions[i].extensionName);
+	}
+	file << "],\n  \"devices\": [";
+
+	std::vector<bool> seen = getSeenDevices();
+	bool first = true;
+	for (size_t d = 0; d < devices.size(); d++) {
+		if (!seen[d]) {
+			continue;
+		}
+		const DeviceCapabilities& device = devices[d];
+		const VkPhysicalDeviceLimits& limits = device.limits;
+		const VkPhysicalDeviceFeatures& features = device.features;
+		file << (first ? "" : ",") << "\n    {\n";
+		first = false;
+		file << "      \"name\": " << jsonString(device.deviceName) << ",\n";
+		file << "      \"vendorID\": " << device.vendorID << ", \"deviceID\": " << device.deviceID << ", \"driverVersion\": " << device.driverVersion
+			<< ", \"apiVersion\": " << jsonString(versionString(device.apiVersion)) << ", \"deviceType\": " << static_cast<uint32_t>(device.deviceType) << ",\n";
+		file << "      \"limits\": { \"maxImageDimension2D\": " << limits.maxImageDimension2D
+			<< ", \"maxUniformBufferRange\": " << limits.maxUniformBufferRange
+			<< ", \"maxStorageBufferRange\": " << limits.maxStorageBufferRange
+			<< ", \"maxPushConstantsSize\": " << limits.maxPushConstantsSize
+			<< ", \"maxMemoryAllocationCount\": " << limits.maxMemoryAllocationCount
+			<< ", \"maxBoundDescriptorSets\": " << limits.maxBoundDescriptorSets
+			<< ", \"maxComputeSharedMemorySize\": " << limits.maxComputeSharedMemorySize
+			<< ", \"maxComputeWorkGroupInvocations\": " << limits.maxComputeWorkGroupInvocations
+			<< ", \"minUniformBufferOffsetAlignment\": " << limits.minUniformBufferOffsetAlignment
+			<< ", \"minStorageBufferOffsetAlignment\": " << limits.minStorageBufferOffsetAlignment
+			<< ", \"nonCoherentAtomSize\": " << limits.nonCoherentAtomSize
+			<< ", \"framebufferColorSampleCounts\": " << limits.framebufferColorSampleCounts
+			<< ", \"framebufferDepthSampleCounts\": " << limits.framebufferDepthSampleCounts
+			<< ", \"timestampComputeAndGraphics\": " << (limits.timestampComputeAndGraphics ? "true" : "false")
+			<< ", \"timestampPeriod\": " << limits.timestampPeriod << " },\n";
+		file << "      \"features\": { \"geometryShader\": " << (features.geometryShader ? "true" : "false")
+			<< ", \"tessellationShader\": " << (features.tessellationShader ? "true" : "false")
+			<< ", \"sampleRateShading\": " << (features.sampleRateShading ? "true" : "false")
+			<< ", \"multiDrawIndirect\": " << (features.multiDrawIndirect ? "true" : "false")
+			<< ", \"samplerAnisotropy\": " << (features.samplerAnisotropy ? "true" : "false")
+			<< ", \"pipelineStatisticsQuery\": " << (features.pipelineStatisticsQuery ? "true" : "false")
+			<< ", \"shaderInt64\": " << (features.shaderInt64 ? "true" : "false") << " },\n";
+		file << "      \"queueFamilies\": [";
+		for (size_t i = 0; i < device.queueFamilies.size(); i++) {
+			const VkQueueFamilyProperties& family = device.queueFamilies[i];
+			file << (i ? ", " : "") << "{ \"flags\": " << family.queueFlags << ", \"count\": " << family.queueCount << ", \"timestampValidBits\": " << family.timestampValidBits << " }";
+		}
+		file << "],\n      \"formats\": [";
+		for (size_t i = 0; i < device.formats.size(); i++) {
+			const auto& format = device.formats[i];
+			file << (i ? ", " : "") << "{ \"format\": " << static_cast<uint32_t>(format.first) << ", \"linear\": " << format.second.linearTilingFeatures
+				<< ", \"optimal\": " << format.second.optimalTilingFeatures << ", \"buffer\": " << format.second.bufferFeatures << " }";
+		}
+		file << "],\n      \"extensions\": [";
+		for (size_t i = 0; i < device.extensions.size(); i++) {
+			file << (i ? ", " : "") << jsonString(device.extensions[i].extensionName);
+		}
+		file << "]\n    }";
+	}
+	file << "\n  ]\n}\n";
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Everything probed about one physical device that does not depend on a surface.
+struct DeviceCapabilities {
+	uint32_t vendorID = 0;
+	uint32_t deviceID = 0;
+	uint32_t driverVersion = 0;
+	uint32_t apiVersion = 0;
+	VkPhysicalDeviceType deviceType = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+	std::string deviceName;
+	VkPhysicalDeviceFeatures features{};
+	VkPhysicalDeviceLimits limits{};
+	std::vector<VkExtensionProperties> extensions;
+	std::vector<VkQueueFamilyProperties> queueFamilies;
+	std::vector<std::pair<VkFormat, VkFormatProperties>> formats;
+
+	// Properties of one of the probed formats, nullptr for a format that isn't probed
+	const VkFormatProperties* findFormat(VkFormat format) const;
+};
+
+// Snapshot of instance and device capabilities persisted between launches.
+// Instance layers and extensions are keyed by the loader version, each device by vendor, device, driver and API version.
+// While the keys match the snapshot is answered from disk; anything that changed is probed again and the file rewritten.
+// Layers installed or removed without a loader update are only noticed once the cache file is deleted.
+class CapabilityCache {
+public:
+	void load(const std::string& path);
+	// Writes the cache only if something had to be probed
+	void save(const std::string& path) const;
+	// Human readable dump of the snapshot for performance triage, covering the same devices as save
+	void writeJson(const std::string& path) const;
+
+	const std::vector<VkLayerProperties>& getInstanceLayers();
+	const std::vector<VkExtensionProperties>& getInstanceExtensions();
+	// Cheap for a device already in the snapshot: only vkGetPhysicalDeviceProperties is called to check the key
+	const DeviceCapabilities& getDevice(VkPhysicalDevice device);
+
+	bool isDirty() const { return dirty; }
+
+	// Enumerate with a single call in the common case, only growing and retrying on VK_INCOMPLETE
+	template<typename T, typename Enumerate>
+	static std::vector<T> enumerate(Enumerate&& call) {
+		std::vector<T> items(16);
+		uint32_t count = static_cast<uint32_t>(items.size());
+		while (call(&count, items.data()) == VK_INCOMPLETE) {
+			items.resize(items.size() * 2);
+			count = static_cast<uint32_t>(items.size());
+		}
+		items.resize(count);
+		return items;
+	}
+
+private:
+	void probeInstance();
+	void probeDevice(VkPhysicalDevice device, const VkPhysicalDeviceProperties& properties, DeviceCapabilities& capabilities);
+	// Which devices were seen this launch; only those are written out, so entries for replaced drivers don't pile up
+	std::vector<bool> getSeenDevices() const;
+
+	uint32_t loaderVersion = 0;
+	bool instanceProbed = false;
+	std::vector<VkLayerProperties> instanceLayers;
+	std::vector<VkExtensionProperties> instanceExtensions;
+	std::vector<DeviceCapabilities> devices;
+	std::map<VkPhysicalDevice, size_t> deviceHandles;
+	bool dirty = false;
+};
@@ -0,0 +1,238 @@
+#include "DeviceMemoryTelemetry.h"
+
+#include "FileOutput.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <iomanip>
+
+namespace {
+	// Room for every heap x category series with plenty to spare
+	const size_t EXPORT_BUFFER_SIZE = 64 * 1024;
+	const double BYTES_PER_MB = 1024.0 * 1024.0;
+}
+
+const char* getMemoryCategoryName(MemoryCategory category) {
+	switch (category) {
+	case MemoryCategory::Textures:
+		return "textures";
+	case MemoryCategory::Meshes:
+		return "meshes";
+	case MemoryCategory::RenderTargets:
+		return "render_targets";
+	case MemoryCategory::Staging:
+		return "staging";
+	case MemoryCategory::Uniforms:
+		return "uniforms";
+	case MemoryCategory::Readback:
+		return "readback";
+	default:
+		return "other";
+	}
+}
+
+void DeviceMemoryTelemetry::init(const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceLimits& limits, bool memoryBudgetEnabled) {
+	memProperties = memoryProperties;
+	maxAllocationCount = limits.maxMemoryAllocationCount;
+	budgetEnabled = memoryBudgetEnabled;
+	text.resize(EXPORT_BUFFER_SIZE);
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		heapBudget[i] = memProperties.memoryHeaps[i].size;
+	}
+}
+
+VkResult DeviceMemoryTelemetry::allocate(VkDevice device, const VkMemoryAllocateInfo& allocInfo, VkDeviceSize requiredSize, MemoryCategory category, const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory) {
+	VkResult result = vkAllocateMemory(device, &allocInfo, pAllocator, pMemory);
+	if (result != VK_SUCCESS) {
+		return result;
+	}
+	Allocation allocation;
+	allocation.heapIndex = memProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+	allocation.category = category;
+	allocation.size = allocInfo.allocationSize;
+	allocation.padding = allocInfo.allocationSize > requiredSize ? allocInfo.allocationSize - requiredSize : 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	allocations[*pMemory] = allocation;
+	add(heaps[allocation.heapIndex], allocation.size);
+	add(categories[allocation.heapIndex][static_cast<uint32_t>(category)], allocation.size);
+	heapPadding[allocation.heapIndex] += allocation.padding;
+	allocationCount++;
+	peakAllocationCount = std::max(peakAllocationCount, allocationCount);
+	return result;
+}
+
+void DeviceMemoryTelemetry::free(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator) {
+	if (memory == VK_NULL_HANDLE) {
+		return;
+	}
+	vkFreeMemory(device, memory, pAllocator);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = allocations.find(memory);
+	if (it == allocations.end()) {
+		return;
+	}
+	const Allocation& allocation = it->second;
+	Usage& heap = heaps[allocation.heapIndex];
+	Usage& category = categories[allocation.heapIndex][static_cast<uint32_t>(allocation.category)];
+	heap.bytes -= allocation.size;
+	heap.allocations--;
+	category.bytes -= allocation.size;
+	category.allocations--;
+	heapPadding[allocation.heapIndex] -= allocation.padding;
+	allocationCount--;
+	allocations.erase(it);
+}
+
+void DeviceMemoryTelemetry::add(Usage& usage, VkDeviceSize size) {
+	usage.bytes += size;
+	usage.peakBytes = std::max(usage.peakBytes, usage.bytes);
+	usage.allocations++;
+}
+
+void DeviceMemoryTelemetry::updateBudget(VkPhysicalDevice physicalDevice) {
+	if (!budgetEnabled) {
+		return;
+	}
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+	budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	VkPhysicalDeviceMemoryProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	properties.pNext = &budget;
+	vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		heapBudget[i] = budget.heapBudget[i];
+		heapProcessUsage[i] = budget.heapUsage[i];
+	}
+}
+
+void DeviceMemoryTelemetry::append(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	int written = vsnprintf(text.data() + textLength, text.size() - textLength, format, args);
+	va_end(args);
+	// Anything that doesn't fit is dropped rather than grown, growing would allocate inside the frame loop
+	if (written > 0) {
+		textLength = std::min(textLength + static_cast<size_t>(written), text.size() - 1);
+	}
+}
+
+bool DeviceMemoryTelemetry::exportMetrics(const std::string& path) {
+	// The paths are built once; after that an export only formats into the reserved buffer
+	if (exportPath != path) {
+		exportPath = path;
+		exportTempPath = path + ".tmp";
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	textLength = 0;
+	append("# HELP vk_heap_size_bytes Size of the memory heap.\n# TYPE vk_heap_size_bytes gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		bool deviceLocal = (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		append("vk_heap_size_bytes{heap=\"%u\",device_local=\"%s\"} %llu\n", i, deviceLocal ? "true" : "false",
+			static_cast<unsigned long long>(memProperties.memoryHeaps[i].size));
+	}
+	append("# HELP vk_heap_budget_bytes Memory the process can use from the heap (VK_EXT_memory_budget, otherwise the heap size).\n# TYPE vk_heap_budget_bytes gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		append("vk_heap_budget_bytes{heap=\"%u\"} %llu\n", i, static_cast<unsigned long long>(heapBudget[i]));
+	}
+	if (budgetEnabled) {
+		// Includes what the tracker can't see: swap chain images, driver internal allocations
+		append("# HELP vk_heap_process_usage_bytes Heap usage of the whole process as reported by the driver.\n# TYPE vk_heap_process_usage_bytes gauge\n");
+		for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+			append("vk_heap_process_usage_bytes{heap=\"%u\"} %llu\n", i, static_cast<unsigned long long>(heapProcessUsage[i]));
+		}
+	}
+
+	append("# HELP vk_heap_allocated_bytes Device memory allocated by the renderer.\n# TYPE vk_heap_allocated_bytes gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		append("vk_heap_allocated_bytes{heap=\"%u\"} %llu\n", i, static_cast<unsigned long long>(heaps[i].bytes));
+	}
+	append("# HELP vk_heap_allocated_peak_bytes Highest vk_heap_allocated_bytes since startup.\n# TYPE vk_heap_allocated_peak_bytes gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		append("vk_heap_allocated_peak_bytes{heap=\"%u\"} %llu\n", i, static_cast<unsigned long long>(heaps[i].peakBytes));
+	}
+
+	append("# HELP vk_category_allocated_bytes Device memory allocated per heap and category.\n# TYPE vk_category_allocated_bytes gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		for (uint32_t c = 0; c < static_cast<uint32_t>(MemoryCategory::Count); c++) {
+			if (categories[i][c].peakBytes > 0) {
+				append("vk_category_allocated_bytes{heap=\"%u\",category=\"%s\"} %llu\n", i, getMemoryCategoryName(static_cast<MemoryCategory>(c)),
+					static_cast<unsigned long long>(categories[i][c].bytes));
+			}
+		}
+	}
+	append("# HELP vk_category_allocated_peak_bytes Highest vk_category_allocated_bytes since startup.\n# TYPE vk_category_allocated_peak_bytes gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		for (uint32_t c = 0; c < static_cast<uint32_t>(MemoryCategory::Count); c++) {
+			if (categories[i][c].peakBytes > 0) {
+				append("vk_category_allocated_peak_bytes{heap=\"%u\",category=\"%s\"} %llu\n", i, getMemoryCategoryName(static_cast<MemoryCategory>(c)),
+					static_cast<unsigned long long>(categories[i][c].peakBytes));
+			}
+		}
+	}
+	append("# HELP vk_category_allocations Live device allocations per heap and category.\n# TYPE vk_category_allocations gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		for (uint32_t c = 0; c < static_cast<uint32_t>(MemoryCategory::Count); c++) {
+			if (categories[i][c].peakBytes > 0) {
+				append("vk_category_allocations{heap=\"%u\",category=\"%s\"} %llu\n", i, getMemoryCategoryName(static_cast<MemoryCategory>(c)),
+					static_cast<unsigned long long>(categories[i][c].allocations));
+			}
+		}
+	}
+
+	append("# HELP vk_allocation_padding_bytes Bytes allocations were rounded up by beyond what their resources required.\n# TYPE vk_allocation_padding_bytes gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		append("vk_allocation_padding_bytes{heap=\"%u\"} %llu\n", i, static_cast<unsigned long long>(heapPadding[i]));
+	}
+	append("# HELP vk_allocation_fragmentation_ratio Padding as a fraction of allocated bytes.\n# TYPE vk_allocation_fragmentation_ratio gauge\n");
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		double ratio = heaps[i].bytes > 0 ? static_cast<double>(heapPadding[i]) / heaps[i].bytes : 0.0;
+		append("vk_allocation_fragmentation_ratio{heap=\"%u\"} %.6f\n", i, ratio);
+	}
+	append("# HELP vk_allocations Live vkAllocateMemory allocations.\n# TYPE vk_allocations gauge\nvk_allocations %llu\n",
+		static_cast<unsigned long long>(allocationCount));
+	append("# HELP vk_allocations_peak Highest vk_allocations since startup.\n# TYPE vk_allocations_peak gauge\nvk_allocations_peak %llu\n",
+		static_cast<unsigned long long>(peakAllocationCount));
+	append("# HELP vk_allocations_limit maxMemoryAllocationCount of the device.\n# TYPE vk_allocations_limit gauge\nvk_allocations_limit %u\n", maxAllocationCount);
+
+	return replaceFile(exportPath.c_str(), exportTempPath.c_str(), text.data(), textLength);
+}
+
+void DeviceMemoryTelemetry::getLiveBytes(VkDeviceSize& deviceLocalBytes, VkDeviceSize& hostBytes) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	deviceLocalBytes = 0;
+	hostBytes = 0;
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		bool deviceLocal = (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		(deviceLocal ? deviceLocalBytes : hostBytes) += heaps[i].bytes;
+	}
+}
+
+void DeviceMemoryTelemetry::print(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(2);
+	out << "Device memory (" << allocationCount << " live allocations, peak " << peakAllocationCount << " of " << maxAllocationCount << "):" << std::endl;
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		bool deviceLocal = (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		out << "  heap " << i << (deviceLocal ? " (device local)" : " (host)") << ": " << heaps[i].bytes / BYTES_PER_MB << " MiB live, "
+			<< heaps[i].peakBytes / BYTES_PER_MB << " MiB peak, " << heapPadding[i] / BYTES_PER_MB << " MiB padding, budget "
+			<< heapBudget[i] / BYTES_PER_MB << " MiB" << std::endl;
+		for (uint32_t c = 0; c < static_cast<uint32_t>(MemoryCategory::Count); c++) {
+			const Usage& usage = categories[i][c];
+			if (usage.peakBytes > 0) {
+				out << "    " << std::left << std::setw(15) << getMemoryCategoryName(static_cast<MemoryCategory>(c)) << std::right
+					<< usage.bytes / BYTES_PER_MB << " MiB live, " << usage.peakBytes / BYTES_PER_MB << " MiB peak, "
+					<< usage.allocations << " allocations" << std::endl;
+			}
+		}
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What a device allocation holds. Every vkAllocateMemory made through DeviceMemoryTelemetry is tagged with one.
+enum class MemoryCategory : uint32_t {
+	Textures = 0,
+	Meshes,
+	RenderTargets,
+	Staging,
+	// Per-frame constants and storage (the uniform ring)
+	Uniforms,
+	Readback,
+	Other,
+	Count
+};
+
+const char* getMemoryCategoryName(MemoryCategory category);
+
+// Device memory accounting per heap and per category.
+// Allocations and frees go through allocate() / free(), which keep usage, peak and counts for every
+// (heap, category) pair. exportMetrics() writes a Prometheus text exposition file that a node exporter textfile
+// collector can scrape; it formats into a buffer reserved up front and never touches the heap, so it can be
+// called periodically from the frame loop.
+//
+// Fragmentation is reported as the bytes the driver rounded allocations up by beyond what the resources asked for,
+// and as the allocation count against maxMemoryAllocationCount, which runs out long before memory does when
+// resources each get their own allocation.
+class DeviceMemoryTelemetry {
+public:
+	void init(const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceLimits& limits, bool memoryBudgetEnabled);
+
+	// vkAllocateMemory plus accounting. requiredSize is what the resource asked for (e.g. the buffer size),
+	// allocInfo.allocationSize what its memory requirements rounded that up to.
+	VkResult allocate(VkDevice device, const VkMemoryAllocateInfo& allocInfo, VkDeviceSize requiredSize, MemoryCategory category, const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory);
+	void free(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator);
+
+	// Refresh heap budgets and process usage from VK_EXT_memory_budget, if enabled
+	void updateBudget(VkPhysicalDevice physicalDevice);
+
+	// Write the metrics to path, through path + ".tmp" so scrapers never see a partial file
+	bool exportMetrics(const std::string& path);
+	void print(std::ostream& out) const;
+	// Live bytes summed over device local heaps and over the other heaps
+	void getLiveBytes(VkDeviceSize& deviceLocalBytes, VkDeviceSize& hostBytes) const;
+
+private:
+	struct Usage {
+		VkDeviceSize bytes = 0;
+		VkDeviceSize peakBytes = 0;
+		uint64_t allocations = 0;
+	};
+	struct Allocation {
+		uint32_t heapIndex;
+		MemoryCategory category;
+		VkDeviceSize size;
+		VkDeviceSize padding;
+	};
+
+	void add(Usage& usage, VkDeviceSize size);
+	void append(const char* format, ...);
+
+	mutable std::mutex mutex;
+	VkPhysicalDeviceMemoryProperties memProperties{};
+	uint32_t maxAllocationCount = 0;
+	bool budgetEnabled = false;
+	VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS] = {};
+	VkDeviceSize heapProcessUsage[VK_MAX_MEMORY_HEAPS] = {};
+
+	Usage heaps[VK_MAX_MEMORY_HEAPS];
+	Usage categories[VK_MAX_MEMORY_HEAPS][static_cast<uint32_t>(MemoryCategory::Count)];
+	VkDeviceSize heapPadding[VK_MAX_MEMORY_HEAPS] = {};
+	uint64_t allocationCount = 0;
+	uint64_t peakAllocationCount = 0;
+	std::unordered_map<VkDeviceMemory, Allocation> allocations;
+
+	// Export text, sized in init()
+	std::vector<char> text;
+	size_t textLength = 0;
+	std::string exportPath;
+	std::string exportTempPath;
+};
@@ -0,0 +1,78 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Smoothing of the level and the trend; higher follows changes faster but passes more noise through
+	const double LEVEL_SMOOTHING = 0.2;
+	const double TREND_SMOOTHING = 0.1;
+}
+
+void DynamicResolutionController::create(const Settings& settings, uint32_t frameCount) {
+	this->settings = settings;
+	this->settings.minScale = std::max(settings.minScale, SCALE_STEP);
+	this->settings.maxScale = std::max(settings.maxScale, this->settings.minScale);
+	scale = settings.enabled ? this->settings.maxScale : 1.0f;
+	slotScales.assign(frameCount, 0.0f);
+	smoothedCost = 0.0;
+	trend = 0.0;
+	predictedCost = 0.0;
+	samples = 0;
+	framesUnderThreshold = 0;
+}
+
+void DynamicResolutionController::setOutputExtent(VkExtent2D extent) {
+	outputExtent = extent;
+}
+
+VkExtent2D DynamicResolutionController::update(uint32_t frameIndex, double gpuMilliseconds) {
+	float sampleScale = slotScales[frameIndex];
+	if (settings.enabled && sampleScale > 0.0f && gpuMilliseconds > 0.0) {
+		double sampleCost = gpuMilliseconds / (static_cast<double>(sampleScale) * sampleScale);
+		if (samples == 0) {
+			smoothedCost = sampleCost;
+			trend = 0.0;
+		}
+		else {
+			double previous = smoothedCost;
+			smoothedCost += LEVEL_SMOOTHING * (sampleCost - smoothedCost);
+			trend += TREND_SMOOTHING * ((smoothedCost - previous) - trend);
+		}
+		samples++;
+		// The timing is slotScales.size() frames old; a rising trend is extrapolated over them, and a spike is taken
+		// at face value rather than averaged away
+		predictedCost = std::max(smoothedCost + trend * static_cast<double>(slotScales.size()), sampleCost);
+
+		double budget = settings.targetMilliseconds;
+		double predicted = predictedCost * scale * scale;
+		float fitting = static_cast<float>(std::sqrt(budget * HEADROOM / predictedCost));
+		if (predicted > budget) {
+			scale = std::max(quantize(fitting), settings.minScale);
+			framesUnderThreshold = 0;
+		}
+		else if (predicted < budget * RAISE_THRESHOLD && scale < settings.maxScale) {
+			framesUnderThreshold++;
+			if (framesUnderThreshold >= RAISE_DELAY_FRAMES) {
+				scale = std::max(scale, std::min(quantize(std::min(fitting, scale + RAISE_STEP)), settings.maxScale));
+				framesUnderThreshold = 0;
+			}
+		}
+		else {
+			framesUnderThreshold = 0;
+		}
+	}
+	slotScales[frameIndex] = scale;
+	return getRenderExtent();
+}
+
+VkExtent2D DynamicResolutionController::getRenderExtent() const {
+	VkExtent2D extent;
+	extent.width = std::min(std::max(static_cast<uint32_t>(outputExtent.width * scale), 1u), outputExtent.width);
+	extent.height = std::min(std::max(static_cast<uint32_t>(outputExtent.height * scale), 1u), outputExtent.height);
+	return extent;
+}
+
+float DynamicResolutionController::quantize(float value) const {
+	return std::floor(value / SCALE_STEP + 1e-4f) * SCALE_STEP;
+}
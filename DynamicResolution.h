@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// Chooses the resolution the scene is rendered at so the GPU frame time holds a budget; the post-processing
+// composite upscales the result to the swap chain.
+// GPU time is modelled as proportional to the rendered area. Each timing is divided by the area it was rendered at,
+// giving the cost of a full resolution frame, which is smoothed with a trend (Holt's linear method) and extrapolated
+// over the frames the timing trails by. From that prediction:
+//  - over budget, the scale drops at once, to where the prediction fits HEADROOM of the budget. A single slow frame
+//    is enough, as a missed frame costs more than a few pixels.
+//  - under RAISE_THRESHOLD of the budget for RAISE_DELAY_FRAMES frames in a row, the scale rises by at most
+//    RAISE_STEP, to no more than HEADROOM of the budget.
+//  - in between, it stays. The gap between the thresholds is the hysteresis that keeps it from oscillating.
+// Post-processing and the HUD don't scale with the area, so a drop can save less than predicted; the next timings
+// then drop further.
+class DynamicResolutionController {
+public:
+	struct Settings {
+		bool enabled = false;
+		// GPU time per frame to hold
+		float targetMilliseconds = 16.0f;
+		// Bounds of the render scale, per axis
+		float minScale = 0.5f;
+		float maxScale = 1.0f;
+	};
+
+	static constexpr double HEADROOM = 0.9;
+	static constexpr double RAISE_THRESHOLD = 0.75;
+	static constexpr uint32_t RAISE_DELAY_FRAMES = 30;
+	static constexpr float RAISE_STEP = 0.05f;
+	// Scales are rounded down to multiples of this, so small changes in the timings don't change the resolution
+	static constexpr float SCALE_STEP = 0.025f;
+
+	// frameCount is the number of frames in flight, which GPU timings trail by
+	void create(const Settings& settings, uint32_t frameCount);
+	// The swap chain's extent, at a scale of 1
+	void setOutputExtent(VkExtent2D extent);
+
+	// Feed the GPU time of the frame last recorded in frameIndex's slot, as read back when the slot is reused,
+	// and return the extent to render this frame at. Non-positive timings (none yet, or no timestamp support)
+	// are ignored.
+	VkExtent2D update(uint32_t frameIndex, double gpuMilliseconds);
+
+	float getScale() const { return scale; }
+	VkExtent2D getRenderExtent() const;
+	double getPredictedMilliseconds() const { return predictedCost * scale * scale; }
+
+private:
+	float quantize(float value) const;
+
+	Settings settings;
+	VkExtent2D outputExtent = {};
+	float scale = 1.0f;
+	// Scale each frame slot was last recorded at, 0 before its first frame
+	std::vector<float> slotScales;
+
+	// Milliseconds of a frame at full resolution: smoothed, its trend per frame, and the prediction from both
+	double smoothedCost = 0.0;
+	double trend = 0.0;
+	double predictedCost = 0.0;
+	uint32_t samples = 0;
+	uint32_t framesUnderThreshold = 0;
+};
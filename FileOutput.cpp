@@ -0,0 +1,42 @@
+#include "FileOutput.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <cstdio>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+bool replaceFile(const char* path, const char* tempPath, const void* data, size_t size) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(tempPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	DWORD written = 0;
+	BOOL ok = WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) && written == size;
+	CloseHandle(file);
+	return ok && MoveFileExA(tempPath, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	int file = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) {
+		return false;
+	}
+	const char* bytes = static_cast<const char*>(data);
+	size_t remaining = size;
+	while (remaining > 0) {
+		ssize_t written = write(file, bytes, remaining);
+		if (written <= 0) {
+			close(file);
+			return false;
+		}
+		bytes += written;
+		remaining -= static_cast<size_t>(written);
+	}
+	close(file);
+	return rename(tempPath, path) == 0;
+#endif
+}
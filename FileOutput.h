@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// Replace the file at path with data without touching the C++ heap, so it may be called from the frame loop
+// (see AllocationTracker). The data is written to tempPath first and then renamed over path, so a reader polling
+// the file (a metrics collector, a log shipper) never sees it half written. Returns false on any failure.
+bool replaceFile(const char* path, const char* tempPath, const void* data, size_t size);
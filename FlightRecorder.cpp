@@ -0,0 +1,183 @@
+#include "FlightRecorder.h"
+
+#include "FileOutput.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+	// Room for FRAMES_BEFORE + FRAMES_AFTER frames of events
+	const size_t TRACE_BUFFER_SIZE = 2 * 1024 * 1024;
+
+	const char* getCauseName(HitchCause cause) {
+		switch (cause) {
+		case HitchCause::PipelineCompile:
+			return "pipeline_compile";
+		case HitchCause::Allocation:
+			return "allocation";
+		case HitchCause::UploadStall:
+			return "upload_stall";
+		case HitchCause::FenceWait:
+			return "fence_wait";
+		case HitchCause::PresentWait:
+			return "present_wait";
+		default:
+			return "none";
+		}
+	}
+
+	// Small per-thread id for the trace, assigned on a thread's first event
+	std::atomic<uint8_t> nextThreadId{ 1 };
+	thread_local uint8_t threadId = 0;
+}
+
+FlightRecorder::FlightRecorder() : origin(std::chrono::steady_clock::now()) {
+	events.resize(EVENT_CAPACITY);
+	text.resize(TRACE_BUFFER_SIZE);
+}
+
+int64_t FlightRecorder::toNs(std::chrono::steady_clock::time_point time) const {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time - origin).count();
+}
+
+void FlightRecorder::record(const char* name, HitchCause cause, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+	if (threadId == 0) {
+		threadId = nextThreadId.fetch_add(1);
+	}
+	Event& event = events[eventHead.fetch_add(1) % EVENT_CAPACITY];
+	event.name = name;
+	event.frame = currentFrame;
+	event.startNs = toNs(start);
+	event.durationNs = toNs(end) - event.startNs;
+	event.cause = cause;
+	event.thread = threadId;
+}
+
+void FlightRecorder::beginFrame(uint64_t frameNumber) {
+	currentFrame = frameNumber;
+	frameStartNs = toNs(std::chrono::steady_clock::now());
+}
+
+void FlightRecorder::endFrame(uint64_t heapAllocations, double gpuMilliseconds) {
+	Frame& frame = frames[frameCount % FRAME_CAPACITY];
+	frame.number = currentFrame;
+	frame.startNs = frameStartNs;
+	frame.durationNs = toNs(std::chrono::steady_clock::now()) - frameStartNs;
+	frame.heapAllocations = heapAllocations;
+	frame.gpuMilliseconds = gpuMilliseconds;
+	frameCount++;
+
+	if (dumpPending) {
+		if (currentFrame >= hitchFrame + FRAMES_AFTER) {
+			writeTrace();
+			dumpPending = false;
+		}
+		return;
+	}
+	// Compare against the frames before this one, once there are enough of them
+	if (frameCount <= MEDIAN_WINDOW || hitchCount >= MAX_DUMPS) {
+		return;
+	}
+	double frameMs = frame.durationNs / 1000000.0;
+	double medianMs = getMedianMs();
+	if (frameMs > medianMs * HITCH_FACTOR && frameMs - medianMs > MIN_HITCH_MS) {
+		dumpPending = true;
+		hitchFrame = currentFrame;
+		hitchMs = frameMs;
+		hitchMedianMs = medianMs;
+		hitchCause = findCause(frame, frameMs - medianMs);
+		hitchCount++;
+	}
+}
+
+double FlightRecorder::getMedianMs() const {
+	// Median of the MEDIAN_WINDOW frames before the newest
+	int64_t durations[MEDIAN_WINDOW];
+	for (uint32_t i = 0; i < MEDIAN_WINDOW; i++) {
+		durations[i] = frames[(frameCount - 2 - i) % FRAME_CAPACITY].durationNs;
+	}
+	std::nth_element(durations, durations + MEDIAN_WINDOW / 2, durations + MEDIAN_WINDOW);
+	return durations[MEDIAN_WINDOW / 2] / 1000000.0;
+}
+
+// The cause with the most time in the frame, if it explains a fair part of the excess.
+// Heap allocations aren't timed, so they are blamed when the frame allocated and nothing timed explains it.
+HitchCause FlightRecorder::findCause(const Frame& frame, double excessMs) const {
+	int64_t causeNs[static_cast<uint32_t>(HitchCause::Count)] = {};
+	uint64_t head = eventHead.load();
+	uint64_t count = std::min<uint64_t>(head, EVENT_CAPACITY);
+	for (uint64_t i = head - count; i < head; i++) {
+		const Event& event = events[i % EVENT_CAPACITY];
+		if (event.frame == frame.number) {
+			causeNs[static_cast<uint32_t>(event.cause)] += event.durationNs;
+		}
+	}
+	HitchCause cause = HitchCause::None;
+	int64_t longest = 0;
+	for (uint32_t i = 1; i < static_cast<uint32_t>(HitchCause::Count); i++) {
+		if (causeNs[i] > longest) {
+			longest = causeNs[i];
+			cause = static_cast<HitchCause>(i);
+		}
+	}
+	if (longest / 1000000.0 >= excessMs / 2) {
+		return cause;
+	}
+	return frame.heapAllocations > 0 ? HitchCause::Allocation : cause;
+}
+
+void FlightRecorder::append(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	int written = vsnprintf(text.data() + textLength, text.size() - textLength, format, args);
+	va_end(args);
+	if (written > 0) {
+		textLength = std::min(textLength + static_cast<size_t>(written), text.size() - 1);
+	}
+}
+
+void FlightRecorder::writeTrace() {
+	uint64_t firstFrame = hitchFrame > FRAMES_BEFORE ? hitchFrame - FRAMES_BEFORE : 0;
+	uint64_t lastFrame = hitchFrame + FRAMES_AFTER;
+
+	// Chrome trace event format, timestamps in microseconds. Frames go on their own track above the scopes.
+	textLength = 0;
+	append("{\"traceEvents\":[\n");
+	append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"frames\"}}");
+	uint64_t storedFrames = std::min<uint64_t>(frameCount, FRAME_CAPACITY);
+	for (uint64_t i = frameCount - storedFrames; i < frameCount; i++) {
+		const Frame& frame = frames[i % FRAME_CAPACITY];
+		if (frame.number < firstFrame || frame.number > lastFrame) {
+			continue;
+		}
+		append(",\n{\"name\":\"frame %llu\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"heapAllocations\":%llu,\"gpuMs\":%.3f}}",
+			static_cast<unsigned long long>(frame.number), frame.startNs / 1000.0, frame.durationNs / 1000.0,
+			static_cast<unsigned long long>(frame.heapAllocations), frame.gpuMilliseconds);
+		if (frame.number == hitchFrame) {
+			append(",\n{\"name\":\"hitch: %s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"args\":{\"cause\":\"%s\",\"frameMs\":%.3f,\"medianMs\":%.3f}}",
+				getCauseName(hitchCause), frame.startNs / 1000.0, getCauseName(hitchCause), hitchMs, hitchMedianMs);
+		}
+	}
+	uint64_t head = eventHead.load();
+	uint64_t count = std::min<uint64_t>(head, EVENT_CAPACITY);
+	for (uint64_t i = head - count; i < head; i++) {
+		const Event& event = events[i % EVENT_CAPACITY];
+		if (event.frame < firstFrame || event.frame > lastFrame) {
+			continue;
+		}
+		append(",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			event.name, getCauseName(event.cause), static_cast<uint32_t>(event.thread), event.startNs / 1000.0, event.durationNs / 1000.0);
+	}
+	append("\n]}\n");
+
+	char path[64];
+	char tempPath[64];
+	snprintf(path, sizeof(path), "hitch_%llu.json", static_cast<unsigned long long>(hitchFrame));
+	snprintf(tempPath, sizeof(tempPath), "hitch_%llu.json.tmp", static_cast<unsigned long long>(hitchFrame));
+	if (replaceFile(path, tempPath, text.data(), textLength)) {
+		std::cout << "Hitch in frame " << hitchFrame << " (" << hitchMs << " ms, median " << hitchMedianMs << " ms, cause "
+			<< getCauseName(hitchCause) << "), trace written to " << path << std::endl;
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// What a traced scope spends its time on. A hitch is attributed to the cause with the most time in the frame.
+enum class HitchCause : uint8_t {
+	None = 0,
+	PipelineCompile,
+	Allocation,
+	UploadStall,
+	FenceWait,
+	PresentWait,
+	Count
+};
+
+// Always-on trace of the last frames, dumped to disk when a frame hitches.
+// Scopes are recorded into a fixed ring of events, frames into a fixed ring of frame records, so recording costs
+// two clock reads and a store and nothing is ever allocated. When a frame takes more than HITCH_FACTOR times the
+// rolling median, the frames around it are written as a Chrome trace (chrome://tracing, ui.perfetto.dev) to
+// hitch_<frame>.json, with the hitch annotated by its most likely cause.
+class FlightRecorder {
+public:
+	// A frame hitches when it is this many times slower than the median of the last MEDIAN_WINDOW frames,
+	// and at least MIN_HITCH_MS slower in absolute terms
+	static constexpr double HITCH_FACTOR = 2.0;
+	static constexpr double MIN_HITCH_MS = 4.0;
+	static constexpr uint32_t MEDIAN_WINDOW = 64;
+	// Frames written before and after the hitch
+	static constexpr uint32_t FRAMES_BEFORE = 24;
+	static constexpr uint32_t FRAMES_AFTER = 8;
+	// Stop dumping after this many hitches, so a run that is slow throughout doesn't fill the disk
+	static constexpr uint32_t MAX_DUMPS = 16;
+
+	// Records a scope from construction to destruction
+	class Scope {
+	public:
+		Scope(FlightRecorder& recorder, const char* name, HitchCause cause = HitchCause::None)
+			: recorder(recorder), name(name), cause(cause), start(std::chrono::steady_clock::now()) {}
+		~Scope() { recorder.record(name, cause, start, std::chrono::steady_clock::now()); }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		FlightRecorder& recorder;
+		const char* name;
+		HitchCause cause;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	FlightRecorder();
+
+	// name must outlive the recorder, normally a literal. Safe to call from any thread.
+	void record(const char* name, HitchCause cause, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+	void beginFrame(uint64_t frameNumber);
+	// heapAllocations and gpuMilliseconds are stored with the frame and shown in the trace
+	void endFrame(uint64_t heapAllocations, double gpuMilliseconds);
+
+	uint32_t getHitchCount() const { return hitchCount; }
+
+private:
+	static constexpr uint32_t EVENT_CAPACITY = 8192;
+	static constexpr uint32_t FRAME_CAPACITY = 128;
+
+	struct Event {
+		const char* name;
+		uint64_t frame;
+		int64_t startNs;
+		int64_t durationNs;
+		HitchCause cause;
+		uint8_t thread;
+	};
+	struct Frame {
+		uint64_t number;
+		int64_t startNs;
+		int64_t durationNs;
+		uint64_t heapAllocations;
+		double gpuMilliseconds;
+	};
+
+	int64_t toNs(std::chrono::steady_clock::time_point time) const;
+	double getMedianMs() const;
+	HitchCause findCause(const Frame& frame, double excessMs) const;
+	void writeTrace();
+	void append(const char* format, ...);
+
+	std::chrono::steady_clock::time_point origin;
+	// EVENT_CAPACITY events, allocated once so the recorder can live on the stack
+	std::vector<Event> events;
+	std::atomic<uint64_t> eventHead{ 0 };
+	Frame frames[FRAME_CAPACITY];
+	uint64_t frameCount = 0;
+	uint64_t currentFrame = 0;
+	int64_t frameStartNs = 0;
+
+	// Pending dump: written once FRAMES_AFTER more frames have completed
+	bool dumpPending = false;
+	uint64_t hitchFrame = 0;
+	HitchCause hitchCause = HitchCause::None;
+	double hitchMs = 0.0;
+	double hitchMedianMs = 0.0;
+	uint32_t hitchCount = 0;
+
+	// Trace text, reserved up front
+	std::vector<char> text;
+	size_t textLength = 0;
+};
@@ -0,0 +1,703 @@
+#include "FrameCapture.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+	// Serialized sizes of the structures records carry field by field
+	const size_t SCENE_PARAMETERS_SIZE = 5 * sizeof(uint32_t) + sizeof(float);
+	const size_t POST_SETTINGS_SIZE = 6 * sizeof(float) + 3 * sizeof(uint32_t);
+
+	// Payload size of each record type; an Upload record's data follows its fixed part
+	size_t getPayloadSize(CaptureRecord type) {
+		switch (type) {
+		case CaptureRecord::CreateTargets:
+			return 2 * sizeof(uint32_t) + 2 * sizeof(VkFormat) + sizeof(VkSampleCountFlagBits);
+		case CaptureRecord::CreateScene:
+			return SCENE_PARAMETERS_SIZE + sizeof(uint32_t);
+		case CaptureRecord::Upload:
+			return sizeof(uint32_t) + sizeof(VkDeviceSize);
+		case CaptureRecord::SetJitter:
+			return 2 * sizeof(float);
+		case CaptureRecord::SetSceneFrame:
+			return sizeof(uint64_t);
+		case CaptureRecord::BinLights:
+		case CaptureRecord::DrawScene:
+			return 3 * sizeof(uint32_t);
+		case CaptureRecord::PostProcess:
+			return 2 * sizeof(uint32_t) + POST_SETTINGS_SIZE;
+		case CaptureRecord::Submit:
+		case CaptureRecord::EndFrame:
+			return 0;
+		default:
+			throw std::runtime_error("Frame capture has an unknown record!");
+		}
+	}
+
+	// Walks the records after the file header, checking every declared size against its type, and calls visit with
+	// each record's type, payload offset and size
+	template<typename Visit>
+	void forEachRecord(const std::vector<uint8_t>& data, Visit visit) {
+		size_t offset = 2 * sizeof(uint32_t);
+		while (offset < data.size()) {
+			if (offset + 2 * sizeof(uint32_t) > data.size()) {
+				throw std::runtime_error("Frame capture is truncated!");
+			}
+			uint32_t type, size;
+			memcpy(&type, data.data() + offset, sizeof(type));
+			memcpy(&size, data.data() + offset + sizeof(type), sizeof(size));
+			offset += 2 * sizeof(uint32_t);
+			if (offset + size > data.size()) {
+				throw std::runtime_error("Frame capture is truncated!");
+			}
+			CaptureRecord record = static_cast<CaptureRecord>(type);
+			size_t expected = getPayloadSize(record);
+			if (record == CaptureRecord::Upload ? size < expected : size != expected) {
+				throw std::runtime_error("Frame capture record size doesn't match its type!");
+			}
+			visit(record, offset, size);
+			offset += size;
+		}
+	}
+
+	// Reads a record's payload in the order it was appended
+	class PayloadReader {
+	public:
+		PayloadReader(const uint8_t* payload, uint32_t size) : payload(payload), size(size) {}
+
+		template<typename T>
+		T read() {
+			if (offset + sizeof(T) > size) {
+				throw std::runtime_error("Frame capture record is truncated!");
+			}
+			T value;
+			memcpy(&value, payload + offset, sizeof(T));
+			offset += sizeof(T);
+			return value;
+		}
+		const uint8_t* rest() const { return payload + offset; }
+		size_t remaining() const { return size - offset; }
+
+	private:
+		const uint8_t* payload;
+		size_t size;
+		size_t offset = 0;
+	};
+
+	VkExtent2D readExtent(PayloadReader& reader) {
+		VkExtent2D extent;
+		extent.width = reader.read<uint32_t>();
+		extent.height = reader.read<uint32_t>();
+		return extent;
+	}
+}
+
+void FrameRecorder::open(const std::string& capturePath) {
+	path = capturePath;
+	data.clear();
+	append(FRAME_CAPTURE_MAGIC);
+	append(FRAME_CAPTURE_VERSION);
+	recordEnd = data.size();
+}
+
+void FrameRecorder::beginRecord(CaptureRecord type, size_t dataSize) {
+	checkRecordEnd();
+	size_t size = getPayloadSize(type) + dataSize;
+	append(static_cast<uint32_t>(type));
+	append(static_cast<uint32_t>(size));
+	recordEnd = data.size() + size;
+}
+
+void FrameRecorder::checkRecordEnd() const {
+	if (data.size() != recordEnd) {
+		throw std::runtime_error("Frame capture record size doesn't match its payload!");
+	}
+}
+
+void FrameRecorder::recordCreateTargets(VkExtent2D extent, VkFormat outputFormat, VkFormat depthFormat, VkSampleCountFlagBits samples) {
+	if (!isOpen()) {
+		return;
+	}
+	beginRecord(CaptureRecord::CreateTargets);
+	append(extent.width);
+	append(extent.height);
+	append(outputFormat);
+	append(depthFormat);
+	append(samples);
+}
+
+void FrameRecorder::recordCreateScene(const SceneParameters& parameters, uint32_t frameCount) {
+	if (!isOpen()) {
+		return;
+	}
+	beginRecord(CaptureRecord::CreateScene);
+	append(parameters.objectCount);
+	append(parameters.uniqueMeshCount);
+	append(parameters.materialCount);
+	append(parameters.lightCount);
+	append(parameters.motionRatio);
+	append(parameters.seed);
+	append(frameCount);
+}
+
+void FrameRecorder::beginFrame() {
+	capturingFrame = isOpen();
+}
+
+void FrameRecorder::recordUpload(uint32_t id, VkDeviceSize offset, const void* source, VkDeviceSize size) {
+	if (!capturingFrame) {
+		return;
+	}
+	beginRecord(CaptureRecord::Upload, static_cast<size_t>(size));
+	append(id);
+	append(offset);
+	const uint8_t* bytes = static_cast<const uint8_t*>(source);
+	data.insert(data.end(), bytes, bytes + size);
+}
+
+void FrameRecorder::recordSetJitter(float x, float y) {
+	if (!capturingFrame) {
+		return;
+	}
+	beginRecord(CaptureRecord::SetJitter);
+	append(x);
+	append(y);
+}
+
+void FrameRecorder::recordSetSceneFrame(uint64_t frameNumber) {
+	if (!capturingFrame) {
+		return;
+	}
+	beginRecord(CaptureRecord::SetSceneFrame);
+	append(frameNumber);
+}
+
+void FrameRecorder::recordBinLights(uint32_t frameIndex, VkExtent2D renderExtent) {
+	if (!capturingFrame) {
+		return;
+	}
+	beginRecord(CaptureRecord::BinLights);
+	append(frameIndex);
+	append(renderExtent.width);
+	append(renderExtent.height);
+}
+
+void FrameRecorder::recordDrawScene(uint32_t frameIndex, VkExtent2D renderExtent) {
+	if (!capturingFrame) {
+		return;
+	}
+	beginRecord(CaptureRecord::DrawScene);
+	append(frameIndex);
+	append(renderExtent.width);
+	append(renderExtent.height);
+}
+
+void FrameRecorder::recordPostProcess(VkExtent2D renderExtent, const PostProcessChain::Settings& settings) {
+	if (!capturingFrame) {
+		return;
+	}
+	beginRecord(CaptureRecord::PostProcess);
+	append(renderExtent.width);
+	append(renderExtent.height);
+	append(settings.exposure);
+	append(settings.bloomThreshold);
+	append(settings.bloomStrength);
+	append(settings.saturation);
+	append(settings.contrast);
+	append(settings.vignette);
+	append(static_cast<uint32_t>(settings.bloom));
+	append(static_cast<uint32_t>(settings.fxaa));
+	append(static_cast<uint32_t>(settings.taa));
+}
+
+void FrameRecorder::recordSubmit() {
+	if (capturingFrame) {
+		beginRecord(CaptureRecord::Submit);
+	}
+}
+
+void FrameRecorder::endFrame() {
+	if (!capturingFrame) {
+		return;
+	}
+	beginRecord(CaptureRecord::EndFrame);
+	capturingFrame = false;
+	// Read the capture back the way the replayer will, so a record that misframes fails here rather than at replay
+	checkRecordEnd();
+	forEachRecord(data, [](CaptureRecord, size_t, uint32_t) {});
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+		throw std::runtime_error("Failed to write frame capture!");
+	}
+	std::cout << "Captured frame to " << path << " (" << data.size() << " bytes)" << std::endl;
+	path.clear();
+	data.clear();
+}
+
+void FrameReplayer::run(const std::string& path, uint32_t iterations) {
+	load(path);
+	createDevice();
+	for (const Record& record : setupRecords) {
+		PayloadReader reader(file.data() + record.offset, record.size);
+		if (record.type == CaptureRecord::CreateTargets) {
+			VkExtent2D extent = readExtent(reader);
+			VkFormat format = reader.read<VkFormat>();
+			VkFormat targetDepthFormat = reader.read<VkFormat>();
+			createTargets(extent, format, targetDepthFormat, reader.read<VkSampleCountFlagBits>());
+		}
+		else {
+			SceneParameters parameters;
+			parameters.objectCount = reader.read<uint32_t>();
+			parameters.uniqueMeshCount = reader.read<uint32_t>();
+			parameters.materialCount = reader.read<uint32_t>();
+			parameters.lightCount = reader.read<uint32_t>();
+			parameters.motionRatio = reader.read<float>();
+			parameters.seed = reader.read<uint32_t>();
+			createScene(parameters, reader.read<uint32_t>());
+		}
+	}
+	if (output.image == VK_NULL_HANDLE) {
+		throw std::runtime_error("Frame capture has no render targets!");
+	}
+
+	// The first iteration also warms up the driver, so it is reported but left out of the average
+	double cpuTotal = 0.0;
+	double gpuTotal = 0.0;
+	for (uint32_t i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		double gpuMilliseconds = replayFrame();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (i == 0) {
+			std::cout << "Replay warmup frame: " << ms << " ms, GPU " << gpuMilliseconds << " ms" << std::endl;
+		}
+		else {
+			cpuTotal += ms;
+			gpuTotal += gpuMilliseconds;
+		}
+	}
+	if (iterations > 1) {
+		std::cout << "Replayed " << iterations - 1 << " frames of " << outputExtent.width << "x" << outputExtent.height << " on " << deviceProperties.deviceName
+			<< ", average " << cpuTotal / (iterations - 1) << " ms, GPU " << gpuTotal / (iterations - 1) << " ms" << std::endl;
+	}
+	cleanup();
+}
+
+void FrameReplayer::load(const std::string& path) {
+	std::ifstream input(path, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("Failed to open frame capture!");
+	}
+	file.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+
+	uint32_t header[2] = {};
+	if (file.size() < sizeof(header)) {
+		throw std::runtime_error("Frame capture is truncated!");
+	}
+	memcpy(header, file.data(), sizeof(header));
+	if (header[0] != FRAME_CAPTURE_MAGIC || header[1] != FRAME_CAPTURE_VERSION) {
+		throw std::runtime_error("Unsupported frame capture format!");
+	}
+
+	// Index the records; resource creation is replayed once, everything else every iteration
+	forEachRecord(file, [this](CaptureRecord type, size_t offset, uint32_t size) {
+		Record record = { type, offset, size };
+		if (type == CaptureRecord::CreateTargets || type == CaptureRecord::CreateScene) {
+			setupRecords.push_back(record);
+		}
+		else {
+			frameRecords.push_back(record);
+		}
+	});
+}
+
+// Minimal instance and device: no layers, no surface, first Vulkan 1.3 device with a graphics queue
+void FrameReplayer::createDevice() {
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "Vulkan Renderer Replay";
+	appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 3, 249);
+	VkInstanceCreateInfo instanceInfo{};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &appInfo;
+	if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create replay instance!");
+	}
+	instanceTable.load(instance);
+
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+	for (VkPhysicalDevice candidate : devices) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(candidate, &properties);
+		if (properties.apiVersion < VK_API_VERSION_1_3) {
+			continue;
+		}
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+		for (uint32_t i = 0; i < familyCount; i++) {
+			if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				queueFamily = i;
+				timestampValidBits = families[i].timestampValidBits;
+				break;
+			}
+		}
+		if (queueFamily != UINT32_MAX) {
+			physicalDevice = candidate;
+			deviceProperties = properties;
+			break;
+		}
+	}
+	if (physicalDevice == VK_NULL_HANDLE) {
+		throw std::runtime_error("Failed to find a suitable GPU for replay!");
+	}
+	memoryTypes.build(physicalDevice);
+
+	float queuePriority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo{};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = queueFamily;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &queuePriority;
+	VkPhysicalDeviceFeatures deviceFeatures{};
+	// The frame is recorded with dynamic rendering, like the application's
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.dynamicRendering = VK_TRUE;
+	VkDeviceCreateInfo deviceInfo{};
+	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.pNext = &vulkan13Features;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+	deviceInfo.pEnabledFeatures = &deviceFeatures;
+	if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create replay device!");
+	}
+	memoryTelemetry.init(memoryTypes.getProperties(), deviceProperties.limits, false);
+	deviceTable.load(device, instanceTable);
+	vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create replay command pool!");
+	}
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate replay command buffer!");
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create replay fence!");
+	}
+	VkQueryPoolCreateInfo queryInfo{};
+	queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryInfo.queryCount = 2;
+	if (vkCreateQueryPool(device, &queryInfo, nullptr, &queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create replay query pool!");
+	}
+}
+
+void FrameReplayer::createImage(VkExtent2D extent, VkFormat format, VkSampleCountFlagBits imageSamples, VkImageUsageFlags usage, MemoryUsage memoryUsage, VkImageAspectFlags aspect, ReplayImage& replayImage) {
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { extent.width, extent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = imageSamples;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(device, &imageInfo, nullptr, &replayImage.image) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create replay image!");
+	}
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, replayImage.image, &memRequirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryTypes.find(memoryUsage, memRequirements.memoryTypeBits);
+	if (memoryTelemetry.allocate(device, allocInfo, memRequirements.size, MemoryCategory::RenderTargets, nullptr, &replayImage.memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate replay image memory!");
+	}
+	vkBindImageMemory(device, replayImage.image, replayImage.memory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = replayImage.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = aspect;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(device, &viewInfo, nullptr, &replayImage.view) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create replay image view!");
+	}
+}
+
+void FrameReplayer::destroyImage(ReplayImage& replayImage) {
+	if (replayImage.image == VK_NULL_HANDLE) {
+		return;
+	}
+	vkDestroyImageView(device, replayImage.view, nullptr);
+	vkDestroyImage(device, replayImage.image, nullptr);
+	memoryTelemetry.free(device, replayImage.memory, nullptr);
+	replayImage = ReplayImage{};
+}
+
+// Like the application's swap chain resources: a capture made across a resize has the last targets win
+void FrameReplayer::createTargets(VkExtent2D extent, VkFormat format, VkFormat targetDepthFormat, VkSampleCountFlagBits targetSamples) {
+	destroyTargets();
+	if (outputFormat == VK_FORMAT_UNDEFINED) {
+		postProcess.create(device, format, nullptr);
+	}
+	else if (format != outputFormat) {
+		throw std::runtime_error("Frame capture changes the output format!");
+	}
+	outputExtent = extent;
+	outputFormat = format;
+	depthFormat = targetDepthFormat;
+	samples = targetSamples;
+	postProcess.createTargets(device, queue, queueFamily, memoryTypes, memoryTelemetry, extent, samples, nullptr);
+	createImage(extent, outputFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, MemoryUsage::GpuOnly, VK_IMAGE_ASPECT_COLOR_BIT, output);
+	createImage(extent, depthFormat, samples, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, MemoryUsage::Transient, VK_IMAGE_ASPECT_DEPTH_BIT, depth);
+}
+
+void FrameReplayer::destroyTargets() {
+	postProcess.destroyTargets(device, memoryTelemetry, nullptr);
+	destroyImage(output);
+	destroyImage(depth);
+}
+
+void FrameReplayer::createScene(const SceneParameters& parameters, uint32_t frameCount) {
+	if (output.image == VK_NULL_HANDLE) {
+		throw std::runtime_error("Frame capture creates the scene before its render targets!");
+	}
+	stressScene.destroy(device, memoryTelemetry, nullptr);
+	stressScene.create(device, queue, queueFamily, &queueFamily, 1, memoryTypes, memoryTelemetry, PostProcessChain::SCENE_COLOR_FORMAT, depthFormat, samples, outputExtent, frameCount, parameters, nullptr);
+	sceneFrameCount = frameCount;
+}
+
+double FrameReplayer::replayFrame() {
+	double gpuMilliseconds = 0.0;
+	bool recording = false;
+	for (const Record& record : frameRecords) {
+		PayloadReader reader(file.data() + record.offset, record.size);
+		bool command = record.type == CaptureRecord::SetJitter || record.type == CaptureRecord::BinLights || record.type == CaptureRecord::DrawScene || record.type == CaptureRecord::PostProcess;
+		// Commands after a submission go into the next one
+		if (command && !recording) {
+			deviceTable.vkResetCommandBuffer(commandBuffer, 0);
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			if (deviceTable.vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to begin recording replay command buffer!");
+			}
+			deviceTable.vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+			deviceTable.vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+			recording = true;
+		}
+		switch (record.type) {
+		case CaptureRecord::Upload: {
+			uint32_t id = reader.read<uint32_t>();
+			VkDeviceSize offset = reader.read<VkDeviceSize>();
+			size_t size = reader.remaining();
+			if (id != CAPTURE_SCENE_MOTION_ID || !stressScene.isLoaded() || offset + size > stressScene.getMotionRegionSize() * sceneFrameCount) {
+				throw std::runtime_error("Frame capture uploads to an unknown buffer!");
+			}
+			memcpy(stressScene.getMotionRegion(0) + offset, reader.rest(), size);
+			break;
+		}
+		case CaptureRecord::SetJitter: {
+			float x = reader.read<float>();
+			stressScene.setJitter(x, reader.read<float>());
+			break;
+		}
+		case CaptureRecord::SetSceneFrame: {
+			stressScene.setFrameNumber(reader.read<uint64_t>());
+			break;
+		}
+		case CaptureRecord::BinLights: {
+			uint32_t frameIndex = reader.read<uint32_t>();
+			VkExtent2D renderExtent = readExtent(reader);
+			if (!stressScene.isLoaded() || frameIndex >= sceneFrameCount) {
+				throw std::runtime_error("Frame capture bins lights of an unknown frame!");
+			}
+			// On one queue, as the application does without async compute
+			stressScene.binLights(commandBuffer, deviceTable, frameIndex, renderExtent);
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			deviceTable.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			break;
+		}
+		case CaptureRecord::DrawScene: {
+			uint32_t frameIndex = reader.read<uint32_t>();
+			VkExtent2D renderExtent = readExtent(reader);
+			if (stressScene.isLoaded() && frameIndex >= sceneFrameCount) {
+				throw std::runtime_error("Frame capture draws an unknown frame!");
+			}
+			drawScene(frameIndex, renderExtent);
+			break;
+		}
+		case CaptureRecord::PostProcess: {
+			VkExtent2D renderExtent = readExtent(reader);
+			PostProcessChain::Settings settings;
+			settings.exposure = reader.read<float>();
+			settings.bloomThreshold = reader.read<float>();
+			settings.bloomStrength = reader.read<float>();
+			settings.saturation = reader.read<float>();
+			settings.contrast = reader.read<float>();
+			settings.vignette = reader.read<float>();
+			settings.bloom = reader.read<uint32_t>() != 0;
+			settings.fxaa = reader.read<uint32_t>() != 0;
+			settings.taa = reader.read<uint32_t>() != 0;
+			drawPostProcess(renderExtent, settings);
+			break;
+		}
+		case CaptureRecord::Submit: {
+			if (!recording) {
+				break;
+			}
+			deviceTable.vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+			if (deviceTable.vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to record replay command buffer!");
+			}
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &commandBuffer;
+			if (deviceTable.vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to submit replayed frame!");
+			}
+			deviceTable.vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+			deviceTable.vkResetFences(device, 1, &fence);
+			recording = false;
+			// Queues without timestamps report no GPU time
+			uint64_t timestamps[2] = {};
+			if (timestampValidBits > 0 && deviceTable.vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+				uint64_t mask = timestampValidBits >= 64 ? UINT64_MAX : (1ull << timestampValidBits) - 1;
+				uint64_t ticks = (timestamps[1] - timestamps[0]) & mask;
+				gpuMilliseconds += static_cast<double>(ticks) * deviceProperties.limits.timestampPeriod / 1.0e6;
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	if (recording) {
+		throw std::runtime_error("Frame capture ends without submitting its commands!");
+	}
+	return gpuMilliseconds;
+}
+
+// The application's scene rendering: cleared scene color, motion and depth, and the stress scene's draws
+void FrameReplayer::drawScene(uint32_t frameIndex, VkExtent2D renderExtent) {
+	postProcess.beginScene(commandBuffer, deviceTable);
+	VkImageMemoryBarrier depthBarrier{};
+	depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+	depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.image = depth.image;
+	depthBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	depthBarrier.subresourceRange.levelCount = 1;
+	depthBarrier.subresourceRange.layerCount = 1;
+	VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	deviceTable.vkCmdPipelineBarrier(commandBuffer, depthStages, depthStages, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+	VkRenderingAttachmentInfo sceneAttachments[2];
+	postProcess.getSceneAttachments({ { 0.1f, 0.1f, 0.12f, 1.0f } }, sceneAttachments);
+	VkRenderingAttachmentInfo depthAttachment{};
+	depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachment.imageView = depth.view;
+	depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea.extent = renderExtent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 2;
+	renderingInfo.pColorAttachments = sceneAttachments;
+	renderingInfo.pDepthAttachment = &depthAttachment;
+	deviceTable.vkCmdBeginRendering(commandBuffer, &renderingInfo);
+	uint32_t drawCount = 0;
+	uint64_t triangleCount = 0;
+	stressScene.draw(commandBuffer, deviceTable, frameIndex, renderExtent, drawCount, triangleCount);
+	deviceTable.vkCmdEndRendering(commandBuffer);
+}
+
+// The application's post-processing, into the output image instead of a swap chain image
+void FrameReplayer::drawPostProcess(VkExtent2D renderExtent, const PostProcessChain::Settings& settings) {
+	postProcess.endScene(commandBuffer, deviceTable, renderExtent, settings);
+	postProcess.drawBloom(commandBuffer, deviceTable, settings);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = output.image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+	deviceTable.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkRenderingAttachmentInfo colorAttachment{};
+	colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colorAttachment.imageView = output.view;
+	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea.extent = outputExtent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachment;
+	deviceTable.vkCmdBeginRendering(commandBuffer, &renderingInfo);
+	postProcess.draw(commandBuffer, deviceTable, outputExtent, settings);
+	deviceTable.vkCmdEndRendering(commandBuffer);
+}
+
+void FrameReplayer::cleanup() {
+	vkDeviceWaitIdle(device);
+	stressScene.destroy(device, memoryTelemetry, nullptr);
+	destroyTargets();
+	postProcess.destroy(device, nullptr);
+	vkDestroyQueryPool(device, queryPool, nullptr);
+	vkDestroyFence(device, fence, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+}
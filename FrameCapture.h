@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryTelemetry.h"
+#include "MemoryTypeTable.h"
+#include "PostProcess.h"
+#include "SceneGenerator.h"
+#include "StressScene.h"
+#include "VulkanDispatch.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compact binary capture of one frame at the level the renderer records it: the render targets and stress scene it
+// needs, the per-frame data uploaded into them and its render commands. The scene is captured as its generator
+// parameters, which reproduce it exactly, rather than as its buffers.
+// The file starts with FRAME_CAPTURE_MAGIC and FRAME_CAPTURE_VERSION, followed by records of
+// { uint32_t type, uint32_t payloadSize, payload }.
+const uint32_t FRAME_CAPTURE_MAGIC = 0x4346564B; // "KVFC"
+const uint32_t FRAME_CAPTURE_VERSION = 3;
+
+// Buffers an Upload record can target
+const uint32_t CAPTURE_SCENE_MOTION_ID = 0;
+
+enum class CaptureRecord : uint32_t {
+	// payload: uint32_t width, uint32_t height, VkFormat outputFormat, VkFormat depthFormat, VkSampleCountFlagBits samples
+	CreateTargets = 1,
+	// payload: SceneParameters field by field, uint32_t frameCount
+	CreateScene = 2,
+	// payload: uint32_t id, VkDeviceSize offset, data
+	Upload = 3,
+	// payload: float x, float y. StressScene::setJitter.
+	SetJitter = 4,
+	// payload: uint32_t frameIndex, VkExtent2D renderExtent. StressScene::binLights.
+	BinLights = 5,
+	// payload: uint32_t frameIndex, VkExtent2D renderExtent. The scene's rendering into scene color, motion and depth.
+	DrawScene = 6,
+	// payload: VkExtent2D renderExtent, PostProcessChain::Settings field by field. The post-processing chain into
+	// the output image.
+	PostProcess = 7,
+	// payload: none. One queue submission of the frame's recorded work.
+	Submit = 8,
+	// payload: none
+	EndFrame = 9,
+	// payload: uint64_t frameNumber. StressScene::setFrameNumber, the animation time the scene's motion is relative to.
+	SetSceneFrame = 10,
+};
+
+// Collects records in memory and writes them out in one go, so capturing doesn't stall the frame on file I/O.
+// The HUD isn't captured: it is an operator overlay rather than part of the measured frame.
+class FrameRecorder {
+public:
+	// Start capturing. Resource creation is recorded from here on; frame records only between beginFrame and endFrame.
+	void open(const std::string& path);
+	bool isOpen() const { return !path.empty(); }
+	bool isCapturingFrame() const { return capturingFrame; }
+
+	void recordCreateTargets(VkExtent2D extent, VkFormat outputFormat, VkFormat depthFormat, VkSampleCountFlagBits samples);
+	void recordCreateScene(const SceneParameters& parameters, uint32_t frameCount);
+	void beginFrame();
+	void recordUpload(uint32_t id, VkDeviceSize offset, const void* data, VkDeviceSize size);
+	void recordSetJitter(float x, float y);
+	void recordSetSceneFrame(uint64_t frameNumber);
+	void recordBinLights(uint32_t frameIndex, VkExtent2D renderExtent);
+	void recordDrawScene(uint32_t frameIndex, VkExtent2D renderExtent);
+	void recordPostProcess(VkExtent2D renderExtent, const PostProcessChain::Settings& settings);
+	void recordSubmit();
+	// Ends the captured frame and writes the file
+	void endFrame();
+
+private:
+	// Starts a record whose payload the following appends write: the type's fixed payload plus dataSize bytes
+	void beginRecord(CaptureRecord type, size_t dataSize = 0);
+	// Throws unless the appends since beginRecord wrote exactly the payload it declared
+	void checkRecordEnd() const;
+	template<typename T>
+	void append(const T& value) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	std::string path;
+	std::vector<uint8_t> data;
+	// Where the current record's payload ends
+	size_t recordEnd = 0;
+	bool capturingFrame = false;
+};
+
+// Re-executes a capture headlessly: no window and no surface, the output image stands in for the swap chain image.
+// The targets, scene and post-processing pipelines are created once from the capture's creation records; each
+// iteration then replays the frame's uploads and records its commands into a real command buffer, submits it and
+// waits for the GPU. The average CPU and GPU time per frame are printed.
+class FrameReplayer {
+public:
+	void run(const std::string& path, uint32_t iterations);
+
+private:
+	struct Record {
+		CaptureRecord type;
+		size_t offset;
+		uint32_t size;
+	};
+	struct ReplayImage {
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+	};
+
+	void load(const std::string& path);
+	void createDevice();
+	void createTargets(VkExtent2D extent, VkFormat outputFormat, VkFormat depthFormat, VkSampleCountFlagBits samples);
+	void destroyTargets();
+	void createImage(VkExtent2D extent, VkFormat format, VkSampleCountFlagBits samples, VkImageUsageFlags usage, MemoryUsage memoryUsage, VkImageAspectFlags aspect, ReplayImage& replayImage);
+	void destroyImage(ReplayImage& replayImage);
+	void createScene(const SceneParameters& parameters, uint32_t frameCount);
+	// Replays the frame; returns the GPU milliseconds of its submissions
+	double replayFrame();
+	void drawScene(uint32_t frameIndex, VkExtent2D renderExtent);
+	void drawPostProcess(VkExtent2D renderExtent, const PostProcessChain::Settings& settings);
+	void cleanup();
+
+	std::vector<uint8_t> file;
+	std::vector<Record> setupRecords;
+	std::vector<Record> frameRecords;
+
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties deviceProperties{};
+	uint32_t queueFamily = UINT32_MAX;
+	uint32_t timestampValidBits = 0;
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	InstanceDispatch instanceTable;
+	DeviceDispatch deviceTable;
+	MemoryTypeTable memoryTypes;
+	DeviceMemoryTelemetry memoryTelemetry;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	// Two timestamps around each submission
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+
+	// What the capture's creation records describe
+	VkExtent2D outputExtent = {};
+	VkFormat outputFormat = VK_FORMAT_UNDEFINED;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	uint32_t sceneFrameCount = 0;
+	// Stands in for the swap chain image
+	ReplayImage output;
+	ReplayImage depth;
+	PostProcessChain postProcess;
+	StressScene stressScene;
+};
@@ -0,0 +1,172 @@
+#include "GpuProfiler.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+void GpuProfiler::create(VkDevice device, const DeviceDispatch& dispatch, const VkPhysicalDeviceLimits& limits, uint32_t timestampValidBits, bool pipelineStatistics, uint32_t frameCount, const VkAllocationCallbacks* pAllocator) {
+	this->device = device;
+	this->dispatch = &dispatch;
+	supported = timestampValidBits > 0 && limits.timestampPeriod > 0.0f;
+	if (!supported) {
+		return;
+	}
+	timestampPeriod = limits.timestampPeriod;
+	timestampMask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = QUERIES_PER_FRAME;
+	VkQueryPoolCreateInfo statisticsPoolInfo{};
+	statisticsPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	statisticsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	statisticsPoolInfo.queryCount = MAX_PASSES;
+	statisticsPoolInfo.pipelineStatistics = STATISTICS_FLAGS;
+	statisticsEnabled = pipelineStatistics;
+	slots.resize(frameCount);
+	for (FrameSlot& slot : slots) {
+		if (vkCreateQueryPool(device, &poolInfo, pAllocator, &slot.queryPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create timestamp query pool!");
+		}
+		if (statisticsEnabled && vkCreateQueryPool(device, &statisticsPoolInfo, pAllocator, &slot.statisticsPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create pipeline statistics query pool!");
+		}
+	}
+}
+
+void GpuProfiler::destroy(VkDevice device, const VkAllocationCallbacks* pAllocator) {
+	for (FrameSlot& slot : slots) {
+		vkDestroyQueryPool(device, slot.queryPool, pAllocator);
+		vkDestroyQueryPool(device, slot.statisticsPool, pAllocator);
+	}
+	slots.clear();
+	current = nullptr;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	if (!supported) {
+		return;
+	}
+	current = &slots[frameIndex];
+
+	// The fence guarantees the slot's previous submission is complete, so the results are available without waiting
+	if (current->recorded) {
+		uint64_t timestamps[QUERIES_PER_FRAME];
+		uint32_t queryCount = 2 + 2 * current->passCount;
+		PipelineStatistics statistics[MAX_PASSES] = {};
+		if (statisticsEnabled && current->passCount > 0) {
+			dispatch->vkGetQueryPoolResults(device, current->statisticsPool, 0, current->passCount, sizeof(statistics), statistics, sizeof(PipelineStatistics), VK_QUERY_RESULT_64_BIT);
+		}
+		if (dispatch->vkGetQueryPoolResults(device, current->queryPool, 0, queryCount, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+			frameTime = toMilliseconds(timestamps[0], timestamps[1]);
+			passCount = current->passCount;
+			for (uint32_t i = 0; i < passCount; i++) {
+				passes[i].name = current->passNames[i];
+				passes[i].milliseconds = toMilliseconds(timestamps[2 + 2 * i], timestamps[3 + 2 * i]);
+				passes[i].statistics = statistics[i];
+				accumulate(passes[i]);
+			}
+			totalFrames++;
+			totalFrameTime += frameTime;
+		}
+	}
+
+	current->passCount = 0;
+	current->recorded = true;
+	dispatch->vkCmdResetQueryPool(commandBuffer, current->queryPool, 0, QUERIES_PER_FRAME);
+	if (statisticsEnabled) {
+		dispatch->vkCmdResetQueryPool(commandBuffer, current->statisticsPool, 0, MAX_PASSES);
+	}
+	dispatch->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current->queryPool, 0);
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+	if (!supported) {
+		return;
+	}
+	dispatch->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current->queryPool, 1);
+}
+
+void GpuProfiler::beginPass(VkCommandBuffer commandBuffer, const char* name) {
+	if (!supported || current->passCount == MAX_PASSES) {
+		return;
+	}
+	current->passNames[current->passCount] = name;
+	dispatch->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current->queryPool, 2 + 2 * current->passCount);
+	if (statisticsEnabled) {
+		dispatch->vkCmdBeginQuery(commandBuffer, current->statisticsPool, current->passCount, 0);
+	}
+}
+
+void GpuProfiler::endPass(VkCommandBuffer commandBuffer) {
+	if (!supported || current->passCount == MAX_PASSES) {
+		return;
+	}
+	if (statisticsEnabled) {
+		dispatch->vkCmdEndQuery(commandBuffer, current->statisticsPool, current->passCount);
+	}
+	dispatch->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current->queryPool, 3 + 2 * current->passCount);
+	current->passCount++;
+}
+
+double GpuProfiler::toMilliseconds(uint64_t begin, uint64_t end) const {
+	// Counters narrower than 64 bits wrap, so the difference is taken modulo the valid bits
+	uint64_t ticks = (end - begin) & timestampMask;
+	return static_cast<double>(ticks) * timestampPeriod / 1000000.0;
+}
+
+void GpuProfiler::accumulate(const PassTiming& pass) {
+	PassTotals* entry = nullptr;
+	for (uint32_t i = 0; i < totalCount; i++) {
+		if (strcmp(totals[i].name, pass.name) == 0) {
+			entry = &totals[i];
+			break;
+		}
+	}
+	if (entry == nullptr) {
+		if (totalCount == MAX_PASSES) {
+			return;
+		}
+		entry = &totals[totalCount++];
+		entry->name = pass.name;
+	}
+	entry->frames++;
+	entry->milliseconds += pass.milliseconds;
+	entry->statistics.inputAssemblyVertices += pass.statistics.inputAssemblyVertices;
+	entry->statistics.inputAssemblyPrimitives += pass.statistics.inputAssemblyPrimitives;
+	entry->statistics.vertexShaderInvocations += pass.statistics.vertexShaderInvocations;
+	entry->statistics.clippingInvocations += pass.statistics.clippingInvocations;
+	entry->statistics.clippingPrimitives += pass.statistics.clippingPrimitives;
+	entry->statistics.fragmentShaderInvocations += pass.statistics.fragmentShaderInvocations;
+	entry->statistics.computeShaderInvocations += pass.statistics.computeShaderInvocations;
+}
+
+void GpuProfiler::writeJson(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	file << "{\n  \"frames\": " << totalFrames << ",\n";
+	file << "  \"averageFrameMs\": " << (totalFrames > 0 ? totalFrameTime / totalFrames : 0.0) << ",\n";
+	file << "  \"pipelineStatistics\": " << (statisticsEnabled ? "true" : "false") << ",\n";
+	file << "  \"passes\": [";
+	for (uint32_t i = 0; i < totalCount; i++) {
+		const PassTotals& pass = totals[i];
+		double frames = static_cast<double>(pass.frames);
+		const PipelineStatistics& statistics = pass.statistics;
+		// Shaded fragments per primitive that survived clipping: high for fill bound passes, low for geometry bound ones
+		double fragmentsPerPrimitive = statistics.clippingPrimitives > 0 ? static_cast<double>(statistics.fragmentShaderInvocations) / statistics.clippingPrimitives : 0.0;
+		file << (i ? "," : "") << "\n    { \"name\": \"" << pass.name << "\", \"frames\": " << pass.frames
+			<< ", \"averageMs\": " << pass.milliseconds / frames;
+		if (statisticsEnabled) {
+			file << ", \"inputAssemblyVertices\": " << statistics.inputAssemblyVertices / frames
+				<< ", \"inputAssemblyPrimitives\": " << statistics.inputAssemblyPrimitives / frames
+				<< ", \"vertexShaderInvocations\": " << statistics.vertexShaderInvocations / frames
+				<< ", \"clippingInvocations\": " << statistics.clippingInvocations / frames
+				<< ", \"clippingPrimitives\": " << statistics.clippingPrimitives / frames
+				<< ", \"fragmentShaderInvocations\": " << statistics.fragmentShaderInvocations / frames
+				<< ", \"computeShaderInvocations\": " << statistics.computeShaderInvocations / frames
+				<< ", \"fragmentsPerPrimitive\": " << fragmentsPerPrimitive;
+		}
+		file << " }";
+	}
+	file << "\n  ]\n}\n";
+}
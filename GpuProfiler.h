@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanDispatch.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GPU timestamps around the frame and each named pass, with one query pool per frame in flight.
+// When the device supports pipelineStatisticsQuery, each pass is also wrapped in a pipeline statistics query.
+// A slot's results are read back when the slot is reused, after its fence has signalled, so reading never waits
+// on the GPU and the reported timings trail the frame being recorded by MAX_FRAMES_IN_FLIGHT frames.
+class GpuProfiler {
+public:
+	static constexpr uint32_t MAX_PASSES = 16;
+
+	// Counters of one pass, in the order the statistics query returns them.
+	// Many fragments per primitive point at a fill bound pass, many vertices and few fragments at a geometry bound one.
+	struct PipelineStatistics {
+		uint64_t inputAssemblyVertices;
+		uint64_t inputAssemblyPrimitives;
+		uint64_t vertexShaderInvocations;
+		uint64_t clippingInvocations;
+		uint64_t clippingPrimitives;
+		uint64_t fragmentShaderInvocations;
+		uint64_t computeShaderInvocations;
+	};
+
+	struct PassTiming {
+		// Must point at a string that outlives the profiler, normally a literal
+		const char* name;
+		double milliseconds;
+		// Zero unless hasPipelineStatistics()
+		PipelineStatistics statistics;
+	};
+
+	// timestampValidBits comes from the queue family the command buffers are submitted to; 0 disables the profiler.
+	// pipelineStatistics requires the pipelineStatisticsQuery feature to be enabled on the device.
+	void create(VkDevice device, const DeviceDispatch& dispatch, const VkPhysicalDeviceLimits& limits, uint32_t timestampValidBits, bool pipelineStatistics, uint32_t frameCount, const VkAllocationCallbacks* pAllocator);
+	void destroy(VkDevice device, const VkAllocationCallbacks* pAllocator);
+
+	// Collect the results frameIndex recorded last time round and reset its queries.
+	// Record before any render pass begins, after the slot's fence has signalled.
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	void endFrame(VkCommandBuffer commandBuffer);
+	// Passes may not nest
+	void beginPass(VkCommandBuffer commandBuffer, const char* name);
+	void endPass(VkCommandBuffer commandBuffer);
+
+	bool isSupported() const { return supported; }
+	bool hasPipelineStatistics() const { return statisticsEnabled; }
+	// Timings of the most recently completed frame
+	double getFrameTime() const { return frameTime; }
+	uint32_t getPassCount() const { return passCount; }
+	const PassTiming& getPass(uint32_t index) const { return passes[index]; }
+
+	// Per-pass averages over every frame collected so far, for benchmark results
+	void writeJson(const std::string& path) const;
+
+private:
+	// Query 0 and 1 bracket the frame, queries 2 + 2i and 3 + 2i pass i
+	static constexpr uint32_t QUERIES_PER_FRAME = 2 + 2 * MAX_PASSES;
+	static constexpr VkQueryPipelineStatisticFlags STATISTICS_FLAGS = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+	struct FrameSlot {
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		// Query i is pass i
+		VkQueryPool statisticsPool = VK_NULL_HANDLE;
+		const char* passNames[MAX_PASSES] = {};
+		uint32_t passCount = 0;
+		// False until the slot has been submitted once
+		bool recorded = false;
+	};
+
+	// Sums over the run, matched by pass name
+	struct PassTotals {
+		const char* name;
+		uint64_t frames;
+		double milliseconds;
+		PipelineStatistics statistics;
+	};
+
+	double toMilliseconds(uint64_t begin, uint64_t end) const;
+	void accumulate(const PassTiming& pass);
+
+	const DeviceDispatch* dispatch = nullptr;
+	VkDevice device = VK_NULL_HANDLE;
+	std::vector<FrameSlot> slots;
+	FrameSlot* current = nullptr;
+	bool supported = false;
+	bool statisticsEnabled = false;
+	double timestampPeriod = 1.0;
+	uint64_t timestampMask = ~0ull;
+
+	double frameTime = 0.0;
+	PassTiming passes[MAX_PASSES] = {};
+	uint32_t passCount = 0;
+
+	PassTotals totals[MAX_PASSES] = {};
+	uint32_t totalCount = 0;
+	uint64_t totalFrames = 0;
+	double totalFrameTime = 0.0;
+};
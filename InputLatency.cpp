@@ -0,0 +1,218 @@
+#include "InputLatency.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#define GLFW_EXPOSE_NATIVE_WIN32
+	#include <GLFW/glfw3native.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+	const char* STAGE_NAMES[] = { "injected", "received", "simulated", "recorded", "submitted", "presented", "completed" };
+
+	double millisecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+		return std::chrono::duration<double, std::milli>(to - from).count();
+	}
+}
+
+void InputLatencyHarness::start(uint32_t eventCount, uint32_t intervalFrames, double maxP99Milliseconds) {
+#ifndef _WIN32
+	throw std::runtime_error("The input latency test mode is only supported on Windows!");
+#endif
+	active = true;
+	this->eventCount = eventCount;
+	this->intervalFrames = std::max(intervalFrames, 1u);
+	this->maxP99Milliseconds = maxP99Milliseconds;
+}
+
+void InputLatencyHarness::injectInput(GLFWwindow* window, uint64_t frameNumber) {
+	if (!active) {
+		return;
+	}
+	auto now = Clock::now();
+	if (releasePending) {
+		platformInject(window, false);
+		releasePending = false;
+	}
+	// Presses the window never delivered would otherwise hold their slot forever
+	for (Event& event : events) {
+		if (event.inUse && event.stage == Stage::Injected && millisecondsBetween(event.times[0], now) > DROP_TIMEOUT_MILLISECONDS) {
+			event.inUse = false;
+			droppedCount++;
+		}
+	}
+	if (injectedCount == eventCount || frameNumber % intervalFrames != 0) {
+		return;
+	}
+	for (Event& event : events) {
+		if (!event.inUse) {
+			event.inUse = true;
+			event.stage = Stage::Injected;
+			event.times[0] = now;
+			injectedCount++;
+			platformInject(window, true);
+			releasePending = true;
+			return;
+		}
+	}
+}
+
+bool InputLatencyHarness::onKey(int key, int action) {
+	if (!active || key != PROBE_KEY) {
+		return false;
+	}
+	if (action != GLFW_PRESS) {
+		return true;
+	}
+	// Presses are delivered in order, so this one belongs to the oldest injected event
+	auto now = Clock::now();
+	Event* oldest = nullptr;
+	for (Event& event : events) {
+		if (event.inUse && event.stage == Stage::Injected && (oldest == nullptr || event.times[0] < oldest->times[0])) {
+			oldest = &event;
+		}
+	}
+	if (oldest != nullptr) {
+		oldest->stage = Stage::Received;
+		oldest->times[static_cast<uint32_t>(Stage::Received)] = now;
+	}
+	return true;
+}
+
+void InputLatencyHarness::markStage(Stage stage, uint32_t frameIndex) {
+	if (!active) {
+		return;
+	}
+	auto now = Clock::now();
+	Stage waiting = static_cast<Stage>(static_cast<uint32_t>(stage) - 1);
+	for (Event& event : events) {
+		if (event.inUse && event.stage == waiting) {
+			event.stage = stage;
+			event.times[static_cast<uint32_t>(stage)] = now;
+			if (stage == Stage::Submitted) {
+				event.frameIndex = frameIndex;
+			}
+		}
+	}
+}
+
+void InputLatencyHarness::pollCompletion(const DeviceDispatch& dispatch, VkDevice device, const VkFence* fences) {
+	if (!active) {
+		return;
+	}
+	auto now = Clock::now();
+	for (Event& event : events) {
+		if (event.inUse && event.stage == Stage::Presented && dispatch.vkGetFenceStatus(device, fences[event.frameIndex]) == VK_SUCCESS) {
+			complete(event, now);
+		}
+	}
+}
+
+void InputLatencyHarness::complete(Event& event, Clock::time_point now) {
+	const uint32_t completed = static_cast<uint32_t>(Stage::Completed);
+	event.times[completed] = now;
+	for (uint32_t stage = 1; stage <= completed; stage++) {
+		stageMilliseconds[stage] += millisecondsBetween(event.times[stage - 1], event.times[stage]);
+	}
+	double total = millisecondsBetween(event.times[0], now);
+	uint32_t bucket = std::min(static_cast<uint32_t>(total / BUCKET_MILLISECONDS), BUCKET_COUNT - 1);
+	histogram[bucket]++;
+	minMilliseconds = completedCount == 0 ? total : std::min(minMilliseconds, total);
+	maxMilliseconds = std::max(maxMilliseconds, total);
+	completedCount++;
+	event.inUse = false;
+}
+
+double InputLatencyHarness::getPercentile(double percentile) const {
+	if (completedCount == 0) {
+		return 0.0;
+	}
+	// Upper edge of the bucket holding the percentile, so the estimate never flatters the result
+	uint64_t target = static_cast<uint64_t>(percentile / 100.0 * completedCount + 0.5);
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+		seen += histogram[i];
+		if (seen >= std::max<uint64_t>(target, 1)) {
+			return (i + 1) * BUCKET_MILLISECONDS;
+		}
+	}
+	return BUCKET_COUNT * BUCKET_MILLISECONDS;
+}
+
+bool InputLatencyHarness::passed() const {
+	if (!active) {
+		return true;
+	}
+	return droppedCount == 0 && completedCount > 0 && (maxP99Milliseconds <= 0.0 || getPercentile(99.0) <= maxP99Milliseconds);
+}
+
+void InputLatencyHarness::print(std::ostream& out) const {
+	if (!active) {
+		return;
+	}
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(2);
+	out << "Input to present latency over " << completedCount << " events (" << droppedCount << " dropped):" << std::endl;
+	if (completedCount > 0) {
+		out << "  min " << minMilliseconds << " ms, p50 " << getPercentile(50.0) << " ms, p95 " << getPercentile(95.0)
+			<< " ms, p99 " << getPercentile(99.0) << " ms, max " << maxMilliseconds << " ms" << std::endl;
+		for (uint32_t stage = 1; stage < static_cast<uint32_t>(Stage::Count); stage++) {
+			out << "  " << std::setw(9) << STAGE_NAMES[stage] << ": " << stageMilliseconds[stage] / completedCount << " ms average" << std::endl;
+		}
+	}
+	if (maxP99Milliseconds > 0.0) {
+		out << "  Gate p99 <= " << maxP99Milliseconds << " ms: " << (passed() ? "passed" : "FAILED") << std::endl;
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void InputLatencyHarness::writeJson(const std::string& path) const {
+	if (!active) {
+		return;
+	}
+	std::ofstream file(path, std::ios::trunc);
+	file << "{\n  \"events\": " << completedCount << ",\n  \"dropped\": " << droppedCount << ",\n";
+	file << "  \"p50Ms\": " << getPercentile(50.0) << ",\n  \"p95Ms\": " << getPercentile(95.0) << ",\n  \"p99Ms\": " << getPercentile(99.0) << ",\n";
+	file << "  \"minMs\": " << minMilliseconds << ",\n  \"maxMs\": " << maxMilliseconds << ",\n";
+	file << "  \"passed\": " << (passed() ? "true" : "false") << ",\n";
+	file << "  \"stagesMs\": {";
+	for (uint32_t stage = 1; stage < static_cast<uint32_t>(Stage::Count); stage++) {
+		file << (stage > 1 ? ", " : " ") << "\"" << STAGE_NAMES[stage] << "\": " << (completedCount > 0 ? stageMilliseconds[stage] / completedCount : 0.0);
+	}
+	file << " },\n";
+	// Only non-empty buckets, as [upper edge ms, count]
+	file << "  \"histogram\": [";
+	bool first = true;
+	for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+		if (histogram[i] > 0) {
+			file << (first ? "" : ", ") << "[" << (i + 1) * BUCKET_MILLISECONDS << ", " << histogram[i] << "]";
+			first = false;
+		}
+	}
+	file << "]\n}\n";
+}
+
+// The press goes through the same OS queue glfwPollEvents() drains, with the scancode GLFW translates to PROBE_KEY
+void InputLatencyHarness::platformInject(GLFWwindow* window, bool press) {
+#ifdef _WIN32
+	const LPARAM F12_SCANCODE = 0x58;
+	LPARAM lParam = 1 | (F12_SCANCODE << 16);
+	if (!press) {
+		// Previous key state down, transition state up
+		lParam |= (static_cast<LPARAM>(1) << 30) | (static_cast<LPARAM>(1) << 31);
+	}
+	PostMessageW(glfwGetWin32Window(window), press ? WM_KEYDOWN : WM_KEYUP, VK_F12, lParam);
+#else
+	// start() refuses to run anywhere else
+	(void)window;
+	(void)press;
+#endif
+}
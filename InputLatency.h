@@ -0,0 +1,97 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "VulkanDispatch.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Input-to-present latency test mode.
+// Synthetic key presses are posted to the window through the platform's own event queue, so they arrive through
+// glfwPollEvents() exactly like real input. Each one is timestamped at every stage of the frame that consumes it:
+//  injected -> received (key callback) -> simulated (frame begins) -> recorded -> submitted -> presented -> completed
+// Completion is when the frame's fence is seen signalled: the GPU has finished the image and handed it to the
+// presentation engine. Totals go into a fixed histogram, and the run can be gated on its 99th percentile.
+//
+// Presses are posted as window messages, so the mode is Windows only, like the project's build; start() throws
+// elsewhere. Nothing here allocates once started, so it doesn't disturb the frame loop it measures.
+class InputLatencyHarness {
+public:
+	// Key used for the synthetic presses. While the harness runs, the application doesn't see it.
+	static constexpr int PROBE_KEY = GLFW_KEY_F12;
+	// Events in flight at once
+	static constexpr uint32_t MAX_PENDING = 16;
+	// Histogram of total latency: 0.25 ms buckets up to 100 ms, the last bucket holds everything slower
+	static constexpr double BUCKET_MILLISECONDS = 0.25;
+	static constexpr uint32_t BUCKET_COUNT = 400;
+	// An injected press not seen by the key callback within this long is counted as dropped
+	static constexpr double DROP_TIMEOUT_MILLISECONDS = 1000.0;
+
+	enum class Stage : uint32_t {
+		Injected,
+		Received,
+		Simulated,
+		Recorded,
+		Submitted,
+		Presented,
+		Completed,
+		Count
+	};
+
+	// eventCount presses, one every intervalFrames frames. A maxP99Milliseconds of 0 disables the gate.
+	void start(uint32_t eventCount, uint32_t intervalFrames, double maxP99Milliseconds);
+	bool isActive() const { return active; }
+	// Every event has completed or been dropped
+	bool isFinished() const { return active && completedCount + droppedCount == eventCount; }
+
+	// Call once per frame before glfwPollEvents(); injects the next press when it is due
+	void injectInput(GLFWwindow* window, uint64_t frameNumber);
+	// Call from the key callback. Returns true if the key was a probe and must not be handled.
+	bool onKey(int key, int action);
+	// Advance every event waiting on stage to it. Submitted also records the frame slot whose fence completes it.
+	void markStage(Stage stage, uint32_t frameIndex = 0);
+	// Complete events whose frame fences have signalled
+	void pollCompletion(const DeviceDispatch& dispatch, VkDevice device, const VkFence* fences);
+
+	// Percentile of total latency in milliseconds, at bucket resolution
+	double getPercentile(double percentile) const;
+	// True unless the gate is enabled and the 99th percentile exceeded it, or events were dropped
+	bool passed() const;
+	void print(std::ostream& out) const;
+	void writeJson(const std::string& path) const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Event {
+		bool inUse = false;
+		Stage stage = Stage::Injected;
+		uint32_t frameIndex = 0;
+		Clock::time_point times[static_cast<uint32_t>(Stage::Count)];
+	};
+
+	void platformInject(GLFWwindow* window, bool press);
+	void complete(Event& event, Clock::time_point now);
+
+	bool active = false;
+	uint32_t eventCount = 0;
+	uint32_t intervalFrames = 1;
+	double maxP99Milliseconds = 0.0;
+
+	Event events[MAX_PENDING];
+	uint32_t injectedCount = 0;
+	uint32_t completedCount = 0;
+	uint32_t droppedCount = 0;
+	// A release is posted the frame after each press, so the window sees a normal key stroke
+	bool releasePending = false;
+
+	uint32_t histogram[BUCKET_COUNT] = {};
+	// Summed milliseconds from the previous stage to each stage, over completed events
+	double stageMilliseconds[static_cast<uint32_t>(Stage::Count)] = {};
+	double minMilliseconds = 0.0;
+	double maxMilliseconds = 0.0;
+};
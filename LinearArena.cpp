@@ -0,0 +1,83 @@
+#include "LinearArena.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+static size_t alignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void* LinearArena::allocate(size_t size, size_t alignment) {
+	// Align the address rather than the offset, the block itself may be less aligned than requested
+	uintptr_t address = reinterpret_cast<uintptr_t>(base) + head;
+	size_t offset = head + (alignUp(address, alignment) - address);
+	if (offset + size > capacity) {
+		throw std::bad_alloc();
+	}
+	head = offset + size;
+	return base + offset;
+}
+
+const char* LinearArena::format(const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	va_list measure;
+	va_copy(measure, args);
+	int length = vsnprintf(nullptr, 0, fmt, measure);
+	va_end(measure);
+	if (length < 0) {
+		va_end(args);
+		return "";
+	}
+	char* text = static_cast<char*>(allocate(static_cast<size_t>(length) + 1, 1));
+	vsnprintf(text, static_cast<size_t>(length) + 1, fmt, args);
+	va_end(args);
+	return text;
+}
+
+FrameArena::~FrameArena() {
+	destroy();
+}
+
+void FrameArena::create(size_t bytesPerFrame, uint32_t frameCount) {
+	frameSize = bytesPerFrame;
+	blocks.resize(frameCount);
+	for (uint8_t*& block : blocks) {
+		block = static_cast<uint8_t*>(malloc(frameSize));
+		if (block == nullptr) {
+			throw std::bad_alloc();
+		}
+	}
+	beginFrame(0);
+}
+
+void FrameArena::destroy() {
+	for (uint8_t* block : blocks) {
+		free(block);
+	}
+	blocks.clear();
+	current = nullptr;
+}
+
+void FrameArena::beginFrame(uint32_t frameIndex) {
+	current = blocks[frameIndex];
+	head.store(0, std::memory_order_relaxed);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+	// Blocks come from malloc, so aligning the offset is enough for alignments up to max_align_t
+	size_t offset = head.load(std::memory_order_relaxed);
+	size_t aligned;
+	do {
+		aligned = alignUp(offset, alignment);
+		if (aligned + size > frameSize) {
+			throw std::bad_alloc();
+		}
+	} while (!head.compare_exchange_weak(offset, aligned + size, std::memory_order_relaxed));
+	return current + aligned;
+}
+
+LinearArena FrameArena::acquireWorkerArena(size_t size) {
+	return LinearArena(allocate(size), size);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Bump allocator over a block of memory it does not own. Not thread safe; give each thread its own.
+// Nothing is freed individually, the whole arena is reset at once.
+class LinearArena {
+public:
+	LinearArena() = default;
+	LinearArena(void* memory, size_t capacity) : base(static_cast<uint8_t*>(memory)), capacity(capacity) {}
+
+	// Throws std::bad_alloc when the arena is full
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	// Uninitialised storage for count objects of T. Only use for trivially destructible types, destructors never run.
+	template<typename T>
+	T* allocateArray(size_t count) {
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// printf style formatting into arena memory, valid until the arena is reset
+	const char* format(const char* fmt, ...);
+
+	void reset() { head = 0; }
+	size_t getUsed() const { return head; }
+	size_t getCapacity() const { return capacity; }
+
+private:
+	uint8_t* base = nullptr;
+	size_t capacity = 0;
+	size_t head = 0;
+};
+
+// Lets standard containers draw from a LinearArena, e.g. std::vector<T, ArenaAllocator<T>>.
+// Growth still copies, so reserve up front, but no step touches the heap. deallocate is a no-op.
+template<typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	explicit ArenaAllocator(LinearArena& arena) : arena(&arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) { return arena->allocateArray<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+	template<typename U>
+	friend class ArenaAllocator;
+	LinearArena* arena;
+};
+
+// Transient CPU memory for one frame in flight: culling results, draw packets, barrier lists, temporary strings.
+// Each frame slot has its own block, reset wholesale once the slot's fence has signalled, so the frame loop never
+// calls new/delete for transient data. Worker threads carve a private sub-arena out of the slot with one atomic
+// operation and then allocate from it without synchronisation.
+class FrameArena {
+public:
+	FrameArena() = default;
+	~FrameArena();
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void create(size_t bytesPerFrame, uint32_t frameCount);
+	void destroy();
+
+	// Reset the block owned by frameIndex. Only call after that frame's fence has signalled.
+	void beginFrame(uint32_t frameIndex);
+
+	// Thread safe allocation from the current frame's block
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	template<typename T>
+	T* allocateArray(size_t count) {
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// Hand a worker thread its own arena for the rest of the frame
+	LinearArena acquireWorkerArena(size_t size);
+
+	size_t getUsed() const { return head.load(std::memory_order_relaxed); }
+	size_t getCapacity() const { return frameSize; }
+	uint32_t getFrameCount() const { return static_cast<uint32_t>(blocks.size()); }
+
+private:
+	std::vector<uint8_t*> blocks;
+	size_t frameSize = 0;
+	uint8_t* current = nullptr;
+	std::atomic<size_t> head{ 0 };
+};
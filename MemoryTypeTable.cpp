@@ -0,0 +1,126 @@
+#include "MemoryTypeTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Mappable device local heaps at or below this size are the legacy BAR aperture rather than Resizable BAR.
+static const VkDeviceSize LEGACY_BAR_SIZE = 256ull * 1024 * 1024;
+
+// Score a memory type for a usage. Negative means the type cannot be used at all.
+static int scoreMemoryType(MemoryUsage usage, VkMemoryPropertyFlags flags) {
+	const bool deviceLocal = flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	const bool hostVisible = flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	const bool hostCoherent = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	const bool hostCached = flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	const bool lazy = flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+	// Lazily allocated memory can only back transient attachments
+	if (lazy && usage != MemoryUsage::Transient) {
+		return -1;
+	}
+
+	switch (usage) {
+	case MemoryUsage::GpuOnly:
+		// Prefer VRAM, and keep the mappable VRAM free for Dynamic data
+		return (deviceLocal ? 4 : 0) + (hostVisible ? 0 : 1);
+	case MemoryUsage::Upload:
+		// Plain write-combined system memory is the ideal staging source
+		if (!hostVisible || !hostCoherent) {
+			return -1;
+		}
+		return (deviceLocal ? 0 : 2) + (hostCached ? 0 : 1);
+	case MemoryUsage::Readback:
+		// Cached memory makes CPU reads fast
+		if (!hostVisible) {
+			return -1;
+		}
+		return (hostCached ? 4 : 0) + (hostCoherent ? 2 : 0) + (deviceLocal ? 0 : 1);
+	case MemoryUsage::Dynamic:
+		// Mappable VRAM lets the GPU read per-frame data without crossing PCIe on every access
+		if (!hostVisible || !hostCoherent) {
+			return -1;
+		}
+		return (deviceLocal ? 4 : 0) + (hostCached ? 0 : 1);
+	case MemoryUsage::Transient:
+		// Without lazily allocated memory, the same as GpuOnly
+		return (lazy ? 8 : 0) + (deviceLocal ? 4 : 0) + (hostVisible ? 0 : 1);
+	case MemoryUsage::DirectUpload:
+		// Mappable VRAM, coherent where possible so the writes need no flush
+		if (!hostVisible) {
+			return -1;
+		}
+		return (deviceLocal ? 4 : 0) + (hostCoherent ? 2 : 0) + (hostCached ? 0 : 1);
+	default:
+		return -1;
+	}
+}
+
+void MemoryTypeTable::build(VkPhysicalDevice physicalDevice) {
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+	// Only consider the core property flags; lazily allocated, protected and vendor specific types are opted into explicitly.
+	const VkMemoryPropertyFlags knownFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	lazilyAllocated = false;
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+			lazilyAllocated = true;
+		}
+	}
+
+	for (uint32_t usage = 0; usage < static_cast<uint32_t>(MemoryUsage::Count); usage++) {
+		std::vector<std::pair<int, uint32_t>> scored;
+		// Transient attachments opt into lazily allocated memory
+		const VkMemoryPropertyFlags allowedFlags = knownFlags | (usage == static_cast<uint32_t>(MemoryUsage::Transient) ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+			if (flags & ~allowedFlags) {
+				continue;
+			}
+			int score = scoreMemoryType(static_cast<MemoryUsage>(usage), flags);
+			if (score >= 0) {
+				scored.push_back({ score, i });
+			}
+		}
+		// Highest score first; equal scores keep the driver's ordering
+		std::stable_sort(scored.begin(), scored.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+		candidates[usage].clear();
+		for (const auto& entry : scored) {
+			candidates[usage].push_back(entry.second);
+		}
+	}
+
+	// Detect host visible device local heaps. A discrete GPU exposing more than the legacy window has Resizable BAR,
+	// and a device whose only heaps are device local is UMA, where every mappable type is already "VRAM".
+	bool resizableBar = false;
+	bool allHeapsDeviceLocal = true;
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+		if (!(memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
+			allHeapsDeviceLocal = false;
+		}
+	}
+	bool mappableDeviceLocal = false;
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		const VkMemoryType& type = memProperties.memoryTypes[i];
+		const VkMemoryPropertyFlags wanted = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		if ((type.propertyFlags & wanted) == wanted && !(type.propertyFlags & ~knownFlags)) {
+			mappableDeviceLocal = true;
+			if (!allHeapsDeviceLocal && memProperties.memoryHeaps[type.heapIndex].size > LEGACY_BAR_SIZE) {
+				resizableBar = true;
+			}
+		}
+	}
+	directWrites = resizableBar || (allHeapsDeviceLocal && mappableDeviceLocal);
+}
+
+uint32_t MemoryTypeTable::find(MemoryUsage usage, uint32_t memoryTypeBits) const {
+	for (uint32_t index : candidates[static_cast<uint32_t>(usage)]) {
+		if (memoryTypeBits & (1u << index)) {
+			return index;
+		}
+	}
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+bool MemoryTypeTable::isHostCoherent(uint32_t memoryTypeIndex) const {
+	return memProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// What an allocation is used for. Each usage maps to a ranked list of memory types.
+enum class MemoryUsage : uint32_t {
+	// Only touched by the GPU (render targets, static meshes and textures uploaded through staging)
+	GpuOnly = 0,
+	// Written once by the CPU and copied from by the GPU (staging buffers)
+	Upload,
+	// Written by the GPU and read back on the CPU
+	Readback,
+	// Rewritten by the CPU every frame and read directly by the GPU (uniform ring, per-frame data)
+	Dynamic,
+	// Attachments whose contents never leave the rendering they are used in (TRANSIENT_ATTACHMENT images). Lazily
+	// allocated memory comes first: tile-based GPUs keep such attachments in tile memory and never back them at all.
+	Transient,
+	// Static GPU data the CPU writes once, straight into mappable device local memory. Only worth it where
+	// supportsDirectWrites(); may be non-coherent, so writes are flushed unless isHostCoherent().
+	DirectUpload,
+	Count
+};
+
+// Memory type selection computed once per physical device.
+// Instead of searching memoryTypes on every allocation, each usage keeps its candidate types ordered by preference,
+// and an allocation just picks the first candidate allowed by the resource's memoryTypeBits.
+class MemoryTypeTable {
+public:
+	void build(VkPhysicalDevice physicalDevice);
+
+	// Best memory type for usage that is allowed by memoryTypeBits. Throws if there is none.
+	uint32_t find(MemoryUsage usage, uint32_t memoryTypeBits) const;
+
+	// True if device local memory can be mapped beyond the legacy 256 MiB BAR window (Resizable BAR / Smart Access Memory),
+	// or the device is UMA. GPU-only data can then be written directly instead of going through a staging copy.
+	bool supportsDirectWrites() const { return directWrites; }
+	bool isHostCoherent(uint32_t memoryTypeIndex) const;
+	// True if the device has lazily allocated memory, which Transient allocations then use
+	bool hasLazilyAllocated() const { return lazilyAllocated; }
+
+	const VkPhysicalDeviceMemoryProperties& getProperties() const { return memProperties; }
+
+private:
+	VkPhysicalDeviceMemoryProperties memProperties{};
+	std::vector<uint32_t> candidates[static_cast<uint32_t>(MemoryUsage::Count)];
+	bool directWrites = false;
+	bool lazilyAllocated = false;
+};
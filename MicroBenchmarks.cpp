@@ -0,0 +1,547 @@
+// Subsystem microbenchmarks, built as their own executable by MicroBenchmarks.vcxproj.
+// Whole-frame numbers say that something got slower; these say which layer. Each benchmark drives one subsystem
+// through its public interface, headlessly, and reports the median of SAMPLES runs after a warmup run.
+//
+// Usage: MicroBenchmarks [allocators] [upload] [descriptors] [pipelines] [frame] [--any-device]
+// With no group named, every group runs. Results are printed and written to microbenchmarks.json.
+//
+// Results are only comparable between runs on the same driver, so a software rasterizer (lavapipe, SwiftShader)
+// is required unless --any-device is given: it behaves the same on every CI machine and has no clocks to ramp.
+// Mesa drivers keep their own on-disk shader cache under the application's; set MESA_SHADER_CACHE_DISABLE=true
+// for cold pipeline numbers that really are cold.
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryTelemetry.h"
+#include "LinearArena.h"
+#include "MemoryTypeTable.h"
+#include "PostProcess.h"
+#include "SceneGenerator.h"
+#include "StressScene.h"
+#include "ThreadScalingStudy.h"
+#include "VulkanDispatch.h"
+#include "VulkanHostAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+	const uint32_t SAMPLES = 15;
+	const std::string RESULTS_JSON_PATH = "microbenchmarks.json";
+
+	// Operations per sample, enough that one sample takes well over the clock's resolution
+	const uint32_t ARENA_ALLOCATIONS = 100000;
+	const uint32_t HOST_ALLOCATIONS = 10000;
+	// Command scoped blocks outstanding at once, as within one driver call; well inside the host allocator's arena
+	const uint32_t HOST_COMMAND_BATCH = 1000;
+	const uint32_t DEVICE_ALLOCATIONS = 64;
+	const VkDeviceSize DEVICE_ALLOCATION_SIZE = 256 * 1024;
+	const uint32_t DESCRIPTOR_SETS = 1024;
+	const VkDeviceSize UPLOAD_SIZES[] = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+	// Objects in the scene culled, sorted and recorded by the frame group
+	const uint32_t FRAME_OBJECTS = 100000;
+	const VkExtent2D FRAME_EXTENT = { 1920, 1080 };
+
+	using Clock = std::chrono::steady_clock;
+
+	struct BenchmarkResult {
+		std::string name;
+		double value;
+		const char* unit;
+	};
+}
+
+class MicroBenchmarkSuite {
+public:
+	void run(const std::vector<std::string>& groups, bool anyDevice);
+
+private:
+	// Median milliseconds of body over SAMPLES runs, after one untimed run
+	template<typename Body>
+	double measure(Body body) {
+		body();
+		double samples[SAMPLES];
+		for (double& sample : samples) {
+			Clock::time_point start = Clock::now();
+			body();
+			sample = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+		std::nth_element(samples, samples + SAMPLES / 2, samples + SAMPLES);
+		return samples[SAMPLES / 2];
+	}
+
+	void addLatency(const std::string& name, double milliseconds, uint32_t operations);
+	void addThroughput(const std::string& name, double milliseconds, VkDeviceSize bytes);
+
+	void createDevice(bool anyDevice);
+	void destroyDevice();
+	VkFormat findDepthFormat();
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memoryUsage, MemoryCategory category, VkBuffer& buffer, VkDeviceMemory& memory);
+	void submitAndWait(VkCommandBuffer commandBuffer);
+
+	void benchmarkAllocators();
+	void benchmarkStagingUpload();
+	void benchmarkDescriptorAllocation();
+	void benchmarkPipelineCreation();
+	void benchmarkFrameStages();
+
+	void print(std::ostream& out) const;
+	void writeJson(const std::string& path) const;
+
+	// Host memory for every Vulkan object goes through hostAllocator, so it is declared first and destroyed last
+	VulkanHostAllocator hostAllocator;
+	const VkAllocationCallbacks* allocator = hostAllocator.getCallbacks();
+
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties deviceProperties{};
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t queueFamily = UINT32_MAX;
+	VkQueue queue = VK_NULL_HANDLE;
+	InstanceDispatch instanceTable;
+	DeviceDispatch deviceTable;
+	MemoryTypeTable memoryTypes;
+	DeviceMemoryTelemetry memoryTelemetry;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+
+	// Shared by the pipeline and frame groups, loaded by whichever runs first
+	StressScene scene;
+
+	std::vector<BenchmarkResult> results;
+};
+
+int main(int argc, char** argv) {
+	std::vector<std::string> groups;
+	bool anyDevice = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--any-device") == 0) {
+			anyDevice = true;
+		}
+		else {
+			groups.push_back(argv[i]);
+		}
+	}
+	try {
+		MicroBenchmarkSuite suite;
+		suite.run(groups, anyDevice);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+void MicroBenchmarkSuite::run(const std::vector<std::string>& groups, bool anyDevice) {
+	auto selected = [&groups](const char* group) {
+		return groups.empty() || std::find(groups.begin(), groups.end(), group) != groups.end();
+	};
+	createDevice(anyDevice);
+	std::cout << "Microbenchmarks on " << deviceProperties.deviceName << ", median of " << SAMPLES << " samples" << std::endl;
+	if (selected("allocators")) {
+		benchmarkAllocators();
+	}
+	if (selected("upload")) {
+		benchmarkStagingUpload();
+	}
+	if (selected("descriptors")) {
+		benchmarkDescriptorAllocation();
+	}
+	if (selected("pipelines")) {
+		benchmarkPipelineCreation();
+	}
+	if (selected("frame")) {
+		benchmarkFrameStages();
+	}
+	print(std::cout);
+	writeJson(RESULTS_JSON_PATH);
+	destroyDevice();
+}
+
+void MicroBenchmarkSuite::addLatency(const std::string& name, double milliseconds, uint32_t operations) {
+	results.push_back({ name, milliseconds * 1.0e6 / operations, "ns/op" });
+}
+
+void MicroBenchmarkSuite::addThroughput(const std::string& name, double milliseconds, VkDeviceSize bytes) {
+	results.push_back({ name, static_cast<double>(bytes) / (1024.0 * 1024.0) / (milliseconds / 1000.0), "MiB/s" });
+}
+
+void MicroBenchmarkSuite::createDevice(bool anyDevice) {
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "Vulkan Renderer Microbenchmarks";
+	appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 3, 249);
+	VkInstanceCreateInfo instanceInfo{};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &appInfo;
+	if (vkCreateInstance(&instanceInfo, allocator, &instance) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark instance!");
+	}
+	instanceTable.load(instance);
+
+	// A CPU device with a graphics queue and Vulkan 1.3, or with --any-device the first device with both
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+	for (VkPhysicalDevice candidate : devices) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(candidate, &properties);
+		if (properties.apiVersion < VK_API_VERSION_1_3 || (!anyDevice && properties.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU)) {
+			continue;
+		}
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+		for (uint32_t i = 0; i < familyCount; i++) {
+			if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				queueFamily = i;
+				break;
+			}
+		}
+		if (queueFamily != UINT32_MAX) {
+			physicalDevice = candidate;
+			deviceProperties = properties;
+			break;
+		}
+	}
+	if (physicalDevice == VK_NULL_HANDLE) {
+		throw std::runtime_error(anyDevice ? "Failed to find a Vulkan 1.3 device!" : "Failed to find a software Vulkan 1.3 driver (lavapipe, SwiftShader), pass --any-device to use another!");
+	}
+	memoryTypes.build(physicalDevice);
+
+	float queuePriority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo{};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = queueFamily;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &queuePriority;
+	VkPhysicalDeviceFeatures deviceFeatures{};
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.dynamicRendering = VK_TRUE;
+	VkDeviceCreateInfo deviceInfo{};
+	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.pNext = &vulkan13Features;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+	deviceInfo.pEnabledFeatures = &deviceFeatures;
+	if (vkCreateDevice(physicalDevice, &deviceInfo, allocator, &device) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark device!");
+	}
+	memoryTelemetry.init(memoryTypes.getProperties(), deviceProperties.limits, false);
+	deviceTable.load(device, instanceTable);
+	vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	if (vkCreateCommandPool(device, &poolInfo, allocator, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark command pool!");
+	}
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate microbenchmark command buffer!");
+	}
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateFence(device, &fenceInfo, allocator, &fence) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark fence!");
+	}
+}
+
+void MicroBenchmarkSuite::destroyDevice() {
+	scene.destroy(device, memoryTelemetry, allocator);
+	vkDestroyFence(device, fence, allocator);
+	vkDestroyCommandPool(device, commandPool, allocator);
+	vkDestroyDevice(device, allocator);
+	vkDestroyInstance(instance, allocator);
+}
+
+VkFormat MicroBenchmarkSuite::findDepthFormat() {
+	for (VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32 }) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+			return format;
+		}
+	}
+	throw std::runtime_error("Failed to find a depth format!");
+}
+
+void MicroBenchmarkSuite::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memoryUsage, MemoryCategory category, VkBuffer& buffer, VkDeviceMemory& memory) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(device, &bufferInfo, allocator, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark buffer!");
+	}
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryTypes.find(memoryUsage, memRequirements.memoryTypeBits);
+	if (memoryTelemetry.allocate(device, allocInfo, size, category, allocator, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate microbenchmark buffer memory!");
+	}
+	vkBindBufferMemory(device, buffer, memory, 0);
+}
+
+void MicroBenchmarkSuite::submitAndWait(VkCommandBuffer commandBuffer) {
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	if (deviceTable.vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit microbenchmark commands!");
+	}
+	deviceTable.vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+	deviceTable.vkResetFences(device, 1, &fence);
+}
+
+void MicroBenchmarkSuite::benchmarkAllocators() {
+	// Frame arena: bump allocation of small records, then one reset
+	std::vector<uint8_t> arenaMemory(ARENA_ALLOCATIONS * 64);
+	LinearArena arena(arenaMemory.data(), arenaMemory.size());
+	addLatency("allocators/linearArena.allocate", measure([&arena]() {
+		for (uint32_t i = 0; i < ARENA_ALLOCATIONS; i++) {
+			arena.allocate(16 + (i & 31), 16);
+		}
+		arena.reset();
+	}), ARENA_ALLOCATIONS);
+
+	// Driver host allocations in the object scope (size class pools) and the command scope (rewinding arena),
+	// freed in reverse as command buffers and transient objects are. Objects all stay live until the end, command
+	// scoped blocks only for a batch, the way they only live for one call.
+	std::vector<void*> blocks(HOST_ALLOCATIONS);
+	uint64_t arenaOverflows = hostAllocator.getStats(VK_SYSTEM_ALLOCATION_SCOPE_COMMAND).arenaOverflows;
+	for (VkSystemAllocationScope scope : { VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND }) {
+		uint32_t batch = scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND ? HOST_COMMAND_BATCH : HOST_ALLOCATIONS;
+		addLatency(scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT ? "allocators/hostAllocator.object" : "allocators/hostAllocator.command", measure([this, &blocks, scope, batch]() {
+			for (uint32_t first = 0; first < HOST_ALLOCATIONS; first += batch) {
+				uint32_t last = std::min(first + batch, HOST_ALLOCATIONS);
+				for (uint32_t i = first; i < last; i++) {
+					blocks[i] = allocator->pfnAllocation(allocator->pUserData, 32 + (i % 8) * 48, 16, scope);
+				}
+				for (uint32_t i = last; i-- > first;) {
+					allocator->pfnFree(allocator->pUserData, blocks[i]);
+				}
+			}
+		}), HOST_ALLOCATIONS);
+	}
+	// Command scoped allocations that missed the arena were timed through malloc, so the count goes next to the timing
+	arenaOverflows = hostAllocator.getStats(VK_SYSTEM_ALLOCATION_SCOPE_COMMAND).arenaOverflows - arenaOverflows;
+	results.push_back({ "allocators/hostAllocator.commandOverflows", static_cast<double>(arenaOverflows), "allocs" });
+
+	// Device memory through the telemetry's accounting, the path every buffer and image takes
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = DEVICE_ALLOCATION_SIZE;
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer probe;
+	if (vkCreateBuffer(device, &bufferInfo, allocator, &probe) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark buffer!");
+	}
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, probe, &memRequirements);
+	vkDestroyBuffer(device, probe, allocator);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryTypes.find(MemoryUsage::GpuOnly, memRequirements.memoryTypeBits);
+	std::vector<VkDeviceMemory> memories(DEVICE_ALLOCATIONS);
+	addLatency("allocators/deviceMemory.allocate", measure([this, &allocInfo, &memories]() {
+		for (VkDeviceMemory& memory : memories) {
+			if (memoryTelemetry.allocate(device, allocInfo, DEVICE_ALLOCATION_SIZE, MemoryCategory::Other, allocator, &memory) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate microbenchmark device memory!");
+			}
+		}
+		for (VkDeviceMemory memory : memories) {
+			memoryTelemetry.free(device, memory, allocator);
+		}
+	}), DEVICE_ALLOCATIONS);
+}
+
+void MicroBenchmarkSuite::benchmarkStagingUpload() {
+	// CPU write into mapped staging memory plus the GPU copy into device local memory, as StressScene uploads
+	for (VkDeviceSize size : UPLOAD_SIZES) {
+		VkBuffer staging, destination;
+		VkDeviceMemory stagingMemory, destinationMemory;
+		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryUsage::Upload, MemoryCategory::Staging, staging, stagingMemory);
+		createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::GpuOnly, MemoryCategory::Other, destination, destinationMemory);
+		void* mapped;
+		if (vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to map microbenchmark staging memory!");
+		}
+		std::vector<uint8_t> source(static_cast<size_t>(size), 0x5A);
+
+		double milliseconds = measure([&]() {
+			memcpy(mapped, source.data(), source.size());
+			deviceTable.vkResetCommandBuffer(commandBuffer, 0);
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			deviceTable.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+			VkBufferCopy region{};
+			region.size = size;
+			deviceTable.vkCmdCopyBuffer(commandBuffer, staging, destination, 1, &region);
+			deviceTable.vkEndCommandBuffer(commandBuffer);
+			submitAndWait(commandBuffer);
+		});
+		addThroughput("upload/staging." + std::to_string(size / 1024) + "KiB", milliseconds, size);
+
+		vkUnmapMemory(device, stagingMemory);
+		vkDestroyBuffer(device, destination, allocator);
+		vkDestroyBuffer(device, staging, allocator);
+		memoryTelemetry.free(device, destinationMemory, allocator);
+		memoryTelemetry.free(device, stagingMemory, allocator);
+	}
+}
+
+void MicroBenchmarkSuite::benchmarkDescriptorAllocation() {
+	// The uniform ring's shape: one dynamic uniform and one dynamic storage buffer
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark descriptor set layout!");
+	}
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSizes[0].descriptorCount = DESCRIPTOR_SETS;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	poolSizes[1].descriptorCount = DESCRIPTOR_SETS;
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	poolInfo.maxSets = DESCRIPTOR_SETS;
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device, &poolInfo, allocator, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark descriptor pool!");
+	}
+
+	// One set per call, as a per-draw allocation scheme would, then the whole pool reset at once
+	addLatency("descriptors/allocate", measure([this, pool, layout]() {
+		for (uint32_t i = 0; i < DESCRIPTOR_SETS; i++) {
+			VkDescriptorSetAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = pool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &layout;
+			VkDescriptorSet set;
+			if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate microbenchmark descriptor set!");
+			}
+		}
+		vkResetDescriptorPool(device, pool, 0);
+	}), DESCRIPTOR_SETS);
+
+	vkDestroyDescriptorPool(device, pool, allocator);
+	vkDestroyDescriptorSetLayout(device, layout, allocator);
+}
+
+void MicroBenchmarkSuite::benchmarkPipelineCreation() {
+	if (!scene.isLoaded()) {
+		SceneParameters parameters;
+		parameters.objectCount = FRAME_OBJECTS;
+		scene.create(device, queue, queueFamily, &queueFamily, 1, memoryTypes, memoryTelemetry, PostProcessChain::SCENE_COLOR_FORMAT, findDepthFormat(), VK_SAMPLE_COUNT_1_BIT, FRAME_EXTENT, 1, parameters, allocator);
+	}
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	// Cold: a fresh cache every time, so the driver compiles the shaders from SPIR-V
+	double cold = measure([this, &cacheInfo]() {
+		VkPipelineCache cache;
+		if (vkCreatePipelineCache(device, &cacheInfo, allocator, &cache) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create microbenchmark pipeline cache!");
+		}
+		VkPipeline pipeline = scene.buildPipeline(device, cache, allocator);
+		vkDestroyPipeline(device, pipeline, allocator);
+		vkDestroyPipelineCache(device, cache, allocator);
+	});
+	addLatency("pipelines/create.coldCache", cold, 1);
+
+	// Warm: the same cache throughout, primed by measure()'s warmup run
+	VkPipelineCache cache;
+	if (vkCreatePipelineCache(device, &cacheInfo, allocator, &cache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create microbenchmark pipeline cache!");
+	}
+	double warm = measure([this, cache]() {
+		VkPipeline pipeline = scene.buildPipeline(device, cache, allocator);
+		vkDestroyPipeline(device, pipeline, allocator);
+	});
+	addLatency("pipelines/create.warmCache", warm, 1);
+	vkDestroyPipelineCache(device, cache, allocator);
+}
+
+void MicroBenchmarkSuite::benchmarkFrameStages() {
+	if (!scene.isLoaded()) {
+		SceneParameters parameters;
+		parameters.objectCount = FRAME_OBJECTS;
+		scene.create(device, queue, queueFamily, &queueFamily, 1, memoryTypes, memoryTelemetry, PostProcessChain::SCENE_COLOR_FORMAT, findDepthFormat(), VK_SAMPLE_COUNT_1_BIT, FRAME_EXTENT, 1, parameters, allocator);
+	}
+	// The thread scaling study's kernels on one worker: per object culling, per visible object sorting and recording
+	ThreadScalingStudy study;
+	FrameArena frameArena;
+	frameArena.create(ThreadScalingStudy::getFrameArenaBytes(FRAME_OBJECTS, 1), 2);
+	study.run(device, deviceTable, queueFamily, scene, frameArena, FRAME_EXTENT, 0, 1, allocator);
+	addLatency("frame/culling", study.getMilliseconds(ThreadScalingStudy::Stage::Culling, 1), study.getObjectCount());
+	uint32_t visible = std::max(study.getVisibleCount(), 1u);
+	addLatency("frame/sorting", study.getMilliseconds(ThreadScalingStudy::Stage::Sorting, 1), visible);
+	addLatency("frame/recording", study.getMilliseconds(ThreadScalingStudy::Stage::Recording, 1), visible);
+	uint32_t moving = std::max(static_cast<uint32_t>(scene.getScene().movingObjects.size()), 1u);
+	addLatency("frame/uploads", study.getMilliseconds(ThreadScalingStudy::Stage::Uploads, 1), moving);
+}
+
+void MicroBenchmarkSuite::print(std::ostream& out) const {
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(1);
+	for (const BenchmarkResult& result : results) {
+		out << "  " << std::left << std::setw(40) << result.name << std::right << std::setw(14) << result.value << " " << result.unit << std::endl;
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void MicroBenchmarkSuite::writeJson(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	file << "{\n  \"device\": \"" << deviceProperties.deviceName << "\",\n  \"samples\": " << SAMPLES << ",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		file << "    { \"name\": \"" << results[i].name << "\", \"value\": " << results[i].value << ", \"unit\": \"" << results[i].unit << "\" }"
+			<< (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	file << "  ]\n}\n";
+}
@@ -0,0 +1,344 @@
+#include "PerformanceHud.h"
+
+#include "ShaderLoader.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	// 3x5 font. Each row is three bits with the leftmost column in the high bit, rows listed top to bottom.
+	// Lower case letters are drawn with their upper case glyphs.
+	struct GlyphRows {
+		char character;
+		uint8_t rows[5];
+	};
+	const GlyphRows FONT[] = {
+		{ '0', { 7, 5, 5, 5, 7 } }, { '1', { 2, 6, 2, 2, 7 } }, { '2', { 7, 1, 7, 4, 7 } }, { '3', { 7, 1, 3, 1, 7 } },
+		{ '4', { 5, 5, 7, 1, 1 } }, { '5', { 7, 4, 7, 1, 7 } }, { '6', { 7, 4, 7, 5, 7 } }, { '7', { 7, 1, 1, 2, 2 } },
+		{ '8', { 7, 5, 7, 5, 7 } }, { '9', { 7, 5, 7, 1, 7 } },
+		{ 'A', { 2, 5, 7, 5, 5 } }, { 'B', { 6, 5, 6, 5, 6 } }, { 'C', { 3, 4, 4, 4, 3 } }, { 'D', { 6, 5, 5, 5, 6 } },
+		{ 'E', { 7, 4, 6, 4, 7 } }, { 'F', { 7, 4, 6, 4, 4 } }, { 'G', { 3, 4, 5, 5, 3 } }, { 'H', { 5, 5, 7, 5, 5 } },
+		{ 'I', { 7, 2, 2, 2, 7 } }, { 'J', { 1, 1, 1, 5, 2 } }, { 'K', { 5, 5, 6, 5, 5 } }, { 'L', { 4, 4, 4, 4, 7 } },
+		{ 'M', { 5, 7, 7, 5, 5 } }, { 'N', { 6, 5, 5, 5, 5 } }, { 'O', { 2, 5, 5, 5, 2 } }, { 'P', { 6, 5, 6, 4, 4 } },
+		{ 'Q', { 2, 5, 5, 6, 3 } }, { 'R', { 6, 5, 6, 5, 5 } }, { 'S', { 3, 4, 2, 1, 6 } }, { 'T', { 7, 2, 2, 2, 2 } },
+		{ 'U', { 5, 5, 5, 5, 7 } }, { 'V', { 5, 5, 5, 5, 2 } }, { 'W', { 5, 5, 7, 7, 5 } }, { 'X', { 5, 5, 2, 5, 5 } },
+		{ 'Y', { 5, 5, 2, 2, 2 } }, { 'Z', { 7, 1, 2, 4, 7 } },
+		{ '.', { 0, 0, 0, 0, 2 } }, { ':', { 0, 2, 0, 2, 0 } }, { '%', { 5, 1, 2, 4, 5 } }, { '/', { 1, 1, 2, 4, 4 } },
+		{ '-', { 0, 0, 7, 0, 0 } }, { '(', { 1, 2, 2, 2, 1 } }, { ')', { 4, 2, 2, 2, 4 } }, { '_', { 0, 0, 0, 0, 7 } },
+	};
+	// Every cell set, used for rectangles
+	const uint16_t SOLID_GLYPH = 0x7FFF;
+
+	// Layout in pixels
+	const int32_t GLYPH_SCALE = 2;
+	const int32_t GLYPH_ADVANCE = 4 * GLYPH_SCALE;
+	const int32_t LINE_HEIGHT = 7 * GLYPH_SCALE;
+	const int32_t PANEL_MARGIN = 16;
+	const int32_t PANEL_PADDING = 8;
+	const int32_t GRAPH_BAR_WIDTH = 2;
+	const int32_t GRAPH_WIDTH = PerformanceHud::HISTORY_LENGTH * GRAPH_BAR_WIDTH;
+	const int32_t GRAPH_HEIGHT = 48;
+	// Frame time at the top of a graph, and the reference line drawn across it
+	const double GRAPH_RANGE_MS = 33.3;
+	const double GRAPH_TARGET_MS = 16.7;
+
+	// RGBA8 as read by unpackUnorm4x8: red in the low byte
+	const uint32_t COLOR_PANEL = 0xC0000000;
+	const uint32_t COLOR_TEXT = 0xFFFFFFFF;
+	const uint32_t COLOR_CPU = 0xFF40C0FF;
+	const uint32_t COLOR_GPU = 0xFFFFC040;
+	const uint32_t COLOR_TARGET = 0x8000FF00;
+	const uint32_t COLOR_GRAPH_BACKGROUND = 0x40FFFFFF;
+
+	const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+	// Text of one frame's overlay: a line per pass, queue and heap besides the fixed ones, none above 64 characters
+	const size_t TEXT_ARENA_BYTES = 16 * 1024;
+
+	// Counter in at most five characters: 123, 12.3K, 123M
+	const char* formatCount(LinearArena& arena, uint64_t count) {
+		if (count < 1000) {
+			return arena.format("%llu", static_cast<unsigned long long>(count));
+		}
+		else if (count < 1000000) {
+			return arena.format("%.1fK", count / 1000.0);
+		}
+		else if (count < 1000000000) {
+			return arena.format("%.1fM", count / 1000000.0);
+		}
+		return arena.format("%.1fG", count / 1000000000.0);
+	}
+}
+
+void PerformanceHud::create(VkDevice device, VkFormat colorFormat, VkDescriptorSetLayout ringLayout, const VkAllocationCallbacks* pAllocator) {
+	for (const GlyphRows& glyph : FONT) {
+		uint16_t bits = 0;
+		for (uint32_t row = 0; row < 5; row++) {
+			for (uint32_t column = 0; column < 3; column++) {
+				if (glyph.rows[row] & (4 >> column)) {
+					bits |= 1 << (row * 3 + column);
+				}
+			}
+		}
+		glyphs[static_cast<uint8_t>(glyph.character)] = bits;
+		if (glyph.character >= 'A' && glyph.character <= 'Z') {
+			glyphs[static_cast<uint8_t>(glyph.character - 'A' + 'a')] = bits;
+		}
+	}
+
+	// The batch is read through the ring's dynamic storage binding, the viewport size is a push constant
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = 2 * sizeof(float);
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &ringLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (vkCreatePipelineLayout(device, &layoutInfo, pAllocator, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create HUD pipeline layout!");
+	}
+
+	VkShaderModule vertShaderModule = createShaderModule(device, "shaders/hud.vert.spv", pAllocator);
+	VkShaderModule fragShaderModule = createShaderModule(device, "shaders/hud.frag.spv", pAllocator);
+	VkPipelineShaderStageCreateInfo shaderStages[2]{};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragShaderModule;
+	shaderStages[1].pName = "main";
+
+	// No vertex buffers, the vertex shader pulls quads from the batch
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.lineWidth = 1.0f;
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	// Drawn over everything, the scene's depth is neither tested nor written
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+	// Straight alpha blending over the frame
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &colorFormat;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &renderingInfo;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = pipelineLayout;
+	VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, pAllocator, &pipeline);
+	vkDestroyShaderModule(device, fragShaderModule, pAllocator);
+	vkDestroyShaderModule(device, vertShaderModule, pAllocator);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create HUD pipeline!");
+	}
+}
+
+void PerformanceHud::destroy(VkDevice device, const VkAllocationCallbacks* pAllocator) {
+	vkDestroyPipeline(device, pipeline, pAllocator);
+	vkDestroyPipelineLayout(device, pipelineLayout, pAllocator);
+}
+
+void PerformanceHud::addFrame(double cpuMilliseconds, double gpuMilliseconds) {
+	cpuHistory[historyHead] = cpuMilliseconds;
+	gpuHistory[historyHead] = gpuMilliseconds;
+	historyHead = (historyHead + 1) % HISTORY_LENGTH;
+}
+
+void PerformanceHud::setDrawStats(uint32_t drawCount, uint64_t triangleCount) {
+	this->drawCount = drawCount;
+	this->triangleCount = triangleCount;
+}
+
+void PerformanceHud::updateMemory(VkPhysicalDevice physicalDevice, bool memoryBudgetEnabled) {
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+	budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	VkPhysicalDeviceMemoryProperties2 memProperties{};
+	memProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memProperties.pNext = memoryBudgetEnabled ? &budget : nullptr;
+	vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memProperties);
+
+	heapCount = memProperties.memoryProperties.memoryHeapCount;
+	budgetAvailable = memoryBudgetEnabled;
+	for (uint32_t i = 0; i < heapCount; i++) {
+		const VkMemoryHeap& heap = memProperties.memoryProperties.memoryHeaps[i];
+		heapSize[i] = heap.size;
+		heapDeviceLocal[i] = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		heapUsage[i] = budget.heapUsage[i];
+		heapBudget[i] = budget.heapBudget[i];
+	}
+}
+
+void PerformanceHud::draw(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, UniformRingBuffer& ring, VkDescriptorSet ringSet, FrameArena& frameArena, VkExtent2D extent, const GpuProfiler& profiler, const QueueUtilization& queues) {
+	// The whole batch is one storage allocation; unused space at the end is simply not drawn
+	UniformRingBuffer::Allocation batch = ring.allocateStorage(MAX_QUADS * sizeof(Quad));
+	quads = static_cast<Quad*>(batch.data);
+	quadCount = 0;
+	LinearArena text = frameArena.acquireWorkerArena(TEXT_ARENA_BYTES);
+
+	// Lines: frame times, one per pass, one per queue, draws, one per heap
+	int32_t lineCount = 3 + static_cast<int32_t>(profiler.getPassCount() + queues.getQueueCount() + heapCount);
+	int32_t left = PANEL_MARGIN + PANEL_PADDING;
+	int32_t y = PANEL_MARGIN + PANEL_PADDING;
+	addRect(PANEL_MARGIN, PANEL_MARGIN, GRAPH_WIDTH + 2 * PANEL_PADDING, lineCount * LINE_HEIGHT + 2 * (GRAPH_HEIGHT + PANEL_PADDING) + PANEL_PADDING, COLOR_PANEL);
+
+	// Latest and worst frame time over the history
+	uint32_t latest = (historyHead + HISTORY_LENGTH - 1) % HISTORY_LENGTH;
+	double cpuMax = *std::max_element(cpuHistory, cpuHistory + HISTORY_LENGTH);
+	double gpuMax = *std::max_element(gpuHistory, gpuHistory + HISTORY_LENGTH);
+	addText(left, y, text.format("CPU %6.2f MS  MAX %6.2f", cpuHistory[latest], cpuMax), COLOR_CPU);
+	y += LINE_HEIGHT;
+	addGraph(left, y, cpuHistory, COLOR_CPU);
+	y += GRAPH_HEIGHT + PANEL_PADDING;
+	if (profiler.isSupported()) {
+		addText(left, y, text.format("GPU %6.2f MS  MAX %6.2f", gpuHistory[latest], gpuMax), COLOR_GPU);
+	}
+	else {
+		addText(left, y, "GPU TIMESTAMPS NOT SUPPORTED", COLOR_GPU);
+	}
+	y += LINE_HEIGHT;
+	addGraph(left, y, gpuHistory, COLOR_GPU);
+	y += GRAPH_HEIGHT + PANEL_PADDING;
+
+	// Vertices, primitives after clipping, fragments and compute invocations next to each pass time
+	for (uint32_t i = 0; i < profiler.getPassCount(); i++) {
+		const GpuProfiler::PassTiming& pass = profiler.getPass(i);
+		if (profiler.hasPipelineStatistics()) {
+			addText(left, y, text.format(" %-8s %6.3f MS VS %-5s PR %-5s FS %-5s CS %s", pass.name, pass.milliseconds,
+				formatCount(text, pass.statistics.vertexShaderInvocations), formatCount(text, pass.statistics.clippingPrimitives),
+				formatCount(text, pass.statistics.fragmentShaderInvocations), formatCount(text, pass.statistics.computeShaderInvocations)), COLOR_TEXT);
+		}
+		else {
+			addText(left, y, text.format(" %-8s %6.3f MS", pass.name, pass.milliseconds), COLOR_TEXT);
+		}
+		y += LINE_HEIGHT;
+	}
+	// Busy share of the frame and where each queue's idle time went
+	for (uint32_t i = 0; i < queues.getQueueCount(); i++) {
+		const QueueUtilization::QueueStats& queue = queues.getQueueStats(i);
+		addText(left, y, text.format("%-8s %3.0f%% BUSY IDLE CPU %5.2f WAIT %5.2f MS", queue.name, queue.utilization * 100.0,
+			queue.submissionIdleMilliseconds, queue.crossQueueIdleMilliseconds), COLOR_TEXT);
+		y += LINE_HEIGHT;
+	}
+	addText(left, y, text.format("DRAWS %u  TRIANGLES %llu  RENDER %uX%u", drawCount, static_cast<unsigned long long>(triangleCount),
+		renderExtent.width, renderExtent.height), COLOR_TEXT);
+	y += LINE_HEIGHT;
+	for (uint32_t i = 0; i < heapCount; i++) {
+		if (budgetAvailable) {
+			addText(left, y, text.format("HEAP %u %s %6.0f / %6.0f MB (%6.0f)", i, heapDeviceLocal[i] ? "DEVICE" : "HOST  ",
+				heapUsage[i] / BYTES_PER_MB, heapBudget[i] / BYTES_PER_MB, heapSize[i] / BYTES_PER_MB), COLOR_TEXT);
+		}
+		else {
+			addText(left, y, text.format("HEAP %u %s      - / %6.0f MB", i, heapDeviceLocal[i] ? "DEVICE" : "HOST  ", heapSize[i] / BYTES_PER_MB), COLOR_TEXT);
+		}
+		y += LINE_HEIGHT;
+	}
+
+	// One draw for the whole overlay: six vertices per quad
+	uint32_t dynamicOffsets[2] = { 0, batch.dynamicOffset };
+	float inverseViewport[2] = { 1.0f / extent.width, 1.0f / extent.height };
+	VkViewport viewport{};
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
+	viewport.maxDepth = 1.0f;
+	VkRect2D scissor{};
+	scissor.extent = extent;
+	dispatch.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	dispatch.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &ringSet, 2, dynamicOffsets);
+	dispatch.vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(inverseViewport), inverseViewport);
+	dispatch.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	dispatch.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	dispatch.vkCmdDraw(commandBuffer, quadCount * 6, 1, 0, 0);
+	quads = nullptr;
+}
+
+void PerformanceHud::addRect(int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color) {
+	if (quadCount == MAX_QUADS || width <= 0 || height <= 0) {
+		return;
+	}
+	// Write the whole quad at once, the batch lives in write-combined memory
+	Quad quad;
+	quad.position = static_cast<uint32_t>(x & 0xFFFF) | (static_cast<uint32_t>(y & 0xFFFF) << 16);
+	quad.size = static_cast<uint32_t>(width & 0xFFFF) | (static_cast<uint32_t>(height & 0xFFFF) << 16);
+	quad.glyph = SOLID_GLYPH;
+	quad.color = color;
+	quads[quadCount++] = quad;
+}
+
+void PerformanceHud::addText(int32_t x, int32_t y, const char* text, uint32_t color) {
+	for (const char* c = text; *c != '\0' && quadCount < MAX_QUADS; c++, x += GLYPH_ADVANCE) {
+		uint16_t glyph = glyphs[static_cast<uint8_t>(*c) & 0x7F];
+		// Spaces and unknown characters only advance
+		if (glyph == 0) {
+			continue;
+		}
+		Quad quad;
+		quad.position = static_cast<uint32_t>(x & 0xFFFF) | (static_cast<uint32_t>(y & 0xFFFF) << 16);
+		quad.size = static_cast<uint32_t>(3 * GLYPH_SCALE) | (static_cast<uint32_t>(5 * GLYPH_SCALE) << 16);
+		quad.glyph = glyph;
+		quad.color = color;
+		quads[quadCount++] = quad;
+	}
+}
+
+void PerformanceHud::addGraph(int32_t x, int32_t y, const double* history, uint32_t color) {
+	addRect(x, y, GRAPH_WIDTH, GRAPH_HEIGHT, COLOR_GRAPH_BACKGROUND);
+	// Oldest frame on the left
+	for (uint32_t i = 0; i < HISTORY_LENGTH; i++) {
+		double value = std::min(history[(historyHead + i) % HISTORY_LENGTH] / GRAPH_RANGE_MS, 1.0);
+		int32_t height = static_cast<int32_t>(value * GRAPH_HEIGHT + 0.5);
+		addRect(x + static_cast<int32_t>(i) * GRAPH_BAR_WIDTH, y + GRAPH_HEIGHT - height, GRAPH_BAR_WIDTH, height, color);
+	}
+	int32_t targetHeight = static_cast<int32_t>(GRAPH_TARGET_MS / GRAPH_RANGE_MS * GRAPH_HEIGHT);
+	addRect(x, y + GRAPH_HEIGHT - targetHeight, GRAPH_WIDTH, 1, COLOR_TARGET);
+}
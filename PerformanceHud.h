@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "GpuProfiler.h"
+#include "LinearArena.h"
+#include "QueueUtilization.h"
+#include "UniformRingBuffer.h"
+#include "VulkanDispatch.h"
+
+#include <cstdint>
+
+// In-app overlay with CPU / GPU frame time graphs, the profiler's pass timings, queue utilization, draw counts and
+// memory per heap.
+// Text and graph bars are quads with a 3x5 bitmap glyph each, written into the uniform ring and drawn with a single
+// non-indexed draw that pulls its vertices from the batch (shaders/hud.vert). While hidden the HUD records nothing,
+// writes nothing into the ring and queries nothing; only the frame time history keeps being filled.
+class PerformanceHud {
+public:
+	// Frames kept in the rolling graph
+	static constexpr uint32_t HISTORY_LENGTH = 240;
+
+	// Pipeline for dynamic rendering into colorFormat. ringLayout is the uniform ring's descriptor set layout.
+	void create(VkDevice device, VkFormat colorFormat, VkDescriptorSetLayout ringLayout, const VkAllocationCallbacks* pAllocator);
+	void destroy(VkDevice device, const VkAllocationCallbacks* pAllocator);
+
+	void toggle() { visible = !visible; }
+	bool isVisible() const { return visible; }
+
+	// Feed every frame, visible or not, so the graph is complete when the HUD is shown
+	void addFrame(double cpuMilliseconds, double gpuMilliseconds);
+	void setDrawStats(uint32_t drawCount, uint64_t triangleCount);
+	// Resolution the scene was rendered at, which dynamic resolution may lower
+	void setRenderExtent(VkExtent2D extent) { renderExtent = extent; }
+	// Refresh heap usage. Uses VK_EXT_memory_budget when enabled, otherwise only heap sizes are known.
+	void updateMemory(VkPhysicalDevice physicalDevice, bool memoryBudgetEnabled);
+
+	// Record the overlay inside an active rendering pass covering extent. Its lines are formatted into the frame's arena.
+	void draw(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, UniformRingBuffer& ring, VkDescriptorSet ringSet, FrameArena& frameArena, VkExtent2D extent, const GpuProfiler& profiler, const QueueUtilization& queues);
+
+private:
+	// Matches HudQuad in shaders/hud.vert
+	struct Quad {
+		uint32_t position;
+		uint32_t size;
+		uint32_t glyph;
+		uint32_t color;
+	};
+	static constexpr uint32_t MAX_QUADS = static_cast<uint32_t>(UniformRingBuffer::STORAGE_BINDING_RANGE / sizeof(Quad));
+
+	void addRect(int32_t x, int32_t y, int32_t width, int32_t height, uint32_t color);
+	void addText(int32_t x, int32_t y, const char* text, uint32_t color);
+	void addGraph(int32_t x, int32_t y, const double* history, uint32_t color);
+
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	bool visible = false;
+
+	// Glyph bitmaps indexed by ASCII code, built from the font table in PerformanceHud.cpp
+	uint16_t glyphs[128] = {};
+
+	double cpuHistory[HISTORY_LENGTH] = {};
+	double gpuHistory[HISTORY_LENGTH] = {};
+	uint32_t historyHead = 0;
+	uint32_t drawCount = 0;
+	uint64_t triangleCount = 0;
+	VkExtent2D renderExtent = {};
+
+	uint32_t heapCount = 0;
+	VkDeviceSize heapUsage[VK_MAX_MEMORY_HEAPS] = {};
+	VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS] = {};
+	VkDeviceSize heapSize[VK_MAX_MEMORY_HEAPS] = {};
+	bool heapDeviceLocal[VK_MAX_MEMORY_HEAPS] = {};
+	bool budgetAvailable = false;
+
+	// Batch being written by draw()
+	Quad* quads = nullptr;
+	uint32_t quadCount = 0;
+};
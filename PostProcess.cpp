@@ -0,0 +1,550 @@
+#include "PostProcess.h"
+
+#include "ShaderLoader.h"
+
+#include <initializer_list>
+#include <string>
+#include <stdexcept>
+
+namespace {
+	// Matches local_size_x and local_size_y in shaders/bloom.comp and shaders/taa.comp
+	const uint32_t GROUP_SIZE = 8;
+	// Bindings of the shared descriptor set layout:
+	//  0: the source of bloom and the composite, scene color or the history just written
+	//  1: bloom for sampling, 2: bloom for the bloom pass to write
+	//  3: scene color, 4: motion, 5: the previous history for sampling, 6: the history to write, for the temporal step
+	const uint32_t BINDING_COUNT = 7;
+
+	// Matches the push constant block in shaders/taa.comp, shaders/bloom.comp and shaders/post.frag
+	struct PostPushConstants {
+		// Part of the source the scene covers, in texture coordinates
+		float uvScale[2];
+		// The frame's jitter in render pixels
+		float jitter[2];
+		float exposure;
+		float bloomThreshold;
+		float bloomStrength;
+		float saturation;
+		float contrast;
+		float vignette;
+		uint32_t fxaa;
+		// 0 when the history holds nothing yet
+		uint32_t historyValid;
+	};
+
+	// Element index of the base radical inverse, in [0, 1)
+	float halton(uint32_t index, uint32_t base) {
+		float result = 0.0f;
+		float fraction = 1.0f / static_cast<float>(base);
+		while (index > 0) {
+			result += static_cast<float>(index % base) * fraction;
+			index /= base;
+			fraction /= static_cast<float>(base);
+		}
+		return result;
+	}
+
+	// The images share their layouts, stages and accesses, so one barrier command covers them
+	void transition(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, std::initializer_list<VkImage> images, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+		VkImageMemoryBarrier barriers[4]{};
+		uint32_t count = 0;
+		for (VkImage image : images) {
+			// Images that don't exist in this configuration
+			if (image == VK_NULL_HANDLE) {
+				continue;
+			}
+			VkImageMemoryBarrier& barrier = barriers[count++];
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = dstAccess;
+			barrier.oldLayout = oldLayout;
+			barrier.newLayout = newLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.layerCount = 1;
+		}
+		dispatch.vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, count, barriers);
+	}
+
+	VkPipeline createComputePipeline(VkDevice device, VkPipelineLayout layout, const char* path, const VkAllocationCallbacks* pAllocator) {
+		VkShaderModule shaderModule = createShaderModule(device, path, pAllocator);
+		VkComputePipelineCreateInfo computeInfo{};
+		computeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		computeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		computeInfo.stage.module = shaderModule;
+		computeInfo.stage.pName = "main";
+		computeInfo.layout = layout;
+		VkPipeline pipeline;
+		VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computeInfo, pAllocator, &pipeline);
+		vkDestroyShaderModule(device, shaderModule, pAllocator);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error(std::string("Failed to create post-processing pipeline for ") + path + "!");
+		}
+		return pipeline;
+	}
+}
+
+void PostProcessChain::create(VkDevice device, VkFormat outputFormat, const VkAllocationCallbacks* pAllocator) {
+	// Bilinear and clamped: bloom's taps average 2x2 texels each, FXAA's land between texels, and the temporal step
+	// reprojects the history to arbitrary positions
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	if (vkCreateSampler(device, &samplerInfo, pAllocator, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create post-processing sampler!");
+	}
+
+	VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+	for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 2 || i == 6 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	bindings[0].stageFlags |= VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = BINDING_COUNT;
+	layoutInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, pAllocator, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create post-processing descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = (BINDING_COUNT - 2) * DESCRIPTOR_SET_COUNT;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = 2 * DESCRIPTOR_SET_COUNT;
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = DESCRIPTOR_SET_COUNT;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	if (vkCreateDescriptorPool(device, &poolInfo, pAllocator, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create post-processing descriptor pool!");
+	}
+	VkDescriptorSetLayout setLayouts[DESCRIPTOR_SET_COUNT] = { descriptorSetLayout, descriptorSetLayout, descriptorSetLayout };
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = DESCRIPTOR_SET_COUNT;
+	allocInfo.pSetLayouts = setLayouts;
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate post-processing descriptor sets!");
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PostPushConstants);
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, pAllocator, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create post-processing pipeline layout!");
+	}
+
+	temporalPipeline = createComputePipeline(device, pipelineLayout, "shaders/taa.comp.spv", pAllocator);
+	bloomPipeline = createComputePipeline(device, pipelineLayout, "shaders/bloom.comp.spv", pAllocator);
+
+	VkShaderModule vertShaderModule = createShaderModule(device, "shaders/post.vert.spv", pAllocator);
+	VkShaderModule fragShaderModule = createShaderModule(device, "shaders/post.frag.spv", pAllocator);
+	VkPipelineShaderStageCreateInfo shaderStages[2]{};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragShaderModule;
+	shaderStages[1].pName = "main";
+
+	// One triangle covering the screen, generated from the vertex index
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.lineWidth = 1.0f;
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	// Every pixel is overwritten, nothing is blended
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &outputFormat;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &renderingInfo;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = pipelineLayout;
+	VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, pAllocator, &compositePipeline);
+	vkDestroyShaderModule(device, fragShaderModule, pAllocator);
+	vkDestroyShaderModule(device, vertShaderModule, pAllocator);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create post-processing pipeline!");
+	}
+	writeDescriptors(device);
+}
+
+void PostProcessChain::destroy(VkDevice device, const VkAllocationCallbacks* pAllocator) {
+	vkDestroyPipeline(device, compositePipeline, pAllocator);
+	vkDestroyPipeline(device, bloomPipeline, pAllocator);
+	vkDestroyPipeline(device, temporalPipeline, pAllocator);
+	vkDestroyPipelineLayout(device, pipelineLayout, pAllocator);
+	vkDestroyDescriptorPool(device, descriptorPool, pAllocator);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, pAllocator);
+	vkDestroySampler(device, sampler, pAllocator);
+	compositePipeline = VK_NULL_HANDLE;
+	bloomPipeline = VK_NULL_HANDLE;
+	temporalPipeline = VK_NULL_HANDLE;
+	pipelineLayout = VK_NULL_HANDLE;
+	descriptorPool = VK_NULL_HANDLE;
+	for (VkDescriptorSet& descriptorSet : descriptorSets) {
+		descriptorSet = VK_NULL_HANDLE;
+	}
+	descriptorSetLayout = VK_NULL_HANDLE;
+	sampler = VK_NULL_HANDLE;
+}
+
+void PostProcessChain::createTarget(VkDevice device, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkExtent2D extent, VkFormat format, VkSampleCountFlagBits targetSamples, VkImageUsageFlags usage, const VkAllocationCallbacks* pAllocator, Target& target) {
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { extent.width, extent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = targetSamples;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(device, &imageInfo, pAllocator, &target.image) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create post-processing target!");
+	}
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, target.image, &memRequirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	MemoryUsage memoryUsage = usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT ? MemoryUsage::Transient : MemoryUsage::GpuOnly;
+	allocInfo.memoryTypeIndex = memoryTypes.find(memoryUsage, memRequirements.memoryTypeBits);
+	if (telemetry.allocate(device, allocInfo, memRequirements.size, MemoryCategory::RenderTargets, pAllocator, &target.memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate post-processing target memory!");
+	}
+	vkBindImageMemory(device, target.image, target.memory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = target.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(device, &viewInfo, pAllocator, &target.view) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create post-processing target view!");
+	}
+	target.extent = extent;
+}
+
+void PostProcessChain::createTargets(VkDevice device, VkQueue queue, uint32_t queueFamily, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkExtent2D extent, VkSampleCountFlagBits samples, const VkAllocationCallbacks* pAllocator) {
+	this->samples = samples;
+	createTarget(device, memoryTypes, telemetry, extent, SCENE_COLOR_FORMAT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, pAllocator, sceneColor);
+	createTarget(device, memoryTypes, telemetry, extent, MOTION_FORMAT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, pAllocator, motion);
+	if (samples != VK_SAMPLE_COUNT_1_BIT) {
+		createTarget(device, memoryTypes, telemetry, extent, SCENE_COLOR_FORMAT, samples, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, pAllocator, multisampledColor);
+		createTarget(device, memoryTypes, telemetry, extent, MOTION_FORMAT, samples, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, pAllocator, multisampledMotion);
+	}
+	for (Target& target : history) {
+		createTarget(device, memoryTypes, telemetry, extent, SCENE_COLOR_FORMAT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, pAllocator, target);
+	}
+	VkExtent2D bloomExtent = { (extent.width + BLOOM_DOWNSAMPLE - 1) / BLOOM_DOWNSAMPLE, (extent.height + BLOOM_DOWNSAMPLE - 1) / BLOOM_DOWNSAMPLE };
+	createTarget(device, memoryTypes, telemetry, bloomExtent, SCENE_COLOR_FORMAT, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, pAllocator, bloom);
+	clearBloom(device, queue, queueFamily, pAllocator);
+	temporalFrames = 0;
+	writeDescriptors(device);
+}
+
+// The composite always samples bloom, weighting it by zero when bloom is off. Bloom starts out black and readable, so
+// it is valid to sample until the bloom pass writes it.
+void PostProcessChain::clearBloom(VkDevice device, VkQueue queue, uint32_t queueFamily, const VkAllocationCallbacks* pAllocator) {
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(device, &poolInfo, pAllocator, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create bloom clear command pool!");
+	}
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = bloom.image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	VkClearColorValue black{};
+	vkCmdClearColorImage(commandBuffer, bloom.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1, &barrier.subresourceRange);
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit bloom clear!");
+	}
+	vkQueueWaitIdle(queue);
+	vkDestroyCommandPool(device, commandPool, pAllocator);
+}
+
+void PostProcessChain::destroyTargets(VkDevice device, DeviceMemoryTelemetry& telemetry, const VkAllocationCallbacks* pAllocator) {
+	for (Target* target : { &sceneColor, &motion, &multisampledColor, &multisampledMotion, &history[0], &history[1], &bloom }) {
+		if (target->image == VK_NULL_HANDLE) {
+			continue;
+		}
+		vkDestroyImageView(device, target->view, pAllocator);
+		vkDestroyImage(device, target->image, pAllocator);
+		telemetry.free(device, target->memory, pAllocator);
+		*target = Target{};
+	}
+}
+
+void PostProcessChain::writeDescriptors(VkDevice device) {
+	if (descriptorSets[0] == VK_NULL_HANDLE || sceneColor.image == VK_NULL_HANDLE) {
+		return;
+	}
+	for (uint32_t set = 0; set < DESCRIPTOR_SET_COUNT; set++) {
+		// Set 0 runs no temporal step, but every binding still needs a valid image
+		const Target& written = history[set == 2 ? 1 : 0];
+		const Target& previous = history[set == 2 ? 0 : 1];
+		VkDescriptorImageInfo imageInfos[BINDING_COUNT]{};
+		imageInfos[0] = { sampler, set == 0 ? sceneColor.view : written.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		imageInfos[1] = { sampler, bloom.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		imageInfos[2] = { VK_NULL_HANDLE, bloom.view, VK_IMAGE_LAYOUT_GENERAL };
+		imageInfos[3] = { sampler, sceneColor.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		imageInfos[4] = { sampler, motion.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		imageInfos[5] = { sampler, previous.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		imageInfos[6] = { VK_NULL_HANDLE, written.view, VK_IMAGE_LAYOUT_GENERAL };
+		VkWriteDescriptorSet writes[BINDING_COUNT]{};
+		for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = descriptorSets[set];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = i == 2 || i == 6 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[i].pImageInfo = &imageInfos[i];
+		}
+		vkUpdateDescriptorSets(device, BINDING_COUNT, writes, 0, nullptr);
+	}
+}
+
+void PostProcessChain::pushSettings(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, const float uvScale[2], const Settings& settings) const {
+	PostPushConstants pushConstants{};
+	pushConstants.uvScale[0] = uvScale[0];
+	pushConstants.uvScale[1] = uvScale[1];
+	getJitter(settings, pushConstants.jitter);
+	pushConstants.exposure = settings.exposure;
+	pushConstants.bloomThreshold = settings.bloomThreshold;
+	pushConstants.bloomStrength = settings.bloom ? settings.bloomStrength : 0.0f;
+	pushConstants.saturation = settings.saturation;
+	pushConstants.contrast = settings.contrast;
+	pushConstants.vignette = settings.vignette;
+	pushConstants.fxaa = settings.fxaa && !settings.taa ? 1 : 0;
+	pushConstants.historyValid = temporalFrames > 0 ? 1 : 0;
+	dispatch.vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+}
+
+void PostProcessChain::getJitter(const Settings& settings, float jitter[2]) const {
+	if (!settings.taa) {
+		jitter[0] = 0.0f;
+		jitter[1] = 0.0f;
+		return;
+	}
+	// Halton from index 1, as index 0 is the pixel's corner in both bases
+	uint32_t index = static_cast<uint32_t>(temporalFrames % JITTER_PHASES) + 1;
+	jitter[0] = halton(index, 2) - 0.5f;
+	jitter[1] = halton(index, 3) - 0.5f;
+}
+
+void PostProcessChain::getSceneAttachments(const VkClearColorValue& clearColor, VkRenderingAttachmentInfo attachments[2]) const {
+	const Target* resolved[2] = { &sceneColor, &motion };
+	const Target* multisampled[2] = { &multisampledColor, &multisampledMotion };
+	for (uint32_t i = 0; i < 2; i++) {
+		VkRenderingAttachmentInfo& attachment = attachments[i];
+		attachment = VkRenderingAttachmentInfo{};
+		attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		if (samples == VK_SAMPLE_COUNT_1_BIT) {
+			attachment.imageView = resolved[i]->view;
+			attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		}
+		else {
+			// The samples are resolved as the rendering ends and dropped, never written to memory. Averaging is the only
+			// resolve float formats allow, which blends motion across edges like color.
+			attachment.imageView = multisampled[i]->view;
+			attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+			attachment.resolveImageView = resolved[i]->view;
+			attachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		}
+	}
+	attachments[0].clearValue.color = clearColor;
+	// Pixels no object covers haven't moved
+	attachments[1].clearValue.color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+}
+
+void PostProcessChain::beginScene(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch) const {
+	// The previous contents are discarded, the scene clears them or the resolve overwrites them. The earlier frame's
+	// reads must finish first, and its writes to the multisampled attachments, which nothing reads, too. Resolves write
+	// in the color attachment output stage, like the attachments.
+	transition(commandBuffer, dispatch, { sceneColor.image, motion.image, multisampledColor.image, multisampledMotion.image }, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+}
+
+void PostProcessChain::endScene(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, VkExtent2D renderExtent, const Settings& settings) {
+	transition(commandBuffer, dispatch, { sceneColor.image, motion.image }, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	float renderUvScale[2] = {
+		static_cast<float>(renderExtent.width) / static_cast<float>(sceneColor.extent.width),
+		static_cast<float>(renderExtent.height) / static_cast<float>(sceneColor.extent.height)
+	};
+	if (!settings.taa) {
+		currentSet = 0;
+		sourceUvScale[0] = renderUvScale[0];
+		sourceUvScale[1] = renderUvScale[1];
+		return;
+	}
+
+	// The history written two frames ago is overwritten once that frame's reads finish. Before the first frame the
+	// other history has never been written; it isn't read then, but descriptors must match its layout.
+	uint32_t written = temporalFrames > 0 ? 1 - historyIndex : 0;
+	transition(commandBuffer, dispatch, { history[written].image }, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+	if (temporalFrames == 0) {
+		transition(commandBuffer, dispatch, { history[1 - written].image }, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+	currentSet = 1 + written;
+	dispatch.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, temporalPipeline);
+	dispatch.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[currentSet], 0, nullptr);
+	pushSettings(commandBuffer, dispatch, renderUvScale, settings);
+	dispatch.vkCmdDispatch(commandBuffer, (history[written].extent.width + GROUP_SIZE - 1) / GROUP_SIZE, (history[written].extent.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+	transition(commandBuffer, dispatch, { history[written].image }, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	historyIndex = written;
+	temporalFrames++;
+	// The history is at output resolution and covers it whole
+	sourceUvScale[0] = 1.0f;
+	sourceUvScale[1] = 1.0f;
+}
+
+void PostProcessChain::drawBloom(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, const Settings& settings) const {
+	// Without bloom the composite weights it by zero; it stays readable, cleared by createTargets or from the last
+	// frame that ran the pass
+	if (!settings.bloom) {
+		return;
+	}
+	transition(commandBuffer, dispatch, { bloom.image }, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+	dispatch.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, bloomPipeline);
+	dispatch.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[currentSet], 0, nullptr);
+	pushSettings(commandBuffer, dispatch, sourceUvScale, settings);
+	dispatch.vkCmdDispatch(commandBuffer, (bloom.extent.width + GROUP_SIZE - 1) / GROUP_SIZE, (bloom.extent.height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+	transition(commandBuffer, dispatch, { bloom.image }, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void PostProcessChain::draw(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, VkExtent2D outputExtent, const Settings& settings) const {
+	VkViewport viewport{};
+	viewport.width = static_cast<float>(outputExtent.width);
+	viewport.height = static_cast<float>(outputExtent.height);
+	viewport.maxDepth = 1.0f;
+	VkRect2D scissor{};
+	scissor.extent = outputExtent;
+	dispatch.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, compositePipeline);
+	dispatch.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	dispatch.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	dispatch.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentSet], 0, nullptr);
+	pushSettings(commandBuffer, dispatch, sourceUvScale, settings);
+	dispatch.vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryTelemetry.h"
+#include "MemoryTypeTable.h"
+#include "VulkanDispatch.h"
+
+#include <cstdint>
+
+// The scene is rendered into an HDR scene color target and brought to the swap chain by a fused post-processing chain
+// of up to three steps, so each full-screen image is read about once:
+//  temporal  - optional, one compute dispatch (shaders/taa.comp) at output resolution: temporal anti-aliasing and
+//              upscaling. The scene is rendered with a sub-pixel jitter (getJitter) and writes per-pixel motion; each
+//              output pixel reconstructs the current frame from the jittered samples around it, reprojects the
+//              accumulated history along the motion, clips it to the current neighbourhood's colors (history
+//              rectification, which rejects disoccluded and changed pixels) and blends. The result is the next
+//              frame's history, and the source of the following steps.
+//  bloom     - one compute dispatch (shaders/bloom.comp) at a quarter of the resolution: bright pass, downsample and a
+//              separable Gaussian blur, all in shared memory. Bloom needs a wide neighbourhood, so it can't be fused
+//              into the per-pixel step.
+//  composite - one full-screen triangle (shaders/post.frag) drawn straight into the swap chain image: bloom composite,
+//              exposure, tonemapping, color grading, FXAA and vignette. FXAA's neighbour taps rerun the composite,
+//              tonemap and grade in registers instead of reading a stored tonemapped image. FXAA is skipped when the
+//              temporal step runs, which anti-aliases already.
+// The composite is a fragment pass rather than compute, because sRGB swap chain formats rarely support storage, and it
+// shares its rendering with the HUD, so the swap chain image is written exactly once.
+//
+// The scene may cover only the top left renderExtent of scene color (dynamic resolution, DynamicResolution.h). The
+// temporal step upscales it to the output; without it, bloom and the composite read just that part, and the
+// composite's bilinear taps upscale it.
+//
+// With MSAA the scene is rendered into multisampled color and motion attachments instead, which the rendering resolves
+// into scene color and motion as it ends (getSceneAttachments). They are transient: never loaded or stored, in lazily
+// allocated memory when the device has it, so tile-based GPUs keep the samples in tile memory and only the resolved
+// pixels are written out.
+//
+// One set of targets is shared by the frames in flight, ordered by barriers like the depth buffer. The history is two
+// images, written and read alternately.
+class PostProcessChain {
+public:
+	static constexpr VkFormat SCENE_COLOR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+	// Matches StressScene::MOTION_FORMAT
+	static constexpr VkFormat MOTION_FORMAT = VK_FORMAT_R16G16_SFLOAT;
+	// Bloom texels cover this many scene texels in each direction
+	static constexpr uint32_t BLOOM_DOWNSAMPLE = 4;
+	// Length of the jitter sequence, Halton (2, 3)
+	static constexpr uint32_t JITTER_PHASES = 8;
+
+	struct Settings {
+		// Scene color multiplier before tonemapping
+		float exposure = 1.0f;
+		// Exposed brightness above which pixels bloom, and how much of the bloom is added back
+		float bloomThreshold = 1.0f;
+		float bloomStrength = 0.25f;
+		// Grading after tonemapping: 1 leaves the image unchanged
+		float saturation = 1.1f;
+		float contrast = 1.05f;
+		// Darkening at the corners, 0 for none
+		float vignette = 0.2f;
+		bool bloom = true;
+		bool fxaa = true;
+		// Temporal anti-aliasing and upscaling
+		bool taa = false;
+	};
+
+	// Pipelines drawing into outputFormat, the swap chain's
+	void create(VkDevice device, VkFormat outputFormat, const VkAllocationCallbacks* pAllocator);
+	void destroy(VkDevice device, const VkAllocationCallbacks* pAllocator);
+	// Scene color, motion, history and bloom for extent, the output and the largest the scene is rendered at, and the
+	// multisampled attachments when samples is above 1; recreated with the swap chain, while the device is idle. Starts
+	// a new history. Bloom is cleared on queue, so the composite can sample it before the bloom pass first runs.
+	void createTargets(VkDevice device, VkQueue queue, uint32_t queueFamily, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkExtent2D extent, VkSampleCountFlagBits samples, const VkAllocationCallbacks* pAllocator);
+	void destroyTargets(VkDevice device, DeviceMemoryTelemetry& telemetry, const VkAllocationCallbacks* pAllocator);
+
+	VkSampleCountFlagBits getSampleCount() const { return samples; }
+	// Color and motion attachments of the scene's rendering, cleared to clearColor and zero motion, and resolved into
+	// scene color and motion when multisampled
+	void getSceneAttachments(const VkClearColorValue& clearColor, VkRenderingAttachmentInfo attachments[2]) const;
+	// Sub-pixel offset to render the next frame with, in pixels within +-0.5; zero without the temporal step
+	void getJitter(const Settings& settings, float jitter[2]) const;
+
+	// Before the scene's rendering: scene color and motion become color attachments once earlier frames stop reading
+	// them
+	void beginScene(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch) const;
+	// After the scene's rendering of renderExtent: scene color and motion become readable, and the temporal step runs
+	void endScene(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, VkExtent2D renderExtent, const Settings& settings);
+	// The bloom of the frame endScene finished
+	void drawBloom(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, const Settings& settings) const;
+	// Inside a rendering of the output image: the fused composite
+	void draw(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, VkExtent2D outputExtent, const Settings& settings) const;
+
+private:
+	struct Target {
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkExtent2D extent = {};
+	};
+
+	// Set 0 reads scene color; sets 1 and 2 run the temporal step into history 0 and 1 and read the result
+	static constexpr uint32_t DESCRIPTOR_SET_COUNT = 3;
+
+	// Transient usage allocates MemoryUsage::Transient memory
+	void createTarget(VkDevice device, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkExtent2D extent, VkFormat format, VkSampleCountFlagBits targetSamples, VkImageUsageFlags usage, const VkAllocationCallbacks* pAllocator, Target& target);
+	// Point the descriptor sets at the targets, once both exist
+	void clearBloom(VkDevice device, VkQueue queue, uint32_t queueFamily, const VkAllocationCallbacks* pAllocator);
+	void writeDescriptors(VkDevice device);
+	void pushSettings(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, const float uvScale[2], const Settings& settings) const;
+
+	Target sceneColor;
+	Target motion;
+	// Rendered to and resolved from with MSAA, otherwise empty
+	Target multisampledColor;
+	Target multisampledMotion;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	Target history[2];
+	Target bloom;
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSets[DESCRIPTOR_SET_COUNT] = {};
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline temporalPipeline = VK_NULL_HANDLE;
+	VkPipeline bloomPipeline = VK_NULL_HANDLE;
+	VkPipeline compositePipeline = VK_NULL_HANDLE;
+
+	// State of the frame between endScene and draw: the set to read with, and the part of its source the scene covers
+	uint32_t currentSet = 0;
+	float sourceUvScale[2] = { 1.0f, 1.0f };
+	// Frames resolved into the history, which is empty until the first; the newest is in history[historyIndex]
+	uint64_t temporalFrames = 0;
+	uint32_t historyIndex = 0;
+};
@@ -0,0 +1,188 @@
+#include "QueueUtilization.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+void QueueUtilization::create(VkDevice device, const DeviceDispatch& dispatch, const VkPhysicalDeviceLimits& limits, uint32_t frameCount, const VkAllocationCallbacks* pAllocator) {
+	this->device = device;
+	this->dispatch = &dispatch;
+	timestampPeriod = limits.timestampPeriod;
+	supported = limits.timestampPeriod > 0.0f;
+	if (!supported) {
+		return;
+	}
+
+	// Two queries per submission
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = 2 * MAX_SUBMITS_PER_FRAME;
+	slots.resize(frameCount);
+	for (FrameSlot& slot : slots) {
+		if (vkCreateQueryPool(device, &poolInfo, pAllocator, &slot.queryPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create queue timestamp query pool!");
+		}
+	}
+}
+
+void QueueUtilization::destroy(VkDevice device, const VkAllocationCallbacks* pAllocator) {
+	for (FrameSlot& slot : slots) {
+		vkDestroyQueryPool(device, slot.queryPool, pAllocator);
+	}
+	slots.clear();
+	current = nullptr;
+}
+
+uint32_t QueueUtilization::addQueue(const char* name, uint32_t timestampValidBits) {
+	if (queueCount == MAX_QUEUES) {
+		throw std::runtime_error("Too many queues for queue utilization tracking!");
+	}
+	queueSupported[queueCount] = timestampValidBits > 0;
+	timestampMask[queueCount] = timestampValidBits >= 64 ? UINT64_MAX : (uint64_t(1) << timestampValidBits) - 1;
+	latest[queueCount].name = name;
+	totals[queueCount].name = name;
+	return queueCount++;
+}
+
+void QueueUtilization::beginFrame(uint32_t frameIndex) {
+	if (!supported) {
+		return;
+	}
+	current = &slots[frameIndex];
+	if (current->recorded && current->submitCount > 0) {
+		uint64_t timestamps[2 * MAX_SUBMITS_PER_FRAME];
+		if (dispatch->vkGetQueryPoolResults(device, current->queryPool, 0, 2 * current->submitCount, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+			uint64_t frameBegin = UINT64_MAX;
+			bool wrapped = false;
+			for (uint32_t i = 0; i < current->submitCount; i++) {
+				Submission& submission = current->submissions[i];
+				submission.begin = timestamps[2 * i] & timestampMask[submission.queue];
+				submission.end = timestamps[2 * i + 1] & timestampMask[submission.queue];
+				wrapped = wrapped || submission.end < submission.begin;
+				frameBegin = std::min(frameBegin, submission.begin);
+			}
+			for (uint32_t i = 0; i < current->submitCount; i++) {
+				Submission& submission = current->submissions[i];
+				submission.signalEnd = submission.waitsOn < current->submitCount ? current->submissions[submission.waitsOn].end : 0;
+			}
+			// This frame's start closes the previous frame's window
+			if (previousCount > 0 && !wrapped) {
+				finalizeFrame(frameBegin);
+			}
+			previousCount = wrapped ? 0 : current->submitCount;
+			std::copy(current->submissions, current->submissions + previousCount, previous);
+		}
+	}
+	current->submitCount = 0;
+	current->recorded = true;
+}
+
+uint32_t QueueUtilization::beginSubmit(VkCommandBuffer commandBuffer, uint32_t queue) {
+	if (!supported || !queueSupported[queue] || current->submitCount == MAX_SUBMITS_PER_FRAME) {
+		return UINT32_MAX;
+	}
+	uint32_t submission = current->submitCount++;
+	current->submissions[submission].queue = queue;
+	current->submissions[submission].waitsOn = UINT32_MAX;
+	dispatch->vkCmdResetQueryPool(commandBuffer, current->queryPool, 2 * submission, 2);
+	dispatch->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current->queryPool, 2 * submission);
+	return submission;
+}
+
+void QueueUtilization::endSubmit(VkCommandBuffer commandBuffer, uint32_t submission) {
+	if (submission == UINT32_MAX) {
+		return;
+	}
+	dispatch->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current->queryPool, 2 * submission + 1);
+}
+
+void QueueUtilization::addWait(uint32_t submission, uint32_t signalSubmission) {
+	if (submission != UINT32_MAX) {
+		current->submissions[submission].waitsOn = signalSubmission;
+	}
+}
+
+void QueueUtilization::finalizeFrame(uint64_t nextFrameBegin) {
+	uint64_t frameBegin = UINT64_MAX;
+	for (uint32_t i = 0; i < previousCount; i++) {
+		frameBegin = std::min(frameBegin, previous[i].begin);
+	}
+	if (nextFrameBegin <= frameBegin) {
+		return;
+	}
+	// Submissions in GPU start order
+	std::sort(previous, previous + previousCount, [](const Submission& a, const Submission& b) { return a.begin < b.begin; });
+
+	for (uint32_t queue = 0; queue < queueCount; queue++) {
+		uint64_t cursor = frameBegin;
+		uint64_t busy = 0, submissionIdle = 0, crossQueueIdle = 0;
+		for (uint32_t i = 0; i < previousCount; i++) {
+			const Submission& submission = previous[i];
+			if (submission.queue != queue) {
+				continue;
+			}
+			uint64_t begin = std::min(submission.begin, nextFrameBegin);
+			uint64_t end = std::min(submission.end, nextFrameBegin);
+			// Until the other queue's work ends, the queue is held up by it, whether or not this submission has started
+			uint64_t signalEnd = std::min(submission.signalEnd, end);
+			if (signalEnd > cursor) {
+				crossQueueIdle += signalEnd - cursor;
+				cursor = signalEnd;
+			}
+			if (begin > cursor) {
+				submissionIdle += begin - cursor;
+				cursor = begin;
+			}
+			if (end > cursor) {
+				busy += end - cursor;
+				cursor = end;
+			}
+		}
+		// Nothing more was submitted to this queue before the next frame started
+		submissionIdle += nextFrameBegin - cursor;
+
+		QueueStats& stats = latest[queue];
+		stats.windowMilliseconds = toMilliseconds(nextFrameBegin - frameBegin);
+		stats.busyMilliseconds = toMilliseconds(busy);
+		stats.submissionIdleMilliseconds = toMilliseconds(submissionIdle);
+		stats.crossQueueIdleMilliseconds = toMilliseconds(crossQueueIdle);
+		stats.utilization = stats.busyMilliseconds / stats.windowMilliseconds;
+
+		QueueStats& total = totals[queue];
+		total.windowMilliseconds += stats.windowMilliseconds;
+		total.busyMilliseconds += stats.busyMilliseconds;
+		total.submissionIdleMilliseconds += stats.submissionIdleMilliseconds;
+		total.crossQueueIdleMilliseconds += stats.crossQueueIdleMilliseconds;
+	}
+	frameCount++;
+}
+
+void QueueUtilization::print(std::ostream& out) const {
+	if (!supported || frameCount == 0) {
+		return;
+	}
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(2);
+	out << "Queue utilization over " << frameCount << " frames:" << std::endl;
+	for (uint32_t queue = 0; queue < queueCount; queue++) {
+		const QueueStats& total = totals[queue];
+		if (!queueSupported[queue]) {
+			out << "  " << total.name << ": no timestamp support" << std::endl;
+			continue;
+		}
+		double utilization = total.windowMilliseconds > 0.0 ? total.busyMilliseconds / total.windowMilliseconds : 0.0;
+		out << "  " << total.name << ": " << utilization * 100.0 << "% busy, per frame "
+			<< total.busyMilliseconds / frameCount << " ms busy, "
+			<< total.submissionIdleMilliseconds / frameCount << " ms idle waiting on CPU submission, "
+			<< total.crossQueueIdleMilliseconds / frameCount << " ms idle waiting on other queues" << std::endl;
+	}
+	// The first queue carries the frame: if it sits idle mostly for lack of submissions, the CPU is the bottleneck
+	const QueueStats& primary = totals[0];
+	bool gpuBound = primary.busyMilliseconds >= 0.9 * primary.windowMilliseconds;
+	bool submissionBound = !gpuBound && primary.submissionIdleMilliseconds >= primary.crossQueueIdleMilliseconds;
+	out << "  Frames were " << (gpuBound ? "GPU bound" : submissionBound ? "CPU submission bound" : "bound by cross queue waits") << std::endl;
+	out.flags(flags);
+	out.precision(precision);
+}
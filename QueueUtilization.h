@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanDispatch.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Idle time ("bubbles") of each queue, from a timestamp pair around every submitted command buffer.
+// A frame's window on the GPU runs from its first submission starting to the next frame's first submission starting.
+// Within it, every stretch a queue spends without work is attributed to one of:
+//  - cross queue waits, up to the end of the other queue's submission that the next submission waits on
+//  - CPU submission latency otherwise: the queue was free, but the CPU hadn't submitted its next work yet
+// Semaphore waits usually block a later stage than the top of pipe timestamp, so a waiting submission can start
+// before the wait is signalled. It is counted as waiting rather than busy from its start until the signalling
+// submission ends, which overstates the wait by whatever work it gets done ahead of the waiting stage.
+// A queue that is busy for most of the window makes the frame GPU bound; idle time dominated by submission latency
+// means the CPU can't keep the GPU fed.
+//
+// Timestamps are masked to each queue's valid bits. Timestamps from different queues are compared directly, which
+// holds for queues of one device in practice; a frame across a timestamp counter wrap is left out.
+// Results are read back when a frame slot is reused after its fence, like GpuProfiler's.
+class QueueUtilization {
+public:
+	static constexpr uint32_t MAX_QUEUES = 4;
+	static constexpr uint32_t MAX_SUBMITS_PER_FRAME = 16;
+
+	struct QueueStats {
+		const char* name;
+		double windowMilliseconds;
+		double busyMilliseconds;
+		double submissionIdleMilliseconds;
+		double crossQueueIdleMilliseconds;
+		// busy / window
+		double utilization;
+	};
+
+	void create(VkDevice device, const DeviceDispatch& dispatch, const VkPhysicalDeviceLimits& limits, uint32_t frameCount, const VkAllocationCallbacks* pAllocator);
+	void destroy(VkDevice device, const VkAllocationCallbacks* pAllocator);
+	// Register a queue before the first frame. A queue family with no timestamp support is tracked as unsupported.
+	uint32_t addQueue(const char* name, uint32_t timestampValidBits);
+
+	// Read back frameIndex's submissions once its fence has signalled
+	void beginFrame(uint32_t frameIndex);
+	// Call first thing after vkBeginCommandBuffer, and last thing before vkEndCommandBuffer, of every submitted
+	// command buffer. Returns the submission to pass to endSubmit.
+	uint32_t beginSubmit(VkCommandBuffer commandBuffer, uint32_t queue);
+	void endSubmit(VkCommandBuffer commandBuffer, uint32_t submission);
+	// submission waits on a semaphore that signalSubmission, on another queue, signals when it completes
+	void addWait(uint32_t submission, uint32_t signalSubmission);
+
+	uint32_t getQueueCount() const { return queueCount; }
+	// Most recently completed frame
+	const QueueStats& getQueueStats(uint32_t queue) const { return latest[queue]; }
+	// Averages over the run and whether the frames were CPU submission or GPU bound
+	void print(std::ostream& out) const;
+
+private:
+	struct Submission {
+		uint32_t queue;
+		// Submission in the same frame this one waits on, UINT32_MAX for none
+		uint32_t waitsOn;
+		uint64_t begin;
+		uint64_t end;
+		// End of the submission waited on once read back, 0 for none
+		uint64_t signalEnd;
+	};
+	struct FrameSlot {
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		Submission submissions[MAX_SUBMITS_PER_FRAME] = {};
+		uint32_t submitCount = 0;
+		bool recorded = false;
+	};
+
+	// Attribute the idle time of the frame in previous, now that the next frame's start is known
+	void finalizeFrame(uint64_t nextFrameBegin);
+	double toMilliseconds(uint64_t ticks) const { return static_cast<double>(ticks) * timestampPeriod / 1000000.0; }
+
+	const DeviceDispatch* dispatch = nullptr;
+	VkDevice device = VK_NULL_HANDLE;
+	std::vector<FrameSlot> slots;
+	FrameSlot* current = nullptr;
+	double timestampPeriod = 1.0;
+	bool supported = false;
+
+	bool queueSupported[MAX_QUEUES] = {};
+	uint64_t timestampMask[MAX_QUEUES] = {};
+	uint32_t queueCount = 0;
+
+	Submission previous[MAX_SUBMITS_PER_FRAME] = {};
+	uint32_t previousCount = 0;
+
+	QueueStats latest[MAX_QUEUES] = {};
+	QueueStats totals[MAX_QUEUES] = {};
+	uint64_t frameCount = 0;
+};
@@ -0,0 +1,299 @@
+#include "RuntimeConfig.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+	std::string trim(const std::string& text) {
+		size_t first = 0;
+		size_t last = text.size();
+		while (first < last && std::isspace(static_cast<unsigned char>(text[first]))) {
+			first++;
+		}
+		while (last > first && std::isspace(static_cast<unsigned char>(text[last - 1]))) {
+			last--;
+		}
+		return text.substr(first, last - first);
+	}
+
+	std::string lower(std::string text) {
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+
+	std::runtime_error invalidValue(const std::string& key, const std::string& value) {
+		return std::runtime_error("Invalid value '" + value + "' for setting " + key + "!");
+	}
+
+	uint32_t parseUnsigned(const std::string& key, const std::string& value, uint32_t minimum) {
+		size_t used = 0;
+		unsigned long parsed = 0;
+		try {
+			parsed = std::stoul(value, &used);
+		}
+		catch (const std::exception&) {
+			throw invalidValue(key, value);
+		}
+		// stoul accepts a leading minus and wraps it around
+		if (used != value.size() || value[0] == '-' || parsed < minimum || parsed > UINT32_MAX) {
+			throw invalidValue(key, value);
+		}
+		return static_cast<uint32_t>(parsed);
+	}
+
+	float parseFraction(const std::string& key, const std::string& value) {
+		size_t used = 0;
+		float parsed = 0.0f;
+		try {
+			parsed = std::stof(value, &used);
+		}
+		catch (const std::exception&) {
+			throw invalidValue(key, value);
+		}
+		if (used != value.size() || parsed < 0.0f || parsed > 1.0f) {
+			throw invalidValue(key, value);
+		}
+		return parsed;
+	}
+
+	float parseNonNegative(const std::string& key, const std::string& value) {
+		size_t used = 0;
+		float parsed = 0.0f;
+		try {
+			parsed = std::stof(value, &used);
+		}
+		catch (const std::exception&) {
+			throw invalidValue(key, value);
+		}
+		if (used != value.size() || !(parsed >= 0.0f)) {
+			throw invalidValue(key, value);
+		}
+		return parsed;
+	}
+
+	bool parseBool(const std::string& key, const std::string& value) {
+		std::string text = lower(value);
+		if (text == "1" || text == "true" || text == "on" || text == "yes") {
+			return true;
+		}
+		if (text == "0" || text == "false" || text == "off" || text == "no") {
+			return false;
+		}
+		throw invalidValue(key, value);
+	}
+
+	VkPresentModeKHR parsePresentMode(const std::string& key, const std::string& value) {
+		std::string text = lower(value);
+		if (text == "immediate") {
+			return VK_PRESENT_MODE_IMMEDIATE_KHR;
+		}
+		if (text == "mailbox") {
+			return VK_PRESENT_MODE_MAILBOX_KHR;
+		}
+		if (text == "fifo") {
+			return VK_PRESENT_MODE_FIFO_KHR;
+		}
+		if (text == "fifo_relaxed") {
+			return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+		}
+		throw invalidValue(key, value);
+	}
+
+	// "major.minor", the patch level is irrelevant to what the instance exposes
+	uint32_t parseApiVersion(const std::string& key, const std::string& value) {
+		size_t dot = value.find('.');
+		if (dot == std::string::npos) {
+			throw invalidValue(key, value);
+		}
+		uint32_t major = parseUnsigned(key, value.substr(0, dot), 1);
+		uint32_t minor = parseUnsigned(key, value.substr(dot + 1), 0);
+		if (major != 1 || minor < 3) {
+			throw std::runtime_error("Setting " + key + " must be 1.3 or later!");
+		}
+		return VK_MAKE_API_VERSION(0, major, minor, 0);
+	}
+}
+
+bool splitSetting(const std::string& text, std::string& key, std::string& value) {
+	size_t equals = text.find('=');
+	if (equals == std::string::npos) {
+		return false;
+	}
+	key = trim(text.substr(0, equals));
+	value = trim(text.substr(equals + 1));
+	return !key.empty();
+}
+
+void RuntimeConfig::set(const std::string& key, const std::string& value) {
+	if (key == "width") {
+		width = parseUnsigned(key, value, 1);
+	}
+	else if (key == "height") {
+		height = parseUnsigned(key, value, 1);
+	}
+	else if (key == "framesInFlight") {
+		framesInFlight = parseUnsigned(key, value, 1);
+	}
+	else if (key == "presentMode") {
+		presentMode = parsePresentMode(key, value);
+	}
+	else if (key == "validation") {
+		validation = parseBool(key, value);
+	}
+	else if (key == "apiVersion") {
+		apiVersion = parseApiVersion(key, value);
+	}
+	else if (key == "workers") {
+		workerCount = parseUnsigned(key, value, 0);
+	}
+	else if (key == "hud") {
+		hudVisible = parseBool(key, value);
+	}
+	else if (key == "pipelineStatistics") {
+		pipelineStatistics = parseBool(key, value);
+	}
+	else if (key == "memoryBudget") {
+		memoryBudget = parseBool(key, value);
+	}
+	else if (key == "telemetry") {
+		telemetry = parseBool(key, value);
+	}
+	else if (key == "asyncCompute") {
+		asyncCompute = parseBool(key, value);
+	}
+	else if (key == "msaa") {
+		msaaSamples = parseUnsigned(key, value, 1);
+		if (msaaSamples > 64 || (msaaSamples & (msaaSamples - 1)) != 0) {
+			throw invalidValue(key, value);
+		}
+	}
+	else if (key == "frames") {
+		frames = parseUnsigned(key, value, 0);
+	}
+	else if (key == "strictAllocations") {
+		strictFrameAllocations = parseBool(key, value);
+	}
+	else if (key == "scene.objects") {
+		scene.objectCount = parseUnsigned(key, value, 0);
+		sceneEnabled = scene.objectCount > 0;
+	}
+	else if (key == "scene.meshes") {
+		scene.uniqueMeshCount = parseUnsigned(key, value, 1);
+	}
+	else if (key == "scene.materials") {
+		scene.materialCount = parseUnsigned(key, value, 1);
+	}
+	else if (key == "scene.lights") {
+		scene.lightCount = parseUnsigned(key, value, 0);
+	}
+	else if (key == "scene.motion") {
+		scene.motionRatio = parseFraction(key, value);
+	}
+	else if (key == "scene.seed") {
+		scene.seed = parseUnsigned(key, value, 0);
+	}
+	else if (key == "post.exposure") {
+		post.exposure = parseNonNegative(key, value);
+	}
+	else if (key == "post.bloom") {
+		post.bloom = parseBool(key, value);
+	}
+	else if (key == "post.bloomThreshold") {
+		post.bloomThreshold = parseNonNegative(key, value);
+	}
+	else if (key == "post.bloomStrength") {
+		post.bloomStrength = parseNonNegative(key, value);
+	}
+	else if (key == "post.fxaa") {
+		post.fxaa = parseBool(key, value);
+	}
+	else if (key == "post.taa") {
+		post.taa = parseBool(key, value);
+	}
+	else if (key == "dynamicResolution") {
+		dynamicResolution.enabled = parseBool(key, value);
+	}
+	else if (key == "dynamicResolution.targetMs") {
+		dynamicResolution.targetMilliseconds = parseNonNegative(key, value);
+	}
+	else if (key == "dynamicResolution.minScale") {
+		dynamicResolution.minScale = parseFraction(key, value);
+	}
+	else if (key == "dynamicResolution.maxScale") {
+		dynamicResolution.maxScale = parseFraction(key, value);
+	}
+	else {
+		throw std::runtime_error("Unknown setting " + key + "!");
+	}
+}
+
+void RuntimeConfig::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open config " + path + "!");
+	}
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = trim(line.substr(0, line.find('#')));
+		if (line.empty()) {
+			continue;
+		}
+		std::string key, value;
+		if (!splitSetting(line, key, value)) {
+			throw std::runtime_error("Expected key = value on line " + std::to_string(lineNumber) + " of " + path + "!");
+		}
+		set(key, value);
+	}
+}
+
+bool RuntimeConfig::parseArgument(const std::string& argument) {
+	// Flags may carry paths containing '='
+	if (argument.compare(0, 2, "--") == 0) {
+		return false;
+	}
+	std::string key, value;
+	if (!splitSetting(argument, key, value)) {
+		return false;
+	}
+	set(key, value);
+	return true;
+}
+
+uint32_t RuntimeConfig::getWorkerCount() const {
+	if (workerCount > 0) {
+		return workerCount;
+	}
+	// hardware_concurrency may not know, and returns 0
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void RuntimeConfig::printKeys(std::ostream& out) {
+	out << "Settings (key = value):" << std::endl
+		<< "  width, height        window size in pixels" << std::endl
+		<< "  framesInFlight       frames the CPU may record ahead of the GPU" << std::endl
+		<< "  presentMode          immediate, mailbox, fifo or fifo_relaxed" << std::endl
+		<< "  validation           validation layers on or off" << std::endl
+		<< "  apiVersion           instance API version, 1.3 or later" << std::endl
+		<< "  workers              workers for parallel CPU stages, 0 for one per core" << std::endl
+		<< "  hud                  show the performance HUD from the first frame" << std::endl
+		<< "  pipelineStatistics   pipeline statistics queries, when supported" << std::endl
+		<< "  memoryBudget         VK_EXT_memory_budget, when supported" << std::endl
+		<< "  telemetry            publish per-frame telemetry on the telemetry socket" << std::endl
+		<< "  asyncCompute         compute work on a compute-only queue, when the device has one" << std::endl
+		<< "  msaa                 samples per pixel of the scene: 1, 2, 4, 8..., up to what the device supports" << std::endl
+		<< "  frames               frames to render before closing, 0 to run until closed" << std::endl
+		<< "  strictAllocations    fail the run on the first heap allocation in a frame after warmup" << std::endl
+		<< "  scene.objects        stress scene objects, 0 for the empty frame" << std::endl
+		<< "  scene.meshes, scene.materials, scene.lights, scene.motion, scene.seed" << std::endl
+		<< "  post.bloom           bloom on or off" << std::endl
+		<< "  post.fxaa            FXAA on or off, skipped with post.taa" << std::endl
+		<< "  post.taa             temporal anti-aliasing, upscaling below full resolution" << std::endl
+		<< "  post.exposure, post.bloomThreshold, post.bloomStrength" << std::endl
+		<< "  dynamicResolution    scale the render resolution to hold dynamicResolution.targetMs of GPU time" << std::endl
+		<< "  dynamicResolution.targetMs, dynamicResolution.minScale, dynamicResolution.maxScale" << std::endl;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DynamicResolution.h"
+#include "PostProcess.h"
+#include "SceneGenerator.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Settings chosen at launch rather than at build time, so one binary can be measured across resolutions, pacing
+// and feature sets. Settings are applied in order, later ones winning:
+//  --config <file>  lines of "key = value", # starts a comment
+//  key=value        on the command line
+// printKeys() lists every key. The sweep driver (BenchmarkSweep.h) applies its combinations the same way.
+struct RuntimeConfig {
+	// Window size, which the swap chain follows
+	uint32_t width = 1920;
+	uint32_t height = 1080;
+	// Number of frames the CPU may record ahead of the GPU
+	uint32_t framesInFlight = 2;
+	// Used when the surface supports it, otherwise FIFO, the only mode guaranteed to exist
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+#ifdef NDEBUG
+	bool validation = false;
+#else
+	bool validation = true;
+#endif
+	// Instance API version; the renderer needs 1.3 for dynamic rendering
+	uint32_t apiVersion = VK_MAKE_API_VERSION(0, 1, 3, 249);
+	// Workers for the parallel CPU stages, 0 for one per core
+	uint32_t workerCount = 0;
+
+	// Feature toggles. Statistics queries and the memory budget also need the device to support them.
+	bool hudVisible = false;
+	bool pipelineStatistics = true;
+	bool memoryBudget = true;
+	bool telemetry = true;
+	// Run independent compute work on a compute-only queue family when the device has one
+	bool asyncCompute = true;
+	// Samples per pixel of the scene's rendering, a power of two; lowered to what the device supports
+	uint32_t msaaSamples = 1;
+
+	// Frames to render before closing, 0 to run until the window is closed
+	uint32_t frames = 0;
+	// Fail the run on the first frame after warmup that allocates from the heap. STRICT_FRAME_ALLOCATIONS turns it on
+	// by default.
+#ifdef STRICT_FRAME_ALLOCATIONS
+	bool strictFrameAllocations = true;
+#else
+	bool strictFrameAllocations = false;
+#endif
+	// Generated stress scene, rendered instead of the empty frame when enabled
+	bool sceneEnabled = false;
+	SceneParameters scene;
+	// Post-processing of the rendered frame
+	PostProcessChain::Settings post;
+	// Render scale chosen each frame to hold a GPU time budget
+	DynamicResolutionController::Settings dynamicResolution;
+
+	// Apply one setting; throws on an unknown key or a value that doesn't parse
+	void set(const std::string& key, const std::string& value);
+	// Apply every setting in a file
+	void load(const std::string& path);
+	// Apply a "key=value" argument. Returns false if argument isn't one.
+	bool parseArgument(const std::string& argument);
+
+	// workerCount with 0 resolved to the number of cores
+	uint32_t getWorkerCount() const;
+	static void printKeys(std::ostream& out);
+};
+
+// Split "key = value" around the first '=', trimming both. Returns false if there is no '=' or no key.
+bool splitSetting(const std::string& text, std::string& key, std::string& value);
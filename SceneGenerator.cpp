@@ -0,0 +1,196 @@
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+	const float PI = 3.14159265358979f;
+	// Distance between neighbouring objects on average
+	const float OBJECT_SPACING = 3.0f;
+
+	// SplitMix64. The standard library's distributions are implementation defined, so scenes would differ
+	// between compilers; this produces the same sequence everywhere.
+	class SceneRandom {
+	public:
+		explicit SceneRandom(uint64_t seed) : state(seed) {}
+
+		uint64_t next() {
+			uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+		// [0, 1)
+		float uniform() { return static_cast<float>(next() >> 40) / static_cast<float>(1ull << 24); }
+		float range(float low, float high) { return low + (high - low) * uniform(); }
+		uint32_t below(uint32_t count) { return static_cast<uint32_t>(next() % count); }
+
+	private:
+		uint64_t state;
+	};
+
+	// A UV sphere with a random tessellation, a random radius per ring and lobes around its axis, so every mesh has
+	// its own silhouette and vertex count. Triangles wind counter-clockwise seen from outside.
+	void generateMesh(SceneRandom& random, GeneratedScene& scene) {
+		uint32_t rings = 3 + random.below(14);
+		uint32_t segments = 4 + random.below(28);
+		uint32_t lobes = random.below(5);
+		float lobeAmplitude = random.range(0.0f, 0.25f);
+
+		SceneMesh mesh{};
+		mesh.firstIndex = static_cast<uint32_t>(scene.indices.size());
+		mesh.vertexOffset = static_cast<int32_t>(scene.vertices.size());
+		size_t firstVertex = scene.vertices.size();
+		for (uint32_t ring = 0; ring <= rings; ring++) {
+			float theta = PI * ring / rings;
+			float ringRadius = random.range(0.7f, 1.0f);
+			for (uint32_t segment = 0; segment <= segments; segment++) {
+				float phi = 2.0f * PI * segment / segments;
+				float radius = ringRadius * (1.0f + lobeAmplitude * std::sin(lobes * phi));
+				SceneVertex vertex{};
+				vertex.position[0] = radius * std::sin(theta) * std::cos(phi);
+				vertex.position[1] = std::cos(theta);
+				vertex.position[2] = radius * std::sin(theta) * std::sin(phi);
+				scene.vertices.push_back(vertex);
+			}
+		}
+		for (uint32_t ring = 0; ring < rings; ring++) {
+			for (uint32_t segment = 0; segment < segments; segment++) {
+				uint32_t a = ring * (segments + 1) + segment;
+				uint32_t b = a + segments + 1;
+				uint32_t c = a + 1;
+				uint32_t d = b + 1;
+				uint32_t triangles[6] = { a, c, b, c, d, b };
+				scene.indices.insert(scene.indices.end(), triangles, triangles + 6);
+			}
+		}
+		mesh.indexCount = static_cast<uint32_t>(scene.indices.size()) - mesh.firstIndex;
+
+		// Smooth normals: area weighted sum of the face normals around each vertex
+		SceneVertex* vertices = scene.vertices.data() + firstVertex;
+		for (uint32_t i = mesh.firstIndex; i < mesh.firstIndex + mesh.indexCount; i += 3) {
+			SceneVertex* corners[3] = { &vertices[scene.indices[i]], &vertices[scene.indices[i + 1]], &vertices[scene.indices[i + 2]] };
+			float edge1[3], edge2[3];
+			for (uint32_t axis = 0; axis < 3; axis++) {
+				edge1[axis] = corners[1]->position[axis] - corners[0]->position[axis];
+				edge2[axis] = corners[2]->position[axis] - corners[0]->position[axis];
+			}
+			float normal[3] = {
+				edge1[1] * edge2[2] - edge1[2] * edge2[1],
+				edge1[2] * edge2[0] - edge1[0] * edge2[2],
+				edge1[0] * edge2[1] - edge1[1] * edge2[0],
+			};
+			for (SceneVertex* corner : corners) {
+				for (uint32_t axis = 0; axis < 3; axis++) {
+					corner->normal[axis] += normal[axis];
+				}
+			}
+		}
+		for (uint32_t ring = 0; ring <= rings; ring++) {
+			for (uint32_t segment = 0; segment <= segments; segment++) {
+				float* normal = vertices[ring * (segments + 1) + segment].normal;
+				// Every pole vertex sits on the axis, but some only touch degenerate triangles
+				if (ring == 0 || ring == rings) {
+					normal[0] = 0.0f;
+					normal[1] = ring == 0 ? 1.0f : -1.0f;
+					normal[2] = 0.0f;
+					continue;
+				}
+				float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				for (uint32_t axis = 0; axis < 3; axis++) {
+					normal[axis] /= length;
+				}
+			}
+		}
+		scene.meshes.push_back(mesh);
+	}
+}
+
+GeneratedScene generateScene(const SceneParameters& parameters) {
+	if (parameters.uniqueMeshCount == 0 || parameters.materialCount == 0) {
+		throw std::runtime_error("Stress scene needs at least one mesh and one material!");
+	}
+	// Independent streams, so changing one count doesn't reshuffle everything else. Each stream's seed is drawn from
+	// a generator seeded with the scene seed, so every seed gets its own well-mixed set of streams.
+	SceneRandom streamSeeds(parameters.seed);
+	SceneRandom meshRandom(streamSeeds.next());
+	SceneRandom materialRandom(streamSeeds.next());
+	SceneRandom lightRandom(streamSeeds.next());
+	SceneRandom objectRandom(streamSeeds.next());
+
+	GeneratedScene scene;
+	scene.extent = 0.5f * OBJECT_SPACING * std::cbrt(static_cast<float>(std::max(parameters.objectCount, 1u)));
+
+	for (uint32_t i = 0; i < parameters.uniqueMeshCount; i++) {
+		generateMesh(meshRandom, scene);
+	}
+
+	scene.materials.resize(parameters.materialCount);
+	for (SceneMaterial& material : scene.materials) {
+		material.baseColor[0] = materialRandom.range(0.05f, 1.0f);
+		material.baseColor[1] = materialRandom.range(0.05f, 1.0f);
+		material.baseColor[2] = materialRandom.range(0.05f, 1.0f);
+		material.baseColor[3] = 1.0f;
+		material.roughness = materialRandom.range(0.1f, 1.0f);
+		material.metallic = materialRandom.uniform() < 0.3f ? 1.0f : 0.0f;
+	}
+
+	scene.lights.resize(parameters.lightCount);
+	for (SceneLight& light : scene.lights) {
+		for (float& coordinate : light.position) {
+			coordinate = lightRandom.range(-scene.extent, scene.extent);
+		}
+		light.radius = 5.0f + lightRandom.range(0.15f, 0.35f) * scene.extent;
+		light.color[0] = lightRandom.range(0.3f, 1.0f);
+		light.color[1] = lightRandom.range(0.3f, 1.0f);
+		light.color[2] = lightRandom.range(0.3f, 1.0f);
+		light.color[3] = lightRandom.range(1.0f, 4.0f);
+	}
+
+	// Pick a mesh for every object, then lay the objects out sorted by mesh
+	std::vector<uint32_t> objectMeshes(parameters.objectCount);
+	for (uint32_t& mesh : objectMeshes) {
+		mesh = objectRandom.below(parameters.uniqueMeshCount);
+		scene.meshes[mesh].objectCount++;
+	}
+	uint32_t firstObject = 0;
+	for (SceneMesh& mesh : scene.meshes) {
+		mesh.firstObject = firstObject;
+		firstObject += mesh.objectCount;
+		mesh.objectCount = 0;
+	}
+	scene.objects.resize(parameters.objectCount);
+	for (uint32_t i = 0; i < parameters.objectCount; i++) {
+		SceneMesh& mesh = scene.meshes[objectMeshes[i]];
+		SceneObject& object = scene.objects[mesh.firstObject + mesh.objectCount++];
+		for (float& coordinate : object.position) {
+			coordinate = objectRandom.range(-scene.extent, scene.extent);
+		}
+		object.scale = objectRandom.range(0.5f, 1.25f);
+		object.material = objectRandom.below(parameters.materialCount);
+		object.phase = objectRandom.range(0.0f, 2.0f * PI);
+		object.speed = objectRandom.range(0.5f, 2.0f);
+		object.motionIndex = objectRandom.uniform() < parameters.motionRatio ? 0 : STATIC_OBJECT;
+	}
+	for (uint32_t i = 0; i < parameters.objectCount; i++) {
+		if (scene.objects[i].motionIndex != STATIC_OBJECT) {
+			scene.objects[i].motionIndex = static_cast<uint32_t>(scene.movingObjects.size());
+			scene.movingObjects.push_back(i);
+		}
+	}
+	return scene;
+}
+
+void animateScene(const GeneratedScene& scene, double seconds, uint32_t first, uint32_t count, float* positionScale) {
+	positionScale += 4 * static_cast<size_t>(first);
+	for (uint32_t i = first; i < first + count; i++) {
+		const SceneObject& object = scene.objects[scene.movingObjects[i]];
+		float angle = static_cast<float>(std::fmod(seconds * object.speed + object.phase, 2.0 * PI));
+		positionScale[0] = object.position[0] + SCENE_MOTION_AMPLITUDE * std::cos(angle);
+		positionScale[1] = object.position[1] + SCENE_MOTION_AMPLITUDE * std::sin(2.0f * angle) * 0.5f;
+		positionScale[2] = object.position[2] + SCENE_MOTION_AMPLITUDE * std::sin(angle);
+		positionScale[3] = object.scale;
+		positionScale += 4;
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Procedural stress scenes for scaling benchmarks, so the renderer can be measured from 1k to 1M objects without
+// shipping assets. Everything is derived from the seed: the same parameters always produce the same scene.
+struct SceneParameters {
+	uint32_t objectCount = 1000;
+	uint32_t uniqueMeshCount = 16;
+	uint32_t materialCount = 32;
+	uint32_t lightCount = 16;
+	// Fraction of objects whose position is rewritten by the CPU every frame
+	float motionRatio = 0.1f;
+	uint32_t seed = 1;
+};
+
+struct SceneVertex {
+	float position[3];
+	float normal[3];
+};
+
+// Objects are sorted by mesh, so each mesh is one instanced draw of [firstObject, firstObject + objectCount)
+struct SceneMesh {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+	uint32_t firstObject;
+	uint32_t objectCount;
+};
+
+// The layouts below match the std430 structs in shaders/scene.vert and shaders/scene.frag
+struct SceneMaterial {
+	float baseColor[4];
+	float roughness;
+	float metallic;
+	float padding[2];
+};
+
+struct SceneLight {
+	float position[3];
+	float radius;
+	float color[4];
+};
+
+// Objects that don't move have motionIndex STATIC_OBJECT
+const uint32_t STATIC_OBJECT = UINT32_MAX;
+
+struct SceneObject {
+	float position[3];
+	float scale;
+	uint32_t material;
+	uint32_t motionIndex;
+	// Orbit of moving objects around position
+	float phase;
+	float speed;
+};
+
+struct GeneratedScene {
+	std::vector<SceneVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<SceneMesh> meshes;
+	std::vector<SceneMaterial> materials;
+	std::vector<SceneLight> lights;
+	std::vector<SceneObject> objects;
+	// Index into objects of each moving object, in motionIndex order
+	std::vector<uint32_t> movingObjects;
+	// Objects fill a cube of this half size around the origin
+	float extent;
+};
+
+GeneratedScene generateScene(const SceneParameters& parameters);
+
+// Largest distance of a mesh vertex from its object's position, per unit of scale
+const float SCENE_MESH_RADIUS = 1.25f;
+// Largest distance a moving object strays from its position; MOTION_AMPLITUDE in shaders/scene.vert
+const float SCENE_MOTION_AMPLITUDE = 1.0f;
+
+// Write position and scale of the moving objects [first, first + count) at time seconds, 4 floats per object.
+// positionScale points at the entry for motionIndex 0.
+// shaders/scene.vert repeats the animation for the previous frame's positions, so the two have to change together.
+void animateScene(const GeneratedScene& scene, double seconds, uint32_t first, uint32_t count, float* positionScale);
@@ -0,0 +1,66 @@
+#include "ShaderLoader.h"
+
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+	// Reads started by prefetchShaderFiles that no module has used yet
+	std::map<std::string, std::future<std::vector<char>>> prefetchedFiles;
+	std::mutex prefetchMutex;
+
+	std::vector<char> readShaderFile(const std::string& filename) {
+		std::future<std::vector<char>> prefetched;
+		{
+			std::lock_guard<std::mutex> lock(prefetchMutex);
+			auto it = prefetchedFiles.find(filename);
+			if (it != prefetchedFiles.end()) {
+				prefetched = std::move(it->second);
+				prefetchedFiles.erase(it);
+			}
+		}
+		// A failed read rethrows here, where the file is needed
+		return prefetched.valid() ? prefetched.get() : readFile(filename);
+	}
+}
+
+std::vector<char> readFile(const std::string& filename) {
+	// Start at the end so the file size is the read position
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open file " + filename + "!");
+	}
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	std::vector<char> buffer(fileSize);
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+	return buffer;
+}
+
+void prefetchShaderFiles(const std::vector<std::string>& filenames) {
+	std::lock_guard<std::mutex> lock(prefetchMutex);
+	for (const std::string& filename : filenames) {
+		prefetchedFiles[filename] = std::async(std::launch::async, [filename]() { return readFile(filename); });
+	}
+}
+
+VkShaderModule createShaderModule(VkDevice device, const std::string& filename, const VkAllocationCallbacks* pAllocator) {
+	std::vector<char> code = readShaderFile(filename);
+	// SPIR-V is a stream of 32-bit words
+	if (code.empty() || code.size() % sizeof(uint32_t) != 0) {
+		throw std::runtime_error("Invalid SPIR-V in " + filename + "!");
+	}
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size();
+	// std::vector's default allocator satisfies uint32_t alignment
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &createInfo, pAllocator, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create shader module for " + filename + "!");
+	}
+	return shaderModule;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+// SPIR-V is compiled from shaders/*.vert|frag|comp by shaders/compile.bat (run as a pre-build step) and loaded from
+// shaders/<name>.spv relative to the working directory.
+
+// Read a whole binary file. Throws if it can't be opened.
+std::vector<char> readFile(const std::string& filename);
+
+// Start reading SPIR-V files on worker threads, so startup doesn't wait on the disk when their pipelines are built.
+// Each prefetched file is used by the next createShaderModule for it, which waits for the read if it hasn't finished.
+void prefetchShaderFiles(const std::vector<std::string>& filenames);
+
+// Load a SPIR-V file and wrap it in a shader module. The module can be destroyed once its pipelines are created.
+VkShaderModule createShaderModule(VkDevice device, const std::string& filename, const VkAllocationCallbacks* pAllocator);
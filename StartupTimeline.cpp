@@ -0,0 +1,46 @@
+#include "StartupTimeline.h"
+
+#include <algorithm>
+#include <iomanip>
+
+static double toMilliseconds(StartupTimeline::Clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+StartupTimeline::StartupTimeline() : origin(Clock::now()), firstFrame(origin), mainThread(std::this_thread::get_id()) {
+}
+
+void StartupTimeline::record(const char* name, Clock::time_point start, Clock::time_point end) {
+	std::lock_guard<std::mutex> lock(mutex);
+	stages.push_back({ name, start, end, std::this_thread::get_id() });
+}
+
+void StartupTimeline::markFirstFrame() {
+	firstFrame = Clock::now();
+}
+
+double StartupTimeline::getTimeToFirstFrameMs() const {
+	return toMilliseconds(firstFrame - origin);
+}
+
+void StartupTimeline::print(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<Stage> sorted = stages;
+	std::sort(sorted.begin(), sorted.end(), [](const Stage& a, const Stage& b) { return a.start < b.start; });
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+
+	out << "Startup timeline (ms):" << std::endl;
+	double serialTotal = 0.0;
+	for (const Stage& stage : sorted) {
+		double duration = toMilliseconds(stage.end - stage.start);
+		serialTotal += duration;
+		out << "  " << std::left << std::setw(24) << stage.name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(10) << toMilliseconds(stage.start - origin) << " +" << std::setw(9) << duration
+			<< (stage.thread == mainThread ? "  main" : "  worker") << std::endl;
+	}
+	// Stages overlap, so their sum exceeds the wall time by however much the overlap saved
+	out << "  stages total " << serialTotal << ", time to first frame " << getTimeToFirstFrameMs() << std::endl;
+	out.flags(flags);
+	out.precision(precision);
+}
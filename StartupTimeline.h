@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Records when each startup stage ran and on which thread, measured from the timeline's construction,
+// and the time to the first frame. Stages may be measured from several threads at once.
+class StartupTimeline {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	StartupTimeline();
+
+	// Run work and record it as a stage
+	template<typename Function>
+	void measure(const char* name, Function&& work) {
+		Clock::time_point start = Clock::now();
+		work();
+		record(name, start, Clock::now());
+	}
+
+	void markFirstFrame();
+	double getTimeToFirstFrameMs() const;
+	void print(std::ostream& out) const;
+
+private:
+	struct Stage {
+		const char* name;
+		Clock::time_point start;
+		Clock::time_point end;
+		std::thread::id thread;
+	};
+
+	void record(const char* name, Clock::time_point start, Clock::time_point end);
+
+	Clock::time_point origin;
+	Clock::time_point firstFrame;
+	std::thread::id mainThread;
+	mutable std::mutex mutex;
+	std::vector<Stage> stages;
+};
@@ -0,0 +1,553 @@
+#include "StressScene.h"
+
+#include "ShaderLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+	// Animation advances by a fixed step per frame, so a benchmark sees the same motion at any frame rate
+	const double SECONDS_PER_FRAME = 1.0 / 60.0;
+	// Largest minStorageBufferOffsetAlignment the spec allows, used for the motion regions
+	const VkDeviceSize MOTION_REGION_ALIGNMENT = 256;
+	// Storage buffers in the scene's descriptor set
+	const uint32_t DESCRIPTOR_COUNT = 5;
+
+	void normalize(float* v) {
+		float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+
+	void cross(const float* a, const float* b, float* result) {
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	float dot(const float* a, const float* b) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	// Right handed look-at from eye to the origin, and a perspective projection with Vulkan's flipped Y and 0..1 depth
+	void computeViewProjection(const float* eye, float aspect, float farPlane, float* matrix) {
+		const float nearPlane = 0.1f;
+		const float fieldOfView = 1.0471976f;
+		float forward[3] = { -eye[0], -eye[1], -eye[2] };
+		normalize(forward);
+		float up[3] = { 0.0f, 1.0f, 0.0f };
+		float side[3], cameraUp[3];
+		cross(forward, up, side);
+		normalize(side);
+		cross(side, forward, cameraUp);
+
+		// Rows of the view matrix
+		float view[3][4] = {
+			{ side[0], side[1], side[2], -dot(side, eye) },
+			{ cameraUp[0], cameraUp[1], cameraUp[2], -dot(cameraUp, eye) },
+			{ -forward[0], -forward[1], -forward[2], dot(forward, eye) },
+		};
+		float focal = 1.0f / std::tan(fieldOfView / 2.0f);
+		float depthScale = farPlane / (nearPlane - farPlane);
+		float depthOffset = nearPlane * farPlane / (nearPlane - farPlane);
+		for (uint32_t column = 0; column < 4; column++) {
+			float* out = matrix + column * 4;
+			out[0] = focal / aspect * view[0][column];
+			out[1] = -focal * view[1][column];
+			out[2] = depthScale * view[2][column] + (column == 3 ? depthOffset : 0.0f);
+			out[3] = -view[2][column];
+		}
+	}
+}
+
+// Matches the push constant block in shaders/scene.vert, shaders/scene.frag and shaders/lightbin.comp
+struct StressScene::PushConstants {
+	// Column major
+	float viewProjection[16];
+	float cameraPosition[3];
+	uint32_t lightCount;
+	// Render area in pixels, and the tiles the light bins hold
+	uint32_t extent[2];
+	uint32_t binTiles[2];
+	// Sub-pixel offset in normalized device coordinates, applied after the motion is computed
+	float jitter[2];
+	// Animation time of the previous frame, at which the vertex shader recomputes the moving objects' positions
+	float previousSeconds;
+};
+
+void StressScene::create(VkDevice device, VkQueue queue, uint32_t queueFamily, const uint32_t* binFamilies, uint32_t binFamilyCount, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkExtent2D maxExtent, uint32_t frameCount, const SceneParameters& parameters, const VkAllocationCallbacks* pAllocator) {
+	create(device, queue, queueFamily, binFamilies, binFamilyCount, memoryTypes, telemetry, colorFormat, depthFormat, samples, maxExtent, frameCount, generateScene(parameters), pAllocator);
+}
+
+void StressScene::create(VkDevice device, VkQueue queue, uint32_t queueFamily, const uint32_t* binFamilies, uint32_t binFamilyCount, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkExtent2D maxExtent, uint32_t frameCount, GeneratedScene&& generated, const VkAllocationCallbacks* pAllocator) {
+	scene = std::move(generated);
+	frameNumber = 0;
+	this->colorFormat = colorFormat;
+	this->depthFormat = depthFormat;
+	this->samples = samples;
+	upload(device, queue, queueFamily, memoryTypes, telemetry, pAllocator);
+
+	// Regions hold at least one entry, storage buffer ranges can't be empty
+	motionRegionSize = (std::max<VkDeviceSize>(scene.movingObjects.size(), 1) * 4 * sizeof(float) + MOTION_REGION_ALIGNMENT - 1) & ~(MOTION_REGION_ALIGNMENT - 1);
+	createBuffer(device, memoryTypes, telemetry, motionRegionSize * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryUsage::Dynamic, MemoryCategory::Uniforms, nullptr, 0, pAllocator, motionBuffer);
+	void* data;
+	if (vkMapMemory(device, motionBuffer.memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to map stress scene motion buffer!");
+	}
+	motionMapped = static_cast<uint8_t*>(data);
+	// Every region starts at the first frame's positions, so the first frames have no motion rather than garbage
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		animateScene(scene, 0.0, 0, static_cast<uint32_t>(scene.movingObjects.size()), reinterpret_cast<float*>(motionMapped + motionRegionSize * frame));
+	}
+
+	// A count followed by MAX_LIGHTS_PER_TILE indices per tile
+	binTiles.width = (maxExtent.width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	binTiles.height = (maxExtent.height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	VkDeviceSize binBytes = static_cast<VkDeviceSize>(binTiles.width) * binTiles.height * (MAX_LIGHTS_PER_TILE + 1) * sizeof(uint32_t);
+	lightBinRegionSize = (binBytes + MOTION_REGION_ALIGNMENT - 1) & ~(MOTION_REGION_ALIGNMENT - 1);
+	createBuffer(device, memoryTypes, telemetry, lightBinRegionSize * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryUsage::GpuOnly, MemoryCategory::Other, binFamilies, binFamilyCount, pAllocator, lightBinBuffer);
+
+	createDescriptorSets(device, frameCount, pAllocator);
+	createPipeline(device, pAllocator);
+}
+
+void StressScene::destroy(VkDevice device, DeviceMemoryTelemetry& telemetry, const VkAllocationCallbacks* pAllocator) {
+	if (!isLoaded()) {
+		return;
+	}
+	vkDestroyPipeline(device, pipeline, pAllocator);
+	vkDestroyPipeline(device, binningPipeline, pAllocator);
+	vkDestroyPipelineLayout(device, pipelineLayout, pAllocator);
+	vkDestroyDescriptorPool(device, descriptorPool, pAllocator);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, pAllocator);
+	vkUnmapMemory(device, motionBuffer.memory);
+	motionMapped = nullptr;
+	for (SceneBuffer* sceneBuffer : { &vertexBuffer, &indexBuffer, &objectBuffer, &materialBuffer, &lightBuffer, &motionBuffer, &lightBinBuffer }) {
+		vkDestroyBuffer(device, sceneBuffer->buffer, pAllocator);
+		telemetry.free(device, sceneBuffer->memory, pAllocator);
+		*sceneBuffer = SceneBuffer{};
+	}
+	pipeline = VK_NULL_HANDLE;
+	binningPipeline = VK_NULL_HANDLE;
+	descriptorSets.clear();
+}
+
+uint32_t StressScene::createBuffer(VkDevice device, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memoryUsage, MemoryCategory category, const uint32_t* queueFamilies, uint32_t queueFamilyCount, const VkAllocationCallbacks* pAllocator, SceneBuffer& sceneBuffer) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	if (queueFamilyCount > 1) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = queueFamilyCount;
+		bufferInfo.pQueueFamilyIndices = queueFamilies;
+	}
+	else {
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+	if (vkCreateBuffer(device, &bufferInfo, pAllocator, &sceneBuffer.buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create stress scene buffer!");
+	}
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, sceneBuffer.buffer, &memRequirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryTypes.find(memoryUsage, memRequirements.memoryTypeBits);
+	if (telemetry.allocate(device, allocInfo, size, category, pAllocator, &sceneBuffer.memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate stress scene buffer memory!");
+	}
+	vkBindBufferMemory(device, sceneBuffer.buffer, sceneBuffer.memory, 0);
+	return allocInfo.memoryTypeIndex;
+}
+
+// Everything static is written straight into device local memory where the CPU can map enough of it (Resizable BAR
+// or UMA); elsewhere it goes through one staging buffer and one command buffer
+void StressScene::upload(VkDevice device, VkQueue queue, uint32_t queueFamily, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, const VkAllocationCallbacks* pAllocator) {
+	struct Upload {
+		SceneBuffer* destination;
+		const void* data;
+		VkDeviceSize size;
+		VkBufferUsageFlags usage;
+		MemoryCategory category;
+	};
+	// Empty object and light lists still need a bindable buffer
+	SceneObject noObject{};
+	SceneLight noLight{};
+	Upload uploads[] = {
+		{ &vertexBuffer, scene.vertices.data(), scene.vertices.size() * sizeof(SceneVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MemoryCategory::Meshes },
+		{ &indexBuffer, scene.indices.data(), scene.indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, MemoryCategory::Meshes },
+		{ &objectBuffer, scene.objects.empty() ? &noObject : scene.objects.data(), std::max<size_t>(scene.objects.size(), 1) * sizeof(SceneObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryCategory::Meshes },
+		{ &materialBuffer, scene.materials.data(), scene.materials.size() * sizeof(SceneMaterial), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryCategory::Other },
+		{ &lightBuffer, scene.lights.empty() ? &noLight : scene.lights.data(), std::max<size_t>(scene.lights.size(), 1) * sizeof(SceneLight), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryCategory::Other },
+	};
+	if (memoryTypes.supportsDirectWrites()) {
+		for (const Upload& upload : uploads) {
+			uint32_t memoryType = createBuffer(device, memoryTypes, telemetry, upload.size, upload.usage, MemoryUsage::DirectUpload, upload.category, nullptr, 0, pAllocator, *upload.destination);
+			void* mapped;
+			if (vkMapMemory(device, upload.destination->memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to map stress scene buffer!");
+			}
+			memcpy(mapped, upload.data, upload.size);
+			if (!memoryTypes.isHostCoherent(memoryType)) {
+				VkMappedMemoryRange range{};
+				range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+				range.memory = upload.destination->memory;
+				range.size = VK_WHOLE_SIZE;
+				if (vkFlushMappedMemoryRanges(device, 1, &range) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to flush stress scene buffer!");
+				}
+			}
+			vkUnmapMemory(device, upload.destination->memory);
+		}
+		// Host writes are made visible to the device by the first queue submission that uses the buffers
+		return;
+	}
+
+	VkDeviceSize stagingSize = 0;
+	for (const Upload& upload : uploads) {
+		stagingSize += upload.size;
+	}
+	SceneBuffer staging;
+	createBuffer(device, memoryTypes, telemetry, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryUsage::Upload, MemoryCategory::Staging, nullptr, 0, pAllocator, staging);
+	void* mapped;
+	if (vkMapMemory(device, staging.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to map stress scene staging buffer!");
+	}
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(device, &poolInfo, pAllocator, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create stress scene upload command pool!");
+	}
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	VkDeviceSize offset = 0;
+	for (const Upload& upload : uploads) {
+		createBuffer(device, memoryTypes, telemetry, upload.size, upload.usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::GpuOnly, upload.category, nullptr, 0, pAllocator, *upload.destination);
+		memcpy(static_cast<uint8_t*>(mapped) + offset, upload.data, upload.size);
+		VkBufferCopy region{};
+		region.srcOffset = offset;
+		region.size = upload.size;
+		vkCmdCopyBuffer(commandBuffer, staging.buffer, upload.destination->buffer, 1, &region);
+		offset += upload.size;
+	}
+	vkEndCommandBuffer(commandBuffer);
+	// Upload memory is host coherent, no flush needed before the submit
+	vkUnmapMemory(device, staging.memory);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit stress scene upload!");
+	}
+	vkQueueWaitIdle(queue);
+	vkDestroyCommandPool(device, commandPool, pAllocator);
+	vkDestroyBuffer(device, staging.buffer, pAllocator);
+	telemetry.free(device, staging.memory, pAllocator);
+}
+
+void StressScene::createDescriptorSets(VkDevice device, uint32_t frameCount, const VkAllocationCallbacks* pAllocator) {
+	// 0: objects, 1: moving objects' positions, 2: materials, 3: lights, 4: light bins.
+	// The binning pass shares the set, reading the lights and writing the bins.
+	VkDescriptorSetLayoutBinding bindings[DESCRIPTOR_COUNT]{};
+	for (uint32_t i = 0; i < DESCRIPTOR_COUNT; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = i < 2 ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	bindings[3].stageFlags |= VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[4].stageFlags |= VK_SHADER_STAGE_COMPUTE_BIT;
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = DESCRIPTOR_COUNT;
+	layoutInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, pAllocator, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create stress scene descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = DESCRIPTOR_COUNT * frameCount;
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = frameCount;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (vkCreateDescriptorPool(device, &poolInfo, pAllocator, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create stress scene descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(frameCount, descriptorSetLayout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = frameCount;
+	allocInfo.pSetLayouts = layouts.data();
+	descriptorSets.resize(frameCount);
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate stress scene descriptor sets!");
+	}
+
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		VkDescriptorBufferInfo bufferInfos[DESCRIPTOR_COUNT]{};
+		bufferInfos[0] = { objectBuffer.buffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { motionBuffer.buffer, motionRegionSize * frame, motionRegionSize };
+		bufferInfos[2] = { materialBuffer.buffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[3] = { lightBuffer.buffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[4] = { lightBinBuffer.buffer, lightBinRegionSize * frame, lightBinRegionSize };
+		VkWriteDescriptorSet writes[DESCRIPTOR_COUNT]{};
+		for (uint32_t i = 0; i < DESCRIPTOR_COUNT; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = descriptorSets[frame];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(device, DESCRIPTOR_COUNT, writes, 0, nullptr);
+	}
+}
+
+void StressScene::createPipeline(VkDevice device, const VkAllocationCallbacks* pAllocator) {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &descriptorSetLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (vkCreatePipelineLayout(device, &layoutInfo, pAllocator, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create stress scene pipeline layout!");
+	}
+	pipeline = buildPipeline(device, VK_NULL_HANDLE, pAllocator);
+
+	// The binning pass uses the same layout, so one descriptor set and push constant block serve both
+	VkShaderModule binShaderModule = createShaderModule(device, "shaders/lightbin.comp.spv", pAllocator);
+	VkComputePipelineCreateInfo computeInfo{};
+	computeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	computeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	computeInfo.stage.module = binShaderModule;
+	computeInfo.stage.pName = "main";
+	computeInfo.layout = pipelineLayout;
+	VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computeInfo, pAllocator, &binningPipeline);
+	vkDestroyShaderModule(device, binShaderModule, pAllocator);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create stress scene light binning pipeline!");
+	}
+}
+
+VkPipeline StressScene::buildPipeline(VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks* pAllocator) const {
+	VkShaderModule vertShaderModule = createShaderModule(device, "shaders/scene.vert.spv", pAllocator);
+	VkShaderModule fragShaderModule = createShaderModule(device, "shaders/scene.frag.spv", pAllocator);
+	VkPipelineShaderStageCreateInfo shaderStages[2]{};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragShaderModule;
+	shaderStages[1].pName = "main";
+
+	// Position and normal interleaved; per object data comes from the storage buffer by instance index
+	VkVertexInputBindingDescription binding{};
+	binding.binding = 0;
+	binding.stride = sizeof(SceneVertex);
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	VkVertexInputAttributeDescription attributes[2]{};
+	attributes[0].location = 0;
+	attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributes[0].offset = offsetof(SceneVertex, position);
+	attributes[1].location = 1;
+	attributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributes[1].offset = offsetof(SceneVertex, normal);
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &binding;
+	vertexInputInfo.vertexAttributeDescriptionCount = 2;
+	vertexInputInfo.pVertexAttributeDescriptions = attributes;
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+	// Meshes wind counter-clockwise, which the projection's Y flip keeps counter-clockwise on screen
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizer.lineWidth = 1.0f;
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = samples;
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	// Color and motion
+	VkPipelineColorBlendAttachmentState colorBlendAttachments[2]{};
+	colorBlendAttachments[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachments[1].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT;
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 2;
+	colorBlending.pAttachments = colorBlendAttachments;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	VkFormat colorFormats[2] = { colorFormat, MOTION_FORMAT };
+	renderingInfo.colorAttachmentCount = 2;
+	renderingInfo.pColorAttachmentFormats = colorFormats;
+	renderingInfo.depthAttachmentFormat = depthFormat;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = &renderingInfo;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = pipelineLayout;
+	VkPipeline newPipeline = VK_NULL_HANDLE;
+	VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, pAllocator, &newPipeline);
+	vkDestroyShaderModule(device, fragShaderModule, pAllocator);
+	vkDestroyShaderModule(device, vertShaderModule, pAllocator);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create stress scene pipeline!");
+	}
+	return newPipeline;
+}
+
+void StressScene::update(uint32_t frameIndex) {
+	if (!isLoaded()) {
+		return;
+	}
+	writeMotion(frameIndex, 0, static_cast<uint32_t>(scene.movingObjects.size()));
+	frameNumber++;
+}
+
+void StressScene::writeMotion(uint32_t frameIndex, uint32_t first, uint32_t count) const {
+	// Dynamic memory is host coherent, the writes need no flush
+	animateScene(scene, frameNumber * SECONDS_PER_FRAME, first, count, reinterpret_cast<float*>(motionMapped + motionRegionSize * frameIndex));
+}
+
+// Looking at the middle of the cube from above one side, far enough out to see all of it
+void StressScene::getCamera(VkExtent2D extent, float* viewProjection, float* cameraPosition) const {
+	cameraPosition[0] = 0.0f;
+	cameraPosition[1] = scene.extent * 0.8f;
+	cameraPosition[2] = scene.extent * 2.2f + 5.0f;
+	computeViewProjection(cameraPosition, static_cast<float>(extent.width) / static_cast<float>(extent.height), scene.extent * 5.0f + 10.0f, viewProjection);
+}
+
+void StressScene::fillPushConstants(VkExtent2D extent, PushConstants& pushConstants) const {
+	getCamera(extent, pushConstants.viewProjection, pushConstants.cameraPosition);
+	pushConstants.lightCount = static_cast<uint32_t>(scene.lights.size());
+	pushConstants.extent[0] = extent.width;
+	pushConstants.extent[1] = extent.height;
+	pushConstants.binTiles[0] = binTiles.width;
+	pushConstants.binTiles[1] = binTiles.height;
+	pushConstants.jitter[0] = jitter[0] * 2.0f / static_cast<float>(extent.width);
+	pushConstants.jitter[1] = jitter[1] * 2.0f / static_cast<float>(extent.height);
+	// update() wrote the current positions at frameNumber - 1; the first frame has no previous one and no motion
+	pushConstants.previousSeconds = static_cast<float>((frameNumber >= 2 ? frameNumber - 2 : 0) * SECONDS_PER_FRAME);
+}
+
+void StressScene::setJitter(float x, float y) {
+	jitter[0] = x;
+	jitter[1] = y;
+}
+
+// One workgroup per tile, up to the tiles the bins hold
+void StressScene::binLights(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, uint32_t frameIndex, VkExtent2D extent) const {
+	if (!isLoaded()) {
+		return;
+	}
+	PushConstants pushConstants{};
+	fillPushConstants(extent, pushConstants);
+	uint32_t tilesX = std::min((extent.width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE, binTiles.width);
+	uint32_t tilesY = std::min((extent.height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE, binTiles.height);
+	dispatch.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, binningPipeline);
+	dispatch.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[frameIndex], 0, nullptr);
+	dispatch.vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+	dispatch.vkCmdDispatch(commandBuffer, tilesX, tilesY, 1);
+}
+
+void StressScene::bind(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, uint32_t frameIndex, VkExtent2D extent) const {
+	PushConstants pushConstants{};
+	fillPushConstants(extent, pushConstants);
+
+	VkViewport viewport{};
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
+	viewport.maxDepth = 1.0f;
+	VkRect2D scissor{};
+	scissor.extent = extent;
+	dispatch.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	dispatch.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	dispatch.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	dispatch.vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[frameIndex], 0, nullptr);
+	dispatch.vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+	VkDeviceSize vertexOffset = 0;
+	dispatch.vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, &vertexOffset);
+	dispatch.vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void StressScene::draw(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, uint32_t frameIndex, VkExtent2D extent, uint32_t& drawCount, uint64_t& triangleCount) const {
+	if (!isLoaded()) {
+		return;
+	}
+	bind(commandBuffer, dispatch, frameIndex, extent);
+	// gl_InstanceIndex includes firstInstance, so it indexes the object buffer directly
+	for (const SceneMesh& mesh : scene.meshes) {
+		if (mesh.objectCount == 0) {
+			continue;
+		}
+		dispatch.vkCmdDrawIndexed(commandBuffer, mesh.indexCount, mesh.objectCount, mesh.firstIndex, mesh.vertexOffset, mesh.firstObject);
+		drawCount++;
+		triangleCount += static_cast<uint64_t>(mesh.indexCount / 3) * mesh.objectCount;
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryTelemetry.h"
+#include "MemoryTypeTable.h"
+#include "SceneGenerator.h"
+#include "VulkanDispatch.h"
+
+#include <cstdint>
+#include <vector>
+
+// GPU side of a generated stress scene.
+// Meshes, objects, materials and lights are uploaded once into device local buffers. Each mesh is drawn with one
+// instanced draw, the vertex shader reading its objects from a storage buffer, so the draw count stays at the mesh
+// count while the object count scales. Positions of moving objects are recomputed on the CPU every frame and written
+// to a per-frame region of a host visible buffer, which makes the motion ratio a CPU cost that benchmarks can sweep.
+//
+// Lights are binned into LIGHT_TILE_SIZE pixel screen tiles by a compute pass (shaders/lightbin.comp) that only
+// depends on the camera, so it can run on an async compute queue; fragments then shade with their tile's lights
+// rather than every light. A tile keeps at most MAX_LIGHTS_PER_TILE lights, further ones are dropped.
+//
+// For temporal anti-aliasing the scene writes each pixel's motion since the previous frame to a second color attachment,
+// and its projection can be jittered by a sub-pixel offset. Moving objects' previous positions are recomputed by the
+// vertex shader from the animation at the previous frame's time rather than read from another frame's motion region,
+// which the CPU may already be rewriting for a later frame. The camera is fixed, so only object motion is written.
+class StressScene {
+public:
+	static constexpr uint32_t LIGHT_TILE_SIZE = 16;
+	static constexpr uint32_t MAX_LIGHTS_PER_TILE = 64;
+	// Second color attachment: current minus previous position in texture coordinates
+	static constexpr VkFormat MOTION_FORMAT = VK_FORMAT_R16G16_SFLOAT;
+
+	// Generates the scene and uploads it through a staging buffer submitted to queue, waiting for the copy to finish.
+	// Light bins cover up to maxExtent and are shared by the binFamilyCount queue families in binFamilies. The pipeline
+	// renders with samples per pixel.
+	void create(VkDevice device, VkQueue queue, uint32_t queueFamily, const uint32_t* binFamilies, uint32_t binFamilyCount, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkExtent2D maxExtent, uint32_t frameCount, const SceneParameters& parameters, const VkAllocationCallbacks* pAllocator);
+	// The same from a scene generated beforehand, e.g. on a worker while the device was being created
+	void create(VkDevice device, VkQueue queue, uint32_t queueFamily, const uint32_t* binFamilies, uint32_t binFamilyCount, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkExtent2D maxExtent, uint32_t frameCount, GeneratedScene&& generated, const VkAllocationCallbacks* pAllocator);
+	void destroy(VkDevice device, DeviceMemoryTelemetry& telemetry, const VkAllocationCallbacks* pAllocator);
+	bool isLoaded() const { return pipeline != VK_NULL_HANDLE; }
+
+	// Advance the animation by one frame and write the moving objects' positions for frameIndex.
+	// Only call after that frame's fence has signalled.
+	void update(uint32_t frameIndex);
+	// Write the positions of moving objects [first, first + count) at the current animation time.
+	// Ranges of one frame may be written from several threads at once.
+	void writeMotion(uint32_t frameIndex, uint32_t first, uint32_t count) const;
+	// Record the light binning for frameIndex, which the frame's fragment shading reads
+	void binLights(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, uint32_t frameIndex, VkExtent2D extent) const;
+	// Offset the projection by a fraction of a pixel for the following frames, 0 for none
+	void setJitter(float x, float y);
+	// Bind the pipeline, buffers and camera for the scene's draws
+	void bind(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, uint32_t frameIndex, VkExtent2D extent) const;
+	// Record the scene into the current rendering. Adds the draws and triangles recorded to the counts.
+	void draw(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatch, uint32_t frameIndex, VkExtent2D extent, uint32_t& drawCount, uint64_t& triangleCount) const;
+
+	// Create another pipeline identical to the scene's through pipelineCache, which may be null. The caller destroys it.
+	VkPipeline buildPipeline(VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks* pAllocator) const;
+
+	// The fixed camera looking at the scene: column major view projection and eye position
+	void getCamera(VkExtent2D extent, float* viewProjection, float* cameraPosition) const;
+	const GeneratedScene& getScene() const { return scene; }
+	uint32_t getObjectCount() const { return static_cast<uint32_t>(scene.objects.size()); }
+	VkFormat getColorFormat() const { return colorFormat; }
+	VkFormat getDepthFormat() const { return depthFormat; }
+	VkSampleCountFlagBits getSampleCount() const { return samples; }
+	// Moving objects' positions for frameIndex, as update() writes them; frame captures save and restore them
+	uint8_t* getMotionRegion(uint32_t frameIndex) const { return motionMapped + motionRegionSize * frameIndex; }
+	VkDeviceSize getMotionRegionSize() const { return motionRegionSize; }
+	// Frames update() has advanced the animation by, which sets the time of the previous positions; frame captures
+	// restore it with the positions
+	uint64_t getFrameNumber() const { return frameNumber; }
+	void setFrameNumber(uint64_t number) { frameNumber = number; }
+
+private:
+	struct SceneBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+	};
+
+	// Sharing is concurrent between the families when more than one is given. Returns the memory type allocated from.
+	uint32_t createBuffer(VkDevice device, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memoryUsage, MemoryCategory category, const uint32_t* queueFamilies, uint32_t queueFamilyCount, const VkAllocationCallbacks* pAllocator, SceneBuffer& sceneBuffer);
+	void upload(VkDevice device, VkQueue queue, uint32_t queueFamily, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, const VkAllocationCallbacks* pAllocator);
+	void createDescriptorSets(VkDevice device, uint32_t frameCount, const VkAllocationCallbacks* pAllocator);
+	void createPipeline(VkDevice device, const VkAllocationCallbacks* pAllocator);
+	// Defined with the shaders' push constant block in StressScene.cpp
+	struct PushConstants;
+	void fillPushConstants(VkExtent2D extent, PushConstants& pushConstants) const;
+
+	GeneratedScene scene;
+	uint64_t frameNumber = 0;
+	// Pixels
+	float jitter[2] = {};
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+	SceneBuffer vertexBuffer;
+	SceneBuffer indexBuffer;
+	SceneBuffer objectBuffer;
+	SceneBuffer materialBuffer;
+	SceneBuffer lightBuffer;
+	// Moving objects' positions, one region per frame in flight, persistently mapped
+	SceneBuffer motionBuffer;
+	uint8_t* motionMapped = nullptr;
+	VkDeviceSize motionRegionSize = 0;
+	// Per tile light count and indices, one region per frame in flight, written by the binning pass
+	SceneBuffer lightBinBuffer;
+	VkDeviceSize lightBinRegionSize = 0;
+	// Tiles the bins hold; fragments outside them fall back to every light
+	VkExtent2D binTiles = {};
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	// One per frame in flight, differing in the motion and light bin regions
+	std::vector<VkDescriptorSet> descriptorSets;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipeline binningPipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,317 @@
+#include "TelemetryStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <winsock2.h>
+	#include <afunix.h>
+#else
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+	using NativeSocket = SOCKET;
+	const intptr_t INVALID_TELEMETRY_SOCKET = static_cast<intptr_t>(INVALID_SOCKET);
+
+	void closeSocket(intptr_t socket) { closesocket(static_cast<SOCKET>(socket)); }
+	bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+	void removeSocketFile(const char* path) { DeleteFileA(path); }
+	bool setNonBlocking(intptr_t socket) {
+		u_long mode = 1;
+		return ioctlsocket(static_cast<SOCKET>(socket), FIONBIO, &mode) == 0;
+	}
+	int sendBytes(intptr_t socket, const void* data, uint32_t size) {
+		return ::send(static_cast<SOCKET>(socket), static_cast<const char*>(data), static_cast<int>(size), 0);
+	}
+	int receiveBytes(intptr_t socket, void* data, uint32_t size) {
+		return recv(static_cast<SOCKET>(socket), static_cast<char*>(data), static_cast<int>(size), 0);
+	}
+	// Sockets need Winsock started once per user, matched by a cleanup
+	bool startSockets() {
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}
+	void stopSockets() { WSACleanup(); }
+#else
+	using NativeSocket = int;
+	const intptr_t INVALID_TELEMETRY_SOCKET = -1;
+
+	void closeSocket(intptr_t socket) { ::close(static_cast<int>(socket)); }
+	bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+	void removeSocketFile(const char* path) { unlink(path); }
+	bool setNonBlocking(intptr_t socket) {
+		int flags = fcntl(static_cast<int>(socket), F_GETFL, 0);
+		return flags >= 0 && fcntl(static_cast<int>(socket), F_SETFL, flags | O_NONBLOCK) == 0;
+	}
+	int sendBytes(intptr_t socket, const void* data, uint32_t size) {
+		// A reader that went away must not kill the renderer with SIGPIPE
+		return static_cast<int>(::send(static_cast<int>(socket), data, size, MSG_NOSIGNAL));
+	}
+	int receiveBytes(intptr_t socket, void* data, uint32_t size) {
+		return static_cast<int>(recv(static_cast<int>(socket), data, size, 0));
+	}
+	bool startSockets() { return true; }
+	void stopSockets() {}
+#endif
+
+	bool makeAddress(const std::string& path, sockaddr_un& address) {
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path)) {
+			return false;
+		}
+		memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+
+	bool receiveExactly(intptr_t socket, void* data, uint32_t size) {
+		uint8_t* bytes = static_cast<uint8_t*>(data);
+		while (size > 0) {
+			int received = receiveBytes(socket, bytes, size);
+			if (received <= 0) {
+				return false;
+			}
+			bytes += received;
+			size -= static_cast<uint32_t>(received);
+		}
+		return true;
+	}
+}
+
+TelemetryStream::~TelemetryStream() {
+	destroy();
+}
+
+bool TelemetryStream::create(const std::string& path) {
+	destroy();
+	sockaddr_un address;
+	if (!makeAddress(path, address) || !startSockets()) {
+		return false;
+	}
+	listener = static_cast<intptr_t>(socket(AF_UNIX, SOCK_STREAM, 0));
+	if (listener == INVALID_TELEMETRY_SOCKET) {
+		listener = -1;
+		stopSockets();
+		return false;
+	}
+	// A socket file outlives the process that made it and would make bind fail
+	removeSocketFile(path.c_str());
+	NativeSocket nativeListener = static_cast<NativeSocket>(listener);
+	if (bind(nativeListener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(nativeListener, MAX_CLIENTS) != 0 || !setNonBlocking(listener)) {
+		closeSocket(listener);
+		listener = -1;
+		stopSockets();
+		return false;
+	}
+	this->path = path;
+	startTime = Clock::now();
+	frameNumber = 0;
+	passes.header.type = TelemetryRecordType::Passes;
+	passes.header.size = sizeof(TelemetryPassesRecord);
+	return true;
+}
+
+void TelemetryStream::destroy() {
+	if (listener == -1) {
+		return;
+	}
+	for (Client& client : clients) {
+		close(client);
+	}
+	closeSocket(listener);
+	listener = -1;
+	removeSocketFile(path.c_str());
+	stopSockets();
+}
+
+void TelemetryStream::publish(TelemetryFrameRecord& frame, const GpuProfiler& profiler) {
+	if (listener == -1) {
+		return;
+	}
+	acceptClients();
+
+	// Resend the names only when the passes differ from the last frame's
+	uint32_t passCount = std::min(profiler.getPassCount(), GpuProfiler::MAX_PASSES);
+	bool passesChanged = passCount != passes.passCount;
+	for (uint32_t i = 0; i < passCount; i++) {
+		const char* name = profiler.getPass(i).name;
+		if (name != passNames[i]) {
+			passNames[i] = name;
+			memset(passes.names[i], 0, TELEMETRY_PASS_NAME_LENGTH);
+			memcpy(passes.names[i], name, strnlen(name, TELEMETRY_PASS_NAME_LENGTH - 1));
+			passesChanged = true;
+		}
+		frame.passMilliseconds[i] = static_cast<float>(profiler.getPass(i).milliseconds);
+	}
+	passes.passCount = passCount;
+
+	frame.header.type = TelemetryRecordType::Frame;
+	frame.header.size = sizeof(TelemetryFrameRecord);
+	frame.frameNumber = frameNumber++;
+	frame.timeMicroseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startTime).count());
+	frame.gpuMilliseconds = static_cast<float>(profiler.getFrameTime());
+	frame.passCount = passCount;
+
+	for (Client& client : clients) {
+		if (client.socket == -1) {
+			continue;
+		}
+		client.needsPasses = client.needsPasses || passesChanged;
+		// A frame is only sent after everything before it, so records are never interleaved
+		if (!flush(client)) {
+			continue;
+		}
+		if (client.needsPasses) {
+			if (!send(client, &passes, sizeof(passes))) {
+				continue;
+			}
+			client.needsPasses = false;
+			if (client.pendingSize > 0) {
+				continue;
+			}
+		}
+		send(client, &frame, sizeof(frame));
+	}
+}
+
+void TelemetryStream::acceptClients() {
+	for (;;) {
+		intptr_t socket = static_cast<intptr_t>(accept(static_cast<NativeSocket>(listener), nullptr, nullptr));
+		if (socket == INVALID_TELEMETRY_SOCKET) {
+			return;
+		}
+		Client* client = std::find_if(std::begin(clients), std::end(clients), [](const Client& c) { return c.socket == -1; });
+		if (client == std::end(clients) || !setNonBlocking(socket)) {
+			closeSocket(socket);
+			continue;
+		}
+		client->socket = socket;
+		client->pendingSize = 0;
+		client->needsPasses = true;
+	}
+}
+
+bool TelemetryStream::send(Client& client, const void* data, uint32_t size) {
+	int sent = sendBytes(client.socket, data, size);
+	if (sent < 0) {
+		if (!wouldBlock()) {
+			close(client);
+		}
+		return false;
+	}
+	// Keep the rest, so the reader never sees half a record followed by the next one
+	client.pendingSize = size - static_cast<uint32_t>(sent);
+	memcpy(client.pending, static_cast<const uint8_t*>(data) + sent, client.pendingSize);
+	return true;
+}
+
+// True once nothing is left pending
+bool TelemetryStream::flush(Client& client) {
+	if (client.pendingSize == 0) {
+		return true;
+	}
+	int sent = sendBytes(client.socket, client.pending, client.pendingSize);
+	if (sent < 0) {
+		if (!wouldBlock()) {
+			close(client);
+		}
+		return false;
+	}
+	client.pendingSize -= static_cast<uint32_t>(sent);
+	memmove(client.pending, client.pending + sent, client.pendingSize);
+	return client.pendingSize == 0;
+}
+
+void TelemetryStream::close(Client& client) {
+	if (client.socket != -1) {
+		closeSocket(client.socket);
+		client.socket = -1;
+	}
+	client.pendingSize = 0;
+}
+
+bool printTelemetryStream(const std::string& path, std::ostream& out) {
+	sockaddr_un address;
+	if (!makeAddress(path, address) || !startSockets()) {
+		return false;
+	}
+	intptr_t stream = static_cast<intptr_t>(socket(AF_UNIX, SOCK_STREAM, 0));
+	if (stream == INVALID_TELEMETRY_SOCKET || connect(static_cast<NativeSocket>(stream), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		if (stream != INVALID_TELEMETRY_SOCKET) {
+			closeSocket(stream);
+		}
+		stopSockets();
+		return false;
+	}
+
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(2);
+	TelemetryPassesRecord passes{};
+	TelemetryFrameRecord frame{};
+	uint64_t expectedFrame = 0;
+	bool firstFrame = true;
+	for (;;) {
+		TelemetryRecordHeader header;
+		if (!receiveExactly(stream, &header, sizeof(header)) || header.size < sizeof(header)) {
+			break;
+		}
+		// Unknown records are skipped, so readers keep working when new ones are added
+		uint8_t* record = nullptr;
+		if (header.type == TelemetryRecordType::Passes && header.size == sizeof(passes)) {
+			record = reinterpret_cast<uint8_t*>(&passes);
+		}
+		else if (header.type == TelemetryRecordType::Frame && header.size == sizeof(frame)) {
+			record = reinterpret_cast<uint8_t*>(&frame);
+		}
+		if (record == nullptr) {
+			uint8_t skipped[256];
+			uint32_t remaining = header.size - static_cast<uint32_t>(sizeof(header));
+			bool ok = true;
+			while (remaining > 0 && ok) {
+				uint32_t chunk = std::min(remaining, static_cast<uint32_t>(sizeof(skipped)));
+				ok = receiveExactly(stream, skipped, chunk);
+				remaining -= chunk;
+			}
+			if (!ok) {
+				break;
+			}
+			continue;
+		}
+		if (!receiveExactly(stream, record + sizeof(header), header.size - static_cast<uint32_t>(sizeof(header)))) {
+			break;
+		}
+		if (header.type != TelemetryRecordType::Frame) {
+			continue;
+		}
+
+		if (!firstFrame && frame.frameNumber != expectedFrame) {
+			out << "  (" << frame.frameNumber - expectedFrame << " frames missed)" << std::endl;
+		}
+		firstFrame = false;
+		expectedFrame = frame.frameNumber + 1;
+		// A bar of one mark per millisecond of CPU frame time makes spikes stand out while scrolling
+		uint32_t bar = std::min(static_cast<uint32_t>(frame.cpuMilliseconds + 0.5f), 50u);
+		out << "frame " << frame.frameNumber << "  cpu " << frame.cpuMilliseconds << " ms  gpu " << frame.gpuMilliseconds << " ms  "
+			<< frame.drawCount << " draws  " << frame.triangleCount << " triangles  "
+			<< frame.deviceLocalBytes / (1024.0 * 1024.0) << " MiB device  " << frame.hostBytes / (1024.0 * 1024.0) << " MiB host ";
+		for (uint32_t i = 0; i < frame.passCount && i < passes.passCount; i++) {
+			out << " " << passes.names[i] << " " << frame.passMilliseconds[i];
+		}
+		out << "  " << std::string(bar, '#') << std::endl;
+	}
+	out.flags(flags);
+	out.precision(precision);
+	closeSocket(stream);
+	stopSockets();
+	return true;
+}
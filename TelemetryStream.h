@@ -0,0 +1,107 @@
+#pragma once
+
+#include "GpuProfiler.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Live per-frame statistics published on a local Unix domain socket (AF_UNIX, also available on Windows 10 1803+).
+// Any number of readers up to MAX_CLIENTS may connect at any time; each receives a stream of fixed size binary
+// records in host byte order, every one starting with a TelemetryRecordHeader:
+//  Passes - names of the GPU passes, sent on connect and whenever the frame's passes change
+//  Frame  - one per frame: CPU and GPU frame time, per-pass GPU time (indexed like the last Passes record),
+//           draws, triangles and live device memory
+// Publishing never blocks and never allocates. A reader too slow to drain its socket misses frames rather than
+// stalling the renderer; the frame numbers show the gap.
+//
+// --telemetry-client <socket> runs printTelemetryStream(), the reference reader.
+const uint32_t TELEMETRY_PASS_NAME_LENGTH = 32;
+
+enum class TelemetryRecordType : uint32_t {
+	Passes = 1,
+	Frame = 2
+};
+
+struct TelemetryRecordHeader {
+	TelemetryRecordType type;
+	// Bytes in the record, header included
+	uint32_t size;
+};
+
+struct TelemetryPassesRecord {
+	TelemetryRecordHeader header;
+	uint32_t passCount;
+	uint32_t padding;
+	// Zero terminated, truncated to fit
+	char names[GpuProfiler::MAX_PASSES][TELEMETRY_PASS_NAME_LENGTH];
+};
+
+struct TelemetryFrameRecord {
+	TelemetryRecordHeader header;
+	uint64_t frameNumber;
+	// Since the stream was created
+	uint64_t timeMicroseconds;
+	float cpuMilliseconds;
+	// GPU times trail the frame by the frames in flight, as the profiler reads them back
+	float gpuMilliseconds;
+	uint32_t drawCount;
+	uint32_t passCount;
+	uint64_t triangleCount;
+	uint64_t deviceLocalBytes;
+	uint64_t hostBytes;
+	float passMilliseconds[GpuProfiler::MAX_PASSES];
+};
+
+static_assert(sizeof(TelemetryPassesRecord) == 16 + GpuProfiler::MAX_PASSES * TELEMETRY_PASS_NAME_LENGTH, "Telemetry records must not contain padding");
+static_assert(sizeof(TelemetryFrameRecord) == 64 + GpuProfiler::MAX_PASSES * 4, "Telemetry records must not contain padding");
+
+class TelemetryStream {
+public:
+	static constexpr uint32_t MAX_CLIENTS = 8;
+
+	TelemetryStream() = default;
+	~TelemetryStream();
+	TelemetryStream(const TelemetryStream&) = delete;
+	TelemetryStream& operator=(const TelemetryStream&) = delete;
+
+	// Listen on path, replacing a socket left behind by an earlier run.
+	// Returns false if sockets are unavailable; publish() then does nothing.
+	bool create(const std::string& path);
+	void destroy();
+
+	// Accept waiting readers and send them the frame. Fills in the header, frame number and time; pass timings are
+	// taken from the profiler.
+	void publish(TelemetryFrameRecord& frame, const GpuProfiler& profiler);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Client {
+		intptr_t socket = -1;
+		// The unsent tail of a record the socket only partly accepted, sent before anything else
+		uint8_t pending[sizeof(TelemetryPassesRecord) > sizeof(TelemetryFrameRecord) ? sizeof(TelemetryPassesRecord) : sizeof(TelemetryFrameRecord)];
+		uint32_t pendingSize = 0;
+		bool needsPasses = true;
+	};
+
+	void acceptClients();
+	// Returns false if the record wasn't taken: the socket was full, or the client has gone and was closed
+	bool send(Client& client, const void* data, uint32_t size);
+	bool flush(Client& client);
+	void close(Client& client);
+
+	intptr_t listener = -1;
+	std::string path;
+	Clock::time_point startTime;
+	uint64_t frameNumber = 0;
+	Client clients[MAX_CLIENTS];
+
+	TelemetryPassesRecord passes{};
+	// Profiler pass names are literals, so comparing pointers finds changes without string compares
+	const char* passNames[GpuProfiler::MAX_PASSES] = {};
+};
+
+// Connect to a TelemetryStream at path and print every frame until it closes. Returns false if it can't connect.
+bool printTelemetryStream(const std::string& path, std::ostream& out);
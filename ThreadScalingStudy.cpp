@@ -0,0 +1,388 @@
+#include "ThreadScalingStudy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+	// The last entry is the whole frame
+	const char* STAGE_NAMES[] = { "culling", "sorting", "recording", "uploads", "frame" };
+
+	// Bits of each sort key field, most significant first: mesh, then material, then depth front to back
+	const uint32_t DEPTH_BITS = 20;
+	const uint32_t MATERIAL_BITS = 24;
+
+	using Clock = std::chrono::steady_clock;
+
+	double milliseconds(Clock::time_point begin, Clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - begin).count();
+	}
+
+	double median(double* samples, uint32_t count) {
+		std::nth_element(samples, samples + count / 2, samples + count);
+		return samples[count / 2];
+	}
+}
+
+size_t ThreadScalingStudy::getFrameArenaBytes(uint32_t objectCount, uint32_t maxWorkers) {
+	// Each list may need padding to its alignment
+	return 3 * (objectCount * sizeof(DrawKey) + alignof(DrawKey)) + maxWorkers * sizeof(uint32_t) + alignof(uint32_t);
+}
+
+void ThreadScalingStudy::run(VkDevice device, const DeviceDispatch& dispatch, uint32_t queueFamily, const StressScene& scene, FrameArena& frameArena, VkExtent2D extent, uint32_t frameIndex, uint32_t maxWorkers, const VkAllocationCallbacks* pAllocator) {
+	if (!scene.isLoaded()) {
+		throw std::runtime_error("Thread scaling study needs a stress scene!");
+	}
+	maxWorkers = std::max(maxWorkers, 1u);
+	if (frameArena.getCapacity() < getFrameArenaBytes(static_cast<uint32_t>(scene.getScene().objects.size()), maxWorkers)) {
+		throw std::runtime_error("Frame arena is too small for the thread scaling study!");
+	}
+	prepare(device, queueFamily, scene, extent, maxWorkers, pAllocator);
+
+	WorkerPool pool;
+	results.clear();
+	for (uint32_t workerCount = 1; workerCount <= maxWorkers; workerCount++) {
+		pool.start(workerCount);
+		double samples[STAGE_COUNT + 1][ITERATIONS];
+		// The first run fills caches and lets the driver grow the command pools
+		for (uint32_t iteration = 0; iteration <= ITERATIONS; iteration++) {
+			beginFrame(frameArena, iteration, workerCount);
+			Clock::time_point times[STAGE_COUNT + 1];
+			times[0] = Clock::now();
+			cull(pool);
+			times[1] = Clock::now();
+			sort(pool);
+			times[2] = Clock::now();
+			record(pool, dispatch, extent, frameIndex);
+			times[3] = Clock::now();
+			upload(pool, frameIndex);
+			times[4] = Clock::now();
+			if (iteration == 0) {
+				continue;
+			}
+			for (uint32_t stage = 0; stage < STAGE_COUNT; stage++) {
+				samples[stage][iteration - 1] = milliseconds(times[stage], times[stage + 1]);
+			}
+			samples[STAGE_COUNT][iteration - 1] = milliseconds(times[0], times[STAGE_COUNT]);
+		}
+		Result result{};
+		result.workerCount = workerCount;
+		for (uint32_t stage = 0; stage <= STAGE_COUNT; stage++) {
+			result.milliseconds[stage] = median(samples[stage], ITERATIONS);
+		}
+		results.push_back(result);
+	}
+	pool.stop();
+	release(device, pAllocator);
+}
+
+void ThreadScalingStudy::prepare(VkDevice device, uint32_t queueFamily, const StressScene& scene, VkExtent2D extent, uint32_t maxWorkers, const VkAllocationCallbacks* pAllocator) {
+	this->device = device;
+	this->scene = &scene;
+	colorFormat = scene.getColorFormat();
+	const GeneratedScene& generated = scene.getScene();
+	objectCount = static_cast<uint32_t>(generated.objects.size());
+	if (generated.meshes.size() > (1ull << (64 - MATERIAL_BITS - DEPTH_BITS)) || generated.materials.size() > (1ull << MATERIAL_BITS)) {
+		throw std::runtime_error("Stress scene has too many meshes or materials for the sort key!");
+	}
+
+	objectMeshes.resize(objectCount);
+	for (uint32_t mesh = 0; mesh < generated.meshes.size(); mesh++) {
+		std::fill_n(objectMeshes.begin() + generated.meshes[mesh].firstObject, generated.meshes[mesh].objectCount, mesh);
+	}
+
+	// Gribb-Hartmann: each plane is a sum or difference of the view projection's rows. Vulkan clip depth is [0, w],
+	// so the near plane is the third row on its own.
+	float viewProjection[16];
+	scene.getCamera(extent, viewProjection, cameraPosition);
+	float rows[4][4];
+	for (uint32_t row = 0; row < 4; row++) {
+		for (uint32_t column = 0; column < 4; column++) {
+			rows[row][column] = viewProjection[column * 4 + row];
+		}
+	}
+	for (uint32_t i = 0; i < 4; i++) {
+		frustumPlanes[0][i] = rows[3][i] + rows[0][i];
+		frustumPlanes[1][i] = rows[3][i] - rows[0][i];
+		frustumPlanes[2][i] = rows[3][i] + rows[1][i];
+		frustumPlanes[3][i] = rows[3][i] - rows[1][i];
+		frustumPlanes[4][i] = rows[2][i];
+		frustumPlanes[5][i] = rows[3][i] - rows[2][i];
+	}
+	for (float* plane : frustumPlanes) {
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (uint32_t i = 0; i < 4; i++) {
+			plane[i] /= length;
+		}
+	}
+	// Depth is quantized over the distance to the far corner of the scene
+	float farthest[3] = { generated.extent, -generated.extent, -generated.extent };
+	farDistance = 0.0f;
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		farDistance += (farthest[axis] - cameraPosition[axis]) * (farthest[axis] - cameraPosition[axis]);
+	}
+	farDistance = std::sqrt(farDistance) + SCENE_MESH_RADIUS + SCENE_MOTION_AMPLITUDE;
+
+	recordResults.assign(maxWorkers, VK_SUCCESS);
+
+	// Pools are reset whole each run, as a frame would reset its own
+	commandPools.resize(maxWorkers);
+	commandBuffers.resize(maxWorkers);
+	for (uint32_t worker = 0; worker < maxWorkers; worker++) {
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = queueFamily;
+		if (vkCreateCommandPool(device, &poolInfo, pAllocator, &commandPools[worker]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create thread scaling command pool!");
+		}
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPools[worker];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[worker]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate thread scaling command buffer!");
+		}
+	}
+}
+
+void ThreadScalingStudy::release(VkDevice device, const VkAllocationCallbacks* pAllocator) {
+	// Destroying a pool frees its command buffers
+	for (VkCommandPool commandPool : commandPools) {
+		vkDestroyCommandPool(device, commandPool, pAllocator);
+	}
+	commandPools.clear();
+	commandBuffers.clear();
+}
+
+// Nothing is submitted, so any slot is free to reuse
+void ThreadScalingStudy::beginFrame(FrameArena& frameArena, uint32_t frame, uint32_t workerCount) {
+	frameArena.beginFrame(frame % frameArena.getFrameCount());
+	// Sized for every object visible, so no stage allocates however many workers run it
+	culled = frameArena.allocateArray<DrawKey>(objectCount);
+	keys = frameArena.allocateArray<DrawKey>(objectCount);
+	mergeScratch = frameArena.allocateArray<DrawKey>(objectCount);
+	culledCounts = frameArena.allocateArray<uint32_t>(workerCount);
+}
+
+void ThreadScalingStudy::cull(WorkerPool& pool) {
+	// Bounding spheres are conservative for moving objects: wherever they are on their orbit, they stay inside
+	auto cullRange = [this, &pool](uint32_t worker) {
+		const GeneratedScene& generated = scene->getScene();
+		uint32_t begin, end;
+		pool.getRange(worker, objectCount, begin, end);
+		DrawKey* visible = culled + begin;
+		uint32_t count = 0;
+		for (uint32_t i = begin; i < end; i++) {
+			const SceneObject& object = generated.objects[i];
+			float radius = object.scale * SCENE_MESH_RADIUS + (object.motionIndex != STATIC_OBJECT ? SCENE_MOTION_AMPLITUDE : 0.0f);
+			bool inside = true;
+			for (const float* plane : frustumPlanes) {
+				if (plane[0] * object.position[0] + plane[1] * object.position[1] + plane[2] * object.position[2] + plane[3] < -radius) {
+					inside = false;
+					break;
+				}
+			}
+			if (!inside) {
+				continue;
+			}
+			float offset[3] = { object.position[0] - cameraPosition[0], object.position[1] - cameraPosition[1], object.position[2] - cameraPosition[2] };
+			float distance = std::sqrt(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+			uint64_t depth = static_cast<uint64_t>(std::min(distance / farDistance, 1.0f) * ((1u << DEPTH_BITS) - 1));
+			uint64_t mesh = objectMeshes[i];
+			visible[count].key = (mesh << (MATERIAL_BITS + DEPTH_BITS)) | (static_cast<uint64_t>(object.material) << DEPTH_BITS) | depth;
+			visible[count].object = i;
+			visible[count].mesh = objectMeshes[i];
+			count++;
+		}
+		culledCounts[worker] = count;
+	};
+	pool.run(cullRange);
+
+	// Every worker sums the counts before its own to find where its objects go, then copies them there
+	auto compact = [this, &pool](uint32_t worker) {
+		uint32_t begin, end;
+		pool.getRange(worker, objectCount, begin, end);
+		uint32_t offset = 0;
+		for (uint32_t previous = 0; previous < worker; previous++) {
+			offset += culledCounts[previous];
+		}
+		std::copy(culled + begin, culled + begin + culledCounts[worker], keys + offset);
+	};
+	pool.run(compact);
+	visibleCount = 0;
+	for (uint32_t worker = 0; worker < pool.getWorkerCount(); worker++) {
+		visibleCount += culledCounts[worker];
+	}
+}
+
+void ThreadScalingStudy::sort(WorkerPool& pool) {
+	auto sortRange = [this, &pool](uint32_t worker) {
+		uint32_t begin, end;
+		pool.getRange(worker, visibleCount, begin, end);
+		std::sort(keys + begin, keys + end);
+	};
+	pool.run(sortRange);
+
+	// Merge neighbouring sorted runs pairwise, halving the number of busy workers every round. The last rounds are
+	// close to serial, which is what bounds this stage's scaling.
+	DrawKey* source = keys;
+	DrawKey* target = mergeScratch;
+	uint32_t workerCount = pool.getWorkerCount();
+	for (uint32_t step = 1; step < workerCount; step *= 2) {
+		auto mergeRuns = [this, &pool, source, target, step, workerCount](uint32_t worker) {
+			if (worker % (2 * step) != 0) {
+				return;
+			}
+			uint32_t begin, middle, end, unused;
+			pool.getRange(worker, visibleCount, begin, unused);
+			middle = visibleCount;
+			end = visibleCount;
+			if (worker + step < workerCount) {
+				pool.getRange(worker + step, visibleCount, middle, unused);
+			}
+			if (worker + 2 * step < workerCount) {
+				pool.getRange(worker + 2 * step, visibleCount, end, unused);
+			}
+			std::merge(source + begin, source + middle, source + middle, source + end, target + begin);
+		};
+		pool.run(mergeRuns);
+		std::swap(source, target);
+	}
+	sortedKeys = source;
+}
+
+void ThreadScalingStudy::record(WorkerPool& pool, const DeviceDispatch& dispatch, VkExtent2D extent, uint32_t frameIndex) {
+	auto recordRange = [this, &pool, &dispatch, extent, frameIndex](uint32_t worker) {
+		const GeneratedScene& generated = scene->getScene();
+		uint32_t begin, end;
+		pool.getRange(worker, visibleCount, begin, end);
+		VkCommandBuffer commandBuffer = commandBuffers[worker];
+		dispatch.vkResetCommandPool(device, commandPools[worker], 0);
+
+		// Continues the frame's scene rendering, which the primary command buffer would begin
+		VkCommandBufferInheritanceRenderingInfo renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+		VkFormat colorFormats[2] = { colorFormat, StressScene::MOTION_FORMAT };
+		renderingInfo.colorAttachmentCount = 2;
+		renderingInfo.pColorAttachmentFormats = colorFormats;
+		renderingInfo.depthAttachmentFormat = scene->getDepthFormat();
+		renderingInfo.rasterizationSamples = scene->getSampleCount();
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.pNext = &renderingInfo;
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+		recordResults[worker] = dispatch.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		if (recordResults[worker] != VK_SUCCESS) {
+			return;
+		}
+		// Secondary command buffers inherit no state, so every worker binds the scene itself
+		scene->bind(commandBuffer, dispatch, frameIndex, extent);
+		for (uint32_t i = begin; i < end; i++) {
+			const SceneMesh& mesh = generated.meshes[sortedKeys[i].mesh];
+			dispatch.vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, sortedKeys[i].object);
+		}
+		recordResults[worker] = dispatch.vkEndCommandBuffer(commandBuffer);
+	};
+	pool.run(recordRange);
+	for (uint32_t worker = 0; worker < pool.getWorkerCount(); worker++) {
+		if (recordResults[worker] != VK_SUCCESS) {
+			throw std::runtime_error("Failed to record thread scaling command buffer!");
+		}
+	}
+}
+
+void ThreadScalingStudy::upload(WorkerPool& pool, uint32_t frameIndex) {
+	uint32_t movingCount = static_cast<uint32_t>(scene->getScene().movingObjects.size());
+	auto uploadRange = [this, &pool, frameIndex, movingCount](uint32_t worker) {
+		uint32_t begin, end;
+		pool.getRange(worker, movingCount, begin, end);
+		scene->writeMotion(frameIndex, begin, end - begin);
+	};
+	pool.run(uploadRange);
+}
+
+double ThreadScalingStudy::getSpeedup(size_t result, uint32_t stage) const {
+	double milliseconds = results[result].milliseconds[stage];
+	return milliseconds > 0.0 ? results[0].milliseconds[stage] / milliseconds : 0.0;
+}
+
+// e = (1/S - 1/n) / (1 - 1/n). Unlike Amdahl's fraction fitted to one point, it also absorbs the overhead that
+// grows with n (synchronisation, merge rounds, memory bandwidth), which is what matters when sizing machines.
+double ThreadScalingStudy::getSerialFraction(double speedup, uint32_t workerCount) {
+	if (workerCount < 2 || speedup <= 0.0) {
+		return 0.0;
+	}
+	double n = static_cast<double>(workerCount);
+	return (1.0 / speedup - 1.0 / n) / (1.0 - 1.0 / n);
+}
+
+uint32_t ThreadScalingStudy::getSaturationPoint(uint32_t stage) const {
+	double best = results[0].milliseconds[stage];
+	for (const Result& result : results) {
+		best = std::min(best, result.milliseconds[stage]);
+	}
+	for (const Result& result : results) {
+		if (result.milliseconds[stage] <= best * (1.0 + SATURATION_TOLERANCE)) {
+			return result.workerCount;
+		}
+	}
+	return results.back().workerCount;
+}
+
+void ThreadScalingStudy::print(std::ostream& out) const {
+	if (results.empty()) {
+		return;
+	}
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+	out << "Thread scaling over " << objectCount << " objects, " << visibleCount << " visible, "
+		<< scene->getScene().movingObjects.size() << " moving, median of " << ITERATIONS << " runs:" << std::endl;
+	size_t last = results.size() - 1;
+	for (uint32_t stage = 0; stage <= STAGE_COUNT; stage++) {
+		double speedup = getSpeedup(last, stage);
+		out << "  " << STAGE_NAMES[stage] << ": serial fraction " << getSerialFraction(speedup, results[last].workerCount)
+			<< ", stops improving at " << getSaturationPoint(stage) << " workers" << std::endl;
+		out << "    workers          ms   speedup  efficiency" << std::endl;
+		for (size_t i = 0; i < results.size(); i++) {
+			double resultSpeedup = getSpeedup(i, stage);
+			out << "    " << std::setw(7) << results[i].workerCount << std::setw(12) << results[i].milliseconds[stage]
+				<< std::setw(10) << resultSpeedup << std::setw(12) << resultSpeedup / results[i].workerCount << std::endl;
+		}
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void ThreadScalingStudy::writeJson(const std::string& path) const {
+	if (results.empty()) {
+		return;
+	}
+	std::ofstream file(path, std::ios::trunc);
+	file << "{\n  \"objects\": " << objectCount << ",\n  \"visible\": " << visibleCount << ",\n";
+	file << "  \"moving\": " << scene->getScene().movingObjects.size() << ",\n  \"iterations\": " << ITERATIONS << ",\n";
+	file << "  \"stages\": {\n";
+	size_t last = results.size() - 1;
+	for (uint32_t stage = 0; stage <= STAGE_COUNT; stage++) {
+		double speedup = getSpeedup(last, stage);
+		file << "    \"" << STAGE_NAMES[stage] << "\": {\n";
+		file << "      \"serialFraction\": " << getSerialFraction(speedup, results[last].workerCount) << ",\n";
+		file << "      \"saturationWorkers\": " << getSaturationPoint(stage) << ",\n";
+		// One entry per worker count, as [workers, ms, speedup, efficiency]
+		file << "      \"runs\": [";
+		for (size_t i = 0; i < results.size(); i++) {
+			double resultSpeedup = getSpeedup(i, stage);
+			file << (i > 0 ? ", " : "") << "[" << results[i].workerCount << ", " << results[i].milliseconds[stage] << ", " << resultSpeedup << ", " << resultSpeedup / results[i].workerCount << "]";
+		}
+		file << "]\n    }" << (stage < STAGE_COUNT ? "," : "") << "\n";
+	}
+	file << "  }\n}\n";
+}
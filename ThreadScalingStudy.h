@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "LinearArena.h"
+#include "StressScene.h"
+#include "VulkanDispatch.h"
+#include "WorkerPool.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Thread scaling study over a stress scene (--thread-scaling).
+// The CPU stages of a multithreaded frame are run over the scene's objects with every worker count from 1 up to all
+// cores, each stage split evenly across a WorkerPool:
+//  culling   - bounding spheres against the camera frustum, visible objects compacted into one list
+//  sorting   - visible objects sorted by mesh, material and depth: a sort per worker, then pairwise merges
+//  recording - one secondary command buffer per worker, one indexed draw per visible object
+//  uploads   - the moving objects' positions written into the frame's motion region
+// Each stage reports its median time, speedup over one worker, parallel efficiency and the Karp-Flatt serial
+// fraction, so it shows which stage stops scaling first and how many cores are worth paying for.
+//
+// Every run is treated as a frame: its culling and sort lists come from the next slot of a FrameArena, as a frame's
+// transient lists would. The scene must be loaded and the device idle; the recorded command buffers are never
+// submitted.
+class ThreadScalingStudy {
+public:
+	// Timed runs per stage and worker count, after one untimed warmup run
+	static constexpr uint32_t ITERATIONS = 15;
+	// A worker count whose time is within this fraction of the best is counted as reaching it
+	static constexpr double SATURATION_TOLERANCE = 0.05;
+
+	enum class Stage : uint32_t {
+		Culling,
+		Sorting,
+		Recording,
+		Uploads,
+		Count
+	};
+
+	// Bytes of each frameArena slot the lists of a scene with objectCount objects take
+	static size_t getFrameArenaBytes(uint32_t objectCount, uint32_t maxWorkers);
+
+	// Measure every worker count from 1 to maxWorkers, writing motion into frameIndex's region. Throws if frameArena's
+	// slots are smaller than getFrameArenaBytes.
+	void run(VkDevice device, const DeviceDispatch& dispatch, uint32_t queueFamily, const StressScene& scene, FrameArena& frameArena, VkExtent2D extent, uint32_t frameIndex, uint32_t maxWorkers, const VkAllocationCallbacks* pAllocator);
+
+	void print(std::ostream& out) const;
+	void writeJson(const std::string& path) const;
+
+	// Median time of stage with the run's workerCount, which must have been measured
+	double getMilliseconds(Stage stage, uint32_t workerCount) const { return results[workerCount - 1].milliseconds[static_cast<uint32_t>(stage)]; }
+	uint32_t getObjectCount() const { return objectCount; }
+	uint32_t getVisibleCount() const { return visibleCount; }
+
+private:
+	static constexpr uint32_t STAGE_COUNT = static_cast<uint32_t>(Stage::Count);
+
+	// Sorted by key; object breaks ties so every worker count produces the same order
+	struct DrawKey {
+		uint64_t key;
+		uint32_t object;
+		uint32_t mesh;
+		bool operator<(const DrawKey& other) const { return key != other.key ? key < other.key : object < other.object; }
+	};
+
+	// Stages, then the whole frame at index STAGE_COUNT
+	struct Result {
+		uint32_t workerCount;
+		double milliseconds[STAGE_COUNT + 1];
+	};
+
+	void prepare(VkDevice device, uint32_t queueFamily, const StressScene& scene, VkExtent2D extent, uint32_t maxWorkers, const VkAllocationCallbacks* pAllocator);
+	void release(VkDevice device, const VkAllocationCallbacks* pAllocator);
+	// Start a frame in the arena's next slot and take the frame's lists from it
+	void beginFrame(FrameArena& frameArena, uint32_t frame, uint32_t workerCount);
+	void cull(WorkerPool& pool);
+	void sort(WorkerPool& pool);
+	void record(WorkerPool& pool, const DeviceDispatch& dispatch, VkExtent2D extent, uint32_t frameIndex);
+	void upload(WorkerPool& pool, uint32_t frameIndex);
+
+	double getSpeedup(size_t result, uint32_t stage) const;
+	// Karp-Flatt metric: the serial fraction implied by the measured speedup on n workers
+	static double getSerialFraction(double speedup, uint32_t workerCount);
+	// Fewest workers within SATURATION_TOLERANCE of the stage's best time
+	uint32_t getSaturationPoint(uint32_t stage) const;
+
+	VkDevice device = VK_NULL_HANDLE;
+	const StressScene* scene = nullptr;
+	// Referenced by the secondary command buffers' inheritance info
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	std::vector<Result> results;
+	uint32_t objectCount = 0;
+	uint32_t visibleCount = 0;
+
+	// Inputs derived from the scene once, outside the timed stages
+	std::vector<uint32_t> objectMeshes;
+	float frustumPlanes[6][4] = {};
+	float cameraPosition[3] = {};
+	float farDistance = 1.0f;
+
+	// The frame's lists, objectCount entries each. Culling writes each worker's visible objects at the start of its own
+	// range, then compacts them into keys.
+	DrawKey* culled = nullptr;
+	uint32_t* culledCounts = nullptr;
+	DrawKey* keys = nullptr;
+	DrawKey* mergeScratch = nullptr;
+	// Where the sorted keys ended up after the merge rounds
+	const DrawKey* sortedKeys = nullptr;
+
+	std::vector<VkCommandPool> commandPools;
+	std::vector<VkCommandBuffer> commandBuffers;
+	// Workers can't throw, so each reports how its recording went
+	std::vector<VkResult> recordResults;
+};
@@ -0,0 +1,88 @@
+#include "UniformRingBuffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Round value up to a multiple of alignment (alignment must be a power of two)
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void UniformRingBuffer::create(VkDevice device, const VkPhysicalDeviceLimits& limits, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkDeviceSize bytesPerFrame, uint32_t frameCount, const VkAllocationCallbacks* pAllocator) {
+	// Uniform and storage allocations share the ring, so honour the stricter of the two offset alignments.
+	alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+	frameSize = alignUp(bytesPerFrame, alignment);
+
+	// Pad the end of the buffer by the widest binding range so that offset + range stays in bounds for the last allocation.
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = frameSize * frameCount + STORAGE_BINDING_RANGE;
+	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(device, &bufferInfo, pAllocator, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform ring buffer!");
+	}
+	bufferSize = bufferInfo.size;
+
+	// Dynamic memory is host coherent, so writes never need an explicit flush.
+	// With Resizable BAR it is also device local and the GPU reads the constants straight from VRAM.
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryTypes.find(MemoryUsage::Dynamic, memRequirements.memoryTypeBits);
+	if (telemetry.allocate(device, allocInfo, bufferSize, MemoryCategory::Uniforms, pAllocator, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate uniform ring buffer memory!");
+	}
+	vkBindBufferMemory(device, buffer, memory, 0);
+
+	// Map once for the lifetime of the buffer.
+	void* data;
+	if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to map uniform ring buffer memory!");
+	}
+	mapped = static_cast<uint8_t*>(data);
+	frameBegin = 0;
+	head = 0;
+}
+
+void UniformRingBuffer::destroy(VkDevice device, DeviceMemoryTelemetry& telemetry, const VkAllocationCallbacks* pAllocator) {
+	if (mapped != nullptr) {
+		vkUnmapMemory(device, memory);
+		mapped = nullptr;
+	}
+	vkDestroyBuffer(device, buffer, pAllocator);
+	telemetry.free(device, memory, pAllocator);
+	buffer = VK_NULL_HANDLE;
+	memory = VK_NULL_HANDLE;
+}
+
+void UniformRingBuffer::beginFrame(uint32_t frameIndex) {
+	frameBegin = frameSize * frameIndex;
+	head = frameBegin;
+}
+
+UniformRingBuffer::Allocation UniformRingBuffer::allocateUniform(VkDeviceSize size) {
+	if (size > UNIFORM_BINDING_RANGE) {
+		throw std::runtime_error("Uniform allocation is larger than the dynamic uniform binding range!");
+	}
+	return allocate(size);
+}
+
+UniformRingBuffer::Allocation UniformRingBuffer::allocateStorage(VkDeviceSize size) {
+	if (size > STORAGE_BINDING_RANGE) {
+		throw std::runtime_error("Storage allocation is larger than the dynamic storage binding range!");
+	}
+	return allocate(size);
+}
+
+UniformRingBuffer::Allocation UniformRingBuffer::allocate(VkDeviceSize size) {
+	VkDeviceSize offset = alignUp(head, alignment);
+	if (offset + size > frameBegin + frameSize) {
+		throw std::runtime_error("Uniform ring buffer frame region exhausted!");
+	}
+	head = offset + size;
+	return { mapped + offset, static_cast<uint32_t>(offset) };
+}
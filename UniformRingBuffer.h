@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemoryTelemetry.h"
+#include "MemoryTypeTable.h"
+
+#include <cstdint>
+#include <cstring>
+
+// Persistently mapped ring of host visible memory for per-draw uniform and storage data.
+// The buffer is split into one region per frame in flight. A region is rewound once its frame's fence has signalled,
+// and allocations within it are a pointer bump plus a memcpy. Shaders see the data through dynamic descriptor offsets,
+// so a single descriptor set covers every allocation and nothing is created, mapped or unmapped per frame.
+class UniformRingBuffer {
+public:
+	// Largest block a single dynamic uniform / storage binding may address.
+	static constexpr VkDeviceSize UNIFORM_BINDING_RANGE = 256;
+	static constexpr VkDeviceSize STORAGE_BINDING_RANGE = 64 * 1024;
+
+	struct Allocation {
+		// Host pointer to write the data to
+		void* data;
+		// Offset to pass to vkCmdBindDescriptorSets
+		uint32_t dynamicOffset;
+	};
+
+	// The ring's memory is accounted to MemoryCategory::Uniforms in telemetry
+	void create(VkDevice device, const VkPhysicalDeviceLimits& limits, const MemoryTypeTable& memoryTypes, DeviceMemoryTelemetry& telemetry, VkDeviceSize bytesPerFrame, uint32_t frameCount, const VkAllocationCallbacks* pAllocator);
+	void destroy(VkDevice device, DeviceMemoryTelemetry& telemetry, const VkAllocationCallbacks* pAllocator);
+
+	// Rewind the region owned by frameIndex. Only call after that frame's fence has signalled.
+	void beginFrame(uint32_t frameIndex);
+
+	Allocation allocateUniform(VkDeviceSize size);
+	Allocation allocateStorage(VkDeviceSize size);
+
+	// Copy a value into the current frame's region and return its dynamic offset.
+	template<typename T>
+	uint32_t pushUniform(const T& value) {
+		Allocation allocation = allocateUniform(sizeof(T));
+		memcpy(allocation.data, &value, sizeof(T));
+		return allocation.dynamicOffset;
+	}
+
+	VkBuffer getBuffer() const { return buffer; }
+	VkDeviceSize getSize() const { return bufferSize; }
+	// Start of the current frame's region, and the data written into it so far
+	VkDeviceSize getFrameOffset() const { return frameBegin; }
+	const void* getFrameData() const { return mapped + frameBegin; }
+	VkDeviceSize getFrameCapacity() const { return frameSize; }
+	VkDeviceSize getFrameUsage() const { return head - frameBegin; }
+
+private:
+	Allocation allocate(VkDeviceSize size);
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	uint8_t* mapped = nullptr;
+	VkDeviceSize bufferSize = 0;
+	VkDeviceSize alignment = 0;
+	VkDeviceSize frameSize = 0;
+	// Start of the current frame's region and the next free byte within it.
+	VkDeviceSize frameBegin = 0;
+	VkDeviceSize head = 0;
+};
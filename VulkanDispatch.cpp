@@ -0,0 +1,14 @@
+#include "VulkanDispatch.h"
+
+void InstanceDispatch::load(VkInstance instance) {
+#define VULKAN_LOAD_FUNCTION(name) name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name));
+	VULKAN_INSTANCE_FUNCTIONS(VULKAN_LOAD_FUNCTION)
+#undef VULKAN_LOAD_FUNCTION
+}
+
+void DeviceDispatch::load(VkDevice device, const InstanceDispatch& instanceFunctions) {
+	PFN_vkGetDeviceProcAddr getDeviceProcAddr = instanceFunctions.vkGetDeviceProcAddr != nullptr ? instanceFunctions.vkGetDeviceProcAddr : vkGetDeviceProcAddr;
+#define VULKAN_LOAD_FUNCTION(name) name = reinterpret_cast<PFN_##name>(getDeviceProcAddr(device, #name));
+	VULKAN_DEVICE_FUNCTIONS(VULKAN_LOAD_FUNCTION)
+#undef VULKAN_LOAD_FUNCTION
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// Function tables resolved straight from the driver.
+// Calls through the exported vk* symbols go through the loader's trampoline, which looks up the dispatchable handle's
+// table and jumps again. Pointers from vkGetDeviceProcAddr point directly at the driver (or the first enabled layer),
+// so hot path vkCmd* / vkQueue* calls made through DeviceDispatch skip that extra indirect jump.
+//
+// The tables are generated from the lists below. To dispatch another function, add it to the matching list.
+
+// Instance level functions, including extension entry points that are not exported by the loader
+#define VULKAN_INSTANCE_FUNCTIONS(X) \
+	X(vkGetDeviceProcAddr) \
+	X(vkCreateDebugUtilsMessengerEXT) \
+	X(vkDestroyDebugUtilsMessengerEXT)
+
+// Device level functions called every frame
+#define VULKAN_DEVICE_FUNCTIONS(X) \
+	X(vkDeviceWaitIdle) \
+	X(vkQueueSubmit) \
+	X(vkQueueWaitIdle) \
+	X(vkWaitForFences) \
+	X(vkResetFences) \
+	X(vkGetFenceStatus) \
+	X(vkAcquireNextImageKHR) \
+	X(vkQueuePresentKHR) \
+	X(vkGetQueryPoolResults) \
+	X(vkResetCommandPool) \
+	X(vkBeginCommandBuffer) \
+	X(vkEndCommandBuffer) \
+	X(vkResetCommandBuffer) \
+	X(vkCmdBindPipeline) \
+	X(vkCmdBindDescriptorSets) \
+	X(vkCmdPushConstants) \
+	X(vkCmdSetViewport) \
+	X(vkCmdSetScissor) \
+	X(vkCmdBindVertexBuffers) \
+	X(vkCmdBindIndexBuffer) \
+	X(vkCmdBeginRendering) \
+	X(vkCmdEndRendering) \
+	X(vkCmdDraw) \
+	X(vkCmdDrawIndexed) \
+	X(vkCmdDispatch) \
+	X(vkCmdCopyBuffer) \
+	X(vkCmdCopyBufferToImage) \
+	X(vkCmdFillBuffer) \
+	X(vkCmdClearColorImage) \
+	X(vkCmdPipelineBarrier) \
+	X(vkCmdResetQueryPool) \
+	X(vkCmdBeginQuery) \
+	X(vkCmdEndQuery) \
+	X(vkCmdWriteTimestamp)
+
+struct InstanceDispatch {
+#define VULKAN_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+	VULKAN_INSTANCE_FUNCTIONS(VULKAN_DECLARE_FUNCTION)
+#undef VULKAN_DECLARE_FUNCTION
+
+	// Functions the instance doesn't provide (e.g. disabled extensions) are left null
+	void load(VkInstance instance);
+};
+
+struct DeviceDispatch {
+#define VULKAN_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+	VULKAN_DEVICE_FUNCTIONS(VULKAN_DECLARE_FUNCTION)
+#undef VULKAN_DECLARE_FUNCTION
+
+	// Call after vkCreateDevice. Functions the device doesn't provide are left null.
+	void load(VkDevice device, const InstanceDispatch& instanceFunctions);
+};
@@ -0,0 +1,198 @@
+#include "VulkanHostAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+static const char* scopeNames[VulkanHostAllocator::SCOPE_COUNT] = { "command", "object", "cache", "device", "instance" };
+
+// Smallest pool class is 64 bytes, each following class doubles
+static size_t poolClassSize(uint32_t poolClass) {
+	return size_t(64) << poolClass;
+}
+
+static uintptr_t alignUp(uintptr_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(uintptr_t(alignment) - 1);
+}
+
+VulkanHostAllocator::VulkanHostAllocator() {
+	callbacks.pUserData = this;
+	callbacks.pfnAllocation = allocationCallback;
+	callbacks.pfnReallocation = reallocationCallback;
+	callbacks.pfnFree = freeCallback;
+	callbacks.pfnInternalAllocation = internalAllocationCallback;
+	callbacks.pfnInternalFree = internalFreeCallback;
+	arena = static_cast<uint8_t*>(malloc(ARENA_SIZE));
+}
+
+VulkanHostAllocator::~VulkanHostAllocator() {
+	for (void* chunk : poolChunks) {
+		free(chunk);
+	}
+	free(arena);
+}
+
+VKAPI_ATTR void* VKAPI_CALL VulkanHostAllocator::allocationCallback(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+	return static_cast<VulkanHostAllocator*>(pUserData)->allocate(size, alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL VulkanHostAllocator::reallocationCallback(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+	VulkanHostAllocator* self = static_cast<VulkanHostAllocator*>(pUserData);
+	// Follows realloc semantics as required by the spec
+	if (pOriginal == nullptr) {
+		return self->allocate(size, alignment, scope);
+	}
+	if (size == 0) {
+		self->release(pOriginal);
+		return nullptr;
+	}
+	void* memory = self->allocate(size, alignment, scope);
+	if (memory == nullptr) {
+		return nullptr;
+	}
+	const Header* original = reinterpret_cast<const Header*>(pOriginal) - 1;
+	memcpy(memory, pOriginal, std::min(size, original->size));
+	uint8_t originalScope = original->scope;
+	self->release(pOriginal);
+
+	// allocate() and release() counted the move as an allocation and a free; it is one reallocation
+	std::lock_guard<std::mutex> lock(self->mutex);
+	self->stats[scope].allocations--;
+	self->stats[originalScope].frees--;
+	self->stats[scope].reallocations++;
+	return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::freeCallback(void* pUserData, void* pMemory) {
+	if (pMemory != nullptr) {
+		static_cast<VulkanHostAllocator*>(pUserData)->release(pMemory);
+	}
+}
+
+VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::internalAllocationCallback(void* pUserData, size_t size, VkInternalAllocationType /*type*/, VkSystemAllocationScope scope) {
+	VulkanHostAllocator* self = static_cast<VulkanHostAllocator*>(pUserData);
+	std::lock_guard<std::mutex> lock(self->mutex);
+	self->stats[scope].internalBytes += size;
+}
+
+VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::internalFreeCallback(void* pUserData, size_t size, VkInternalAllocationType /*type*/, VkSystemAllocationScope scope) {
+	VulkanHostAllocator* self = static_cast<VulkanHostAllocator*>(pUserData);
+	std::lock_guard<std::mutex> lock(self->mutex);
+	self->stats[scope].internalBytes -= size;
+}
+
+void* VulkanHostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+	if (size == 0) {
+		return nullptr;
+	}
+	// Room for the header in front of the pointer plus worst case alignment padding
+	alignment = std::max(alignment, alignof(std::max_align_t));
+	const size_t footprint = size + sizeof(Header) + alignment - 1;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	void* base = nullptr;
+	Source source = Source::Heap;
+	uint8_t poolClass = 0;
+
+	if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && arenaHead + footprint <= ARENA_SIZE) {
+		base = arena + arenaHead;
+		arenaHead += footprint;
+		arenaOutstanding++;
+		source = Source::Arena;
+	}
+	else if (scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT && footprint <= poolClassSize(POOL_CLASS_COUNT - 1)) {
+		while (poolClassSize(poolClass) < footprint) {
+			poolClass++;
+		}
+		base = allocateFromPool(poolClass);
+		source = Source::Pool;
+	}
+	else {
+		if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+			stats[scope].arenaOverflows++;
+		}
+		base = malloc(footprint);
+	}
+	if (base == nullptr) {
+		return nullptr;
+	}
+
+	uintptr_t user = alignUp(reinterpret_cast<uintptr_t>(base) + sizeof(Header), alignment);
+	Header* header = reinterpret_cast<Header*>(user) - 1;
+	header->base = base;
+	header->size = size;
+	header->scope = static_cast<uint8_t>(scope);
+	header->source = source;
+	header->poolClass = poolClass;
+
+	ScopeStats& scopeStats = stats[scope];
+	scopeStats.allocations++;
+	scopeStats.totalBytes += size;
+	scopeStats.liveBytes += size;
+	scopeStats.peakBytes = std::max(scopeStats.peakBytes, scopeStats.liveBytes);
+	return reinterpret_cast<void*>(user);
+}
+
+void VulkanHostAllocator::release(void* pMemory) {
+	const Header header = *(reinterpret_cast<const Header*>(pMemory) - 1);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	ScopeStats& scopeStats = stats[header.scope];
+	scopeStats.frees++;
+	scopeStats.liveBytes -= header.size;
+
+	switch (header.source) {
+	case Source::Arena:
+		// Command scoped memory only lives for the duration of a call, so the arena empties out between calls
+		if (--arenaOutstanding == 0) {
+			arenaHead = 0;
+		}
+		break;
+	case Source::Pool:
+		*static_cast<void**>(header.base) = freeLists[header.poolClass];
+		freeLists[header.poolClass] = header.base;
+		break;
+	case Source::Heap:
+		free(header.base);
+		break;
+	}
+}
+
+// Caller holds the mutex
+void* VulkanHostAllocator::allocateFromPool(uint32_t poolClass) {
+	if (freeLists[poolClass] == nullptr) {
+		void* chunk = malloc(POOL_CHUNK_SIZE);
+		if (chunk == nullptr) {
+			return nullptr;
+		}
+		poolChunks.push_back(chunk);
+		// Thread every block of the new chunk onto the free list
+		const size_t blockSize = poolClassSize(poolClass);
+		uint8_t* blocks = static_cast<uint8_t*>(chunk);
+		for (size_t offset = 0; offset + blockSize <= POOL_CHUNK_SIZE; offset += blockSize) {
+			*reinterpret_cast<void**>(blocks + offset) = freeLists[poolClass];
+			freeLists[poolClass] = blocks + offset;
+		}
+	}
+	void* block = freeLists[poolClass];
+	freeLists[poolClass] = *static_cast<void**>(block);
+	return block;
+}
+
+VulkanHostAllocator::ScopeStats VulkanHostAllocator::getStats(VkSystemAllocationScope scope) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats[scope];
+}
+
+void VulkanHostAllocator::printStatistics(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	out << "Vulkan host allocations by scope:" << std::endl;
+	out << std::left << std::setw(10) << "scope" << std::right << std::setw(10) << "allocs" << std::setw(10) << "reallocs" << std::setw(10) << "frees"
+		<< std::setw(14) << "live bytes" << std::setw(14) << "peak bytes" << std::setw(14) << "total bytes" << std::setw(14) << "internal" << std::setw(12) << "overflows" << std::endl;
+	for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++) {
+		const ScopeStats& s = stats[scope];
+		out << std::left << std::setw(10) << scopeNames[scope] << std::right << std::setw(10) << s.allocations << std::setw(10) << s.reallocations << std::setw(10) << s.frees
+			<< std::setw(14) << s.liveBytes << std::setw(14) << s.peakBytes << std::setw(14) << s.totalBytes << std::setw(14) << s.internalBytes << std::setw(12) << s.arenaOverflows << std::endl;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Engine owned VkAllocationCallbacks for the driver's host (CPU) allocations.
+// Allocations are routed by VkSystemAllocationScope:
+//   COMMAND  - bump arena, rewound whenever no command scoped allocation is outstanding
+//   OBJECT   - size class pools, since objects are created and destroyed in similar sizes
+//   CACHE, DEVICE, INSTANCE - long lived, taken from the heap
+// Every scope records allocation counts and live / peak / total bytes.
+// The allocator must outlive every Vulkan object created with its callbacks.
+class VulkanHostAllocator {
+public:
+	static const uint32_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+	struct ScopeStats {
+		// A reallocation counts as neither an allocation nor a free
+		uint64_t allocations = 0;
+		uint64_t reallocations = 0;
+		uint64_t frees = 0;
+		uint64_t liveBytes = 0;
+		uint64_t peakBytes = 0;
+		uint64_t totalBytes = 0;
+		// Memory the driver allocated itself and only reported through the internal notifications
+		uint64_t internalBytes = 0;
+		// Command scoped allocations that didn't fit in the arena and came from the heap
+		uint64_t arenaOverflows = 0;
+	};
+
+	VulkanHostAllocator();
+	~VulkanHostAllocator();
+	VulkanHostAllocator(const VulkanHostAllocator&) = delete;
+	VulkanHostAllocator& operator=(const VulkanHostAllocator&) = delete;
+
+	// Pass this wherever Vulkan takes a pAllocator
+	const VkAllocationCallbacks* getCallbacks() const { return &callbacks; }
+
+	ScopeStats getStats(VkSystemAllocationScope scope) const;
+	void printStatistics(std::ostream& out) const;
+
+private:
+	// Where a block came from, so free knows where to return it
+	enum class Source : uint8_t { Heap, Arena, Pool };
+
+	// Stored immediately in front of every pointer handed to the driver
+	struct Header {
+		void* base;
+		size_t size;
+		uint8_t scope;
+		Source source;
+		uint8_t poolClass;
+	};
+
+	static const size_t ARENA_SIZE = 1024 * 1024;
+	static const uint32_t POOL_CLASS_COUNT = 7;
+	static const size_t POOL_CHUNK_SIZE = 64 * 1024;
+
+	static VKAPI_ATTR void* VKAPI_CALL allocationCallback(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void* VKAPI_CALL reallocationCallback(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL freeCallback(void* pUserData, void* pMemory);
+	static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void* pUserData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void* pUserData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+	void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void release(void* pMemory);
+	void* allocateFromPool(uint32_t poolClass);
+
+	VkAllocationCallbacks callbacks{};
+	mutable std::mutex mutex;
+	ScopeStats stats[SCOPE_COUNT];
+
+	// Command scope arena
+	uint8_t* arena = nullptr;
+	size_t arenaHead = 0;
+	uint32_t arenaOutstanding = 0;
+
+	// Object scope pools: one free list per size class, carved from chunks that live until destruction
+	void* freeLists[POOL_CLASS_COUNT] = {};
+	std::vector<void*> poolChunks;
+};
@@ -0,0 +1,68 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::~WorkerPool() {
+	stop();
+}
+
+void WorkerPool::start(uint32_t workerCount) {
+	stop();
+	this->workerCount = std::max(workerCount, 1u);
+	stopping = false;
+	threads.reserve(this->workerCount - 1);
+	for (uint32_t worker = 1; worker < this->workerCount; worker++) {
+		threads.emplace_back(&WorkerPool::workerMain, this, worker, generation);
+	}
+}
+
+void WorkerPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskReady.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+	workerCount = 1;
+}
+
+void WorkerPool::dispatch(TaskFunction function, void* task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		taskFunction = function;
+		taskData = task;
+		pending = workerCount - 1;
+		generation++;
+	}
+	taskReady.notify_all();
+	function(task, 0);
+	std::unique_lock<std::mutex> lock(mutex);
+	taskDone.wait(lock, [this]() { return pending == 0; });
+}
+
+// seen is the last task started before this worker existed
+void WorkerPool::workerMain(uint32_t worker, uint64_t seen) {
+	for (;;) {
+		TaskFunction function;
+		void* task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskReady.wait(lock, [this, seen]() { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+			function = taskFunction;
+			task = taskData;
+		}
+		function(task, worker);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending--;
+		}
+		taskDone.notify_one();
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that all run the same task and then wait for the next one.
+// The calling thread takes part as worker 0, so a pool of one worker runs everything inline. Tasks are passed by
+// reference and invoked through a plain function pointer, so running one never allocates.
+class WorkerPool {
+public:
+	WorkerPool() = default;
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Stop any running threads and start workerCount - 1 new ones
+	void start(uint32_t workerCount);
+	void stop();
+	uint32_t getWorkerCount() const { return workerCount; }
+
+	// Call task(worker) once on every worker, 0 <= worker < getWorkerCount(), and wait for all of them
+	template<typename Task>
+	void run(Task& task) {
+		dispatch(&invoke<Task>, &task);
+	}
+
+	// Split [0, count) into getWorkerCount() contiguous ranges, as evenly as possible
+	void getRange(uint32_t worker, uint32_t count, uint32_t& begin, uint32_t& end) const {
+		begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * worker / workerCount);
+		end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (worker + 1) / workerCount);
+	}
+
+private:
+	using TaskFunction = void (*)(void* task, uint32_t worker);
+
+	template<typename Task>
+	static void invoke(void* task, uint32_t worker) {
+		(*static_cast<Task*>(task))(worker);
+	}
+
+	void dispatch(TaskFunction function, void* task);
+	void workerMain(uint32_t worker, uint64_t seen);
+
+	std::vector<std::thread> threads;
+	uint32_t workerCount = 1;
+
+	std::mutex mutex;
+	std::condition_variable taskReady;
+	std::condition_variable taskDone;
+	TaskFunction taskFunction = nullptr;
+	void* taskData = nullptr;
+	// Incremented for every task, so a worker never runs the same one twice
+	uint64_t generation = 0;
+	uint32_t pending = 0;
+	bool stopping = false;
+};
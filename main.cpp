@@ -12,47 +12,121 @@
 #include <vector>
 #include <cstring>
 #include <set>
+#include <string>
+#include <future>
+#include <thread>
+#include <chrono>
+#include <algorithm>
 
-// GLFW Window Height and Width
-const uint32_t WINDOW_WIDTH = 1920;
-const uint32_t WINDOW_HEIGHT = 1080;
+#include "AllocationTracker.h"
+#include "AsyncCompute.h"
+#include "BenchmarkSweep.h"
+#include "CapabilityCache.h"
+#include "DeviceMemoryTelemetry.h"
+#include "DynamicResolution.h"
+#include "FlightRecorder.h"
+#include "FrameCapture.h"
+#include "GpuProfiler.h"
+#include "InputLatency.h"
+#include "LinearArena.h"
+#include "MemoryTypeTable.h"
+#include "PerformanceHud.h"
+#include "PostProcess.h"
+#include "QueueUtilization.h"
+#include "RuntimeConfig.h"
+#include "ShaderLoader.h"
+#include "StartupTimeline.h"
+#include "StressScene.h"
+#include "TelemetryStream.h"
+#include "ThreadScalingStudy.h"
+#include "UniformRingBuffer.h"
+#include "VulkanDispatch.h"
+#include "VulkanHostAllocator.h"
+
+// Window size, frames in flight, present mode, validation and the API version are runtime settings, see RuntimeConfig.h
+
+// Bytes of per-draw uniform / storage data available to each frame in flight
+const VkDeviceSize UNIFORM_RING_BYTES_PER_FRAME = 4 * 1024 * 1024;
+// Bytes of transient CPU memory (HUD text, culling and sort lists) available to each frame in flight
+const size_t FRAME_ARENA_BYTES_PER_FRAME = 8 * 1024 * 1024;
+
+// SPIR-V the pipelines are built from, read ahead on workers at startup; the scene's only when it is enabled
+const std::vector<std::string> SHADER_FILES = {
+	"shaders/hud.vert.spv", "shaders/hud.frag.spv",
+	"shaders/post.vert.spv", "shaders/post.frag.spv", "shaders/taa.comp.spv", "shaders/bloom.comp.spv"
+};
+const std::vector<std::string> SCENE_SHADER_FILES = { "shaders/scene.vert.spv", "shaders/scene.frag.spv", "shaders/lightbin.comp.spv" };
 
 // Validation Layer
 const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
-#ifdef NDEBUG
-	const bool enableValidationLayers = false;
-#else
-	const bool enableValidationLayers = true;
-#endif
 
-VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
-	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
-	if (func != nullptr) {
-		return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
-	}
-	else {
-		return VK_ERROR_EXTENSION_NOT_PRESENT;
-	}
-}
+// Device extensions
+const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
-void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) {
-	auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
-	if (func != nullptr) {
-		func(instance, debugMessenger, pAllocator);
-	}
-}
+// Layer, extension, queue family and format probes are cached here between launches
+const std::string CAPABILITY_CACHE_PATH = "capabilities.cache";
+const std::string CAPABILITY_JSON_PATH = "capabilities.json";
+// Per-pass GPU timings and pipeline statistics averaged over the run, written at exit
+const std::string GPU_PROFILE_JSON_PATH = "gpu_profile.json";
+// Device memory usage per heap and category in Prometheus text format, rewritten periodically and at exit
+const std::string MEMORY_METRICS_PATH = "gpu_memory.prom";
+const double MEMORY_METRICS_INTERVAL_SECONDS = 5.0;
+
+// Steady state allocation checking. Heap allocations inside mainLoop() after the warmup frames are reported,
+// and with the strictAllocations setting on the first offending frame fails the run.
+const uint32_t ALLOCATION_WARMUP_FRAMES = 120;
+// Frame captured by --capture: the last warmup frame, so the capture's own allocations aren't held against steady state.
+// A run configured shorter than that captures its last frame.
+const uint64_t CAPTURE_FRAME = ALLOCATION_WARMUP_FRAMES - 1;
+
+// Frames between refreshes of the HUD's heap usage while it is visible
+const uint64_t HUD_MEMORY_REFRESH_FRAMES = 30;
+
+// --input-latency: frames between synthetic key presses, and where the histogram is written
+const uint32_t INPUT_LATENCY_INTERVAL_FRAMES = 8;
+const std::string INPUT_LATENCY_JSON_PATH = "input_latency.json";
+
+// Per-frame statistics for live readers (--telemetry-client), published on a Unix domain socket
+const std::string TELEMETRY_SOCKET_PATH = "telemetry.sock";
+
+// --thread-scaling: stress scene size unless configured, and where the per-stage speedup table is written
+const uint32_t THREAD_SCALING_DEFAULT_OBJECTS = 100000;
+const std::string THREAD_SCALING_JSON_PATH = "thread_scaling.json";
+
+// --sweep: one row per combination of settings
+const std::string SWEEP_CSV_PATH = "sweep_results.csv";
 
 struct QueueFamilyIndices {
 	// No value unless one is assigned
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	// A compute-only family for async compute, if the device has one
+	std::optional<uint32_t> computeFamily;
 	// True if the data member has a value
 	bool isComplete() { return graphicsFamily.has_value() && presentFamily.has_value(); }
 };
 
+struct SwapChainSupportDetails {
+	VkSurfaceCapabilitiesKHR capabilities;
+	std::vector<VkSurfaceFormatKHR> formats;
+	std::vector<VkPresentModeKHR> presentModes;
+};
+
 class Application {
 public:
+	explicit Application(const RuntimeConfig& config) : config(config) {}
 	void run();
+	// Write the frame at CAPTURE_FRAME, or a shorter run's last frame, to path for replay with --replay
+	void captureFrame(const std::string& path);
+	// Inject eventCount synthetic key presses, then close; fails the run if the p99 latency exceeds the limit
+	void measureInputLatency(uint32_t eventCount, double maxP99Milliseconds);
+	bool passedInputLatencyGate() const { return inputLatency.passed(); }
+	// Run the thread scaling study over the configured stress scene instead of the frame loop
+	void studyThreadScaling();
+	// Frame times of the last run, after the warmup frames
+	RunSummary getSummary() const { return frameSampler.summarize(); }
+	// Where the per-pass GPU profile is written at exit, GPU_PROFILE_JSON_PATH unless set
+	void setProfilePath(const std::string& path) { profilePath = path; }
 private:
 	// Functions 
 	void initWindow();
@@ -62,10 +136,34 @@ private:
 	void createInstance();
 	bool checkValidationLayerSupport();
 	bool isDeviceSuitable(VkPhysicalDevice device);
+	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 	void selectPhysicalDevice();
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
 	void createLogicalDevice();
 	void createSurface();
+	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
+	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
+	void createSwapChain();
+	void createImageViews();
+	VkFormat findDepthFormat();
+	VkSampleCountFlagBits chooseSampleCount(uint32_t requested) const;
+	void createDepthResources();
+	void cleanupSwapChain();
+	void recreateSwapChain();
+	void createCommandPool();
+	void createCommandBuffers();
+	void createUniformRing();
+	void createDescriptorSetLayout();
+	void createDescriptorPool();
+	void createDescriptorSets();
+	void createSyncObjects();
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	void drawFrame();
+
+	// Input
+	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 	// Debug Messenger
 	void setupDebugMessenger();
@@ -74,22 +172,233 @@ private:
 	void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 
 	// Variables
-	GLFWwindow* window;
-	VkInstance instance;
-	VkDebugUtilsMessengerEXT debugMessenger;
+	// Constructed first so startup is measured from the moment the application exists
+	StartupTimeline timeline;
+	// Host memory for every Vulkan object goes through hostAllocator, so it is declared first and destroyed last
+	VulkanHostAllocator hostAllocator;
+	const VkAllocationCallbacks* allocator = hostAllocator.getCallbacks();
+	const RuntimeConfig config;
+	GLFWwindow* window = nullptr;
+	VkInstance instance = VK_NULL_HANDLE;
+	// Function pointers resolved from the instance / device, see VulkanDispatch.h
+	InstanceDispatch instanceTable;
+	DeviceDispatch deviceTable;
+	VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
+	CapabilityCache capabilities;
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-	VkDevice logicalDevice;
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	MemoryTypeTable memoryTypes;
+	// Every device allocation is made through memoryTelemetry and tagged with a category
+	DeviceMemoryTelemetry memoryTelemetry;
+	VkDevice logicalDevice = VK_NULL_HANDLE;
 	VkQueue graphicsQueue;
-	VkSurfaceKHR surface;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
 	VkQueue presentQueue;
+	// Compute-only queue, VK_NULL_HANDLE when the device has none or async compute is off
+	VkQueue computeQueue = VK_NULL_HANDLE;
+	// VK_EXT_memory_budget and pipeline statistics queries are enabled when configured and the device has them
+	bool memoryBudgetEnabled = false;
+	bool pipelineStatisticsEnabled = false;
+
+	// Swap chain
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+	std::vector<VkImage> swapChainImages;
+	VkFormat swapChainImageFormat;
+	VkExtent2D swapChainExtent;
+	std::vector<VkImageView> swapChainImageViews;
+	// Depth buffer, recreated with the swap chain. Shared by the frames in flight, which a barrier serializes. It is
+	// never stored, so it is a transient attachment, multisampled like the scene and never resolved.
+	VkFormat depthFormat;
+	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	VkImage depthImage = VK_NULL_HANDLE;
+	VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+	VkImageView depthImageView = VK_NULL_HANDLE;
+	// The scene is rendered into the HDR target of postProcess, which brings it to the swap chain image
+	PostProcessChain postProcess;
+	// Scales the scene's part of the HDR target to hold the GPU time budget
+	DynamicResolutionController dynamicResolution;
+
+	// Command buffers, one per frame in flight
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> commandBuffers;
+
+	// Per-draw constants, bound through dynamic offsets into ringDescriptorSet
+	UniformRingBuffer uniformRing;
+	VkDescriptorSetLayout ringDescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet ringDescriptorSet;
+
+	// Frame capture for deterministic replay
+	FrameRecorder recorder;
+	// Always-on trace of recent frames, written out when one hitches
+	FlightRecorder flightRecorder;
+	// Input-to-present latency test mode
+	InputLatencyHarness inputLatency;
+
+	// Transient CPU allocations for the frame being recorded
+	FrameArena frameArena;
 
+	// Procedural scene for scaling benchmarks, only created when configured. Generated on a worker from the start of run().
+	StressScene stressScene;
+	std::future<GeneratedScene> generatedScene;
+	TelemetryStream telemetryStream;
+	bool threadScalingEnabled = false;
+	ThreadScalingStudy threadScaling;
+
+	// GPU pass timings and the overlay showing them (F1)
+	GpuProfiler profiler;
+	std::string profilePath = GPU_PROFILE_JSON_PATH;
+	PerformanceHud hud;
+	// Work overlapping the graphics queue: light binning for the stress scene
+	AsyncComputeQueue asyncCompute;
+	// Idle time of each queue between submissions
+	QueueUtilization queueUtilization;
+	uint32_t graphicsUtilizationQueue;
+	uint32_t computeUtilizationQueue = 0;
+	// Scene draws recorded this frame
+	uint32_t frameDrawCount = 0;
+	uint64_t frameTriangleCount = 0;
+	// Frame times for the run's summary
+	FrameSampler frameSampler;
+	double frameCpuMilliseconds = 0.0;
+	// Set when strict allocation checking stops the frame loop; the run fails once it has been torn down
+	bool frameAllocationFailed = false;
+
+	// Frame pacing. Render finished semaphores are per swap chain image, so one is never signalled again while
+	// a presentation may still be waiting on it.
+	std::vector<VkSemaphore> imageAvailableSemaphores;
+	std::vector<VkSemaphore> renderFinishedSemaphores;
+	std::vector<VkFence> inFlightFences;
+	uint32_t currentFrame = 0;
 };
 
 
-int main() {
-	Application app;
+// The argument after i when it is a value rather than the next flag or setting, advancing i past it
+static const char* nextValue(int argc, char** argv, int& i) {
+	if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0 && strchr(argv[i + 1], '=') == nullptr) {
+		return argv[++i];
+	}
+	return nullptr;
+}
+
+static const char* requireValue(int argc, char** argv, int& i) {
+	const char* flag = argv[i];
+	const char* value = nextValue(argc, argv, i);
+	if (value == nullptr) {
+		throw std::runtime_error(std::string("Missing value for ") + flag + "!");
+	}
+	return value;
+}
+
+int main(int argc, char** argv) {
 	try {
+		// Settings from --config files and key=value arguments apply in order; the remaining flags choose a mode
+		RuntimeConfig config;
+		std::string capturePath;
+		std::string sweepPath;
+		uint32_t inputLatencyEvents = 0;
+		double inputLatencyMaxP99 = 0.0;
+		bool threadScaling = false;
+		for (int i = 1; i < argc; i++) {
+			std::string argument = argv[i];
+			// --telemetry-client [socket] prints the telemetry of a running instance until it exits
+			if (argument == "--telemetry-client") {
+				const char* path = nextValue(argc, argv, i);
+				if (!printTelemetryStream(path != nullptr ? path : TELEMETRY_SOCKET_PATH, std::cout)) {
+					throw std::runtime_error("Failed to connect to telemetry stream!");
+				}
+				return EXIT_SUCCESS;
+			}
+			// --replay <capture> [iterations] re-executes a captured frame headlessly instead of opening the window
+			else if (argument == "--replay") {
+				const char* path = requireValue(argc, argv, i);
+				const char* iterations = nextValue(argc, argv, i);
+				FrameReplayer replayer;
+				replayer.run(path, iterations != nullptr ? static_cast<uint32_t>(std::stoul(iterations)) : 100);
+				return EXIT_SUCCESS;
+			}
+			// --config <file> applies the settings in a file
+			else if (argument == "--config") {
+				config.load(requireValue(argc, argv, i));
+			}
+			// --sweep <file> runs every combination of the settings listed in a file and tabulates them
+			else if (argument == "--sweep") {
+				sweepPath = requireValue(argc, argv, i);
+			}
+			// --capture <capture> writes one steady state frame to disk
+			else if (argument == "--capture") {
+				capturePath = requireValue(argc, argv, i);
+			}
+			// --scene <objects> [meshes] [materials] [lights] [motion ratio] [seed] renders a generated stress scene
+			else if (argument == "--scene") {
+				const char* keys[] = { "scene.objects", "scene.meshes", "scene.materials", "scene.lights", "scene.motion", "scene.seed" };
+				config.set(keys[0], requireValue(argc, argv, i));
+				for (uint32_t k = 1; k < 6; k++) {
+					const char* value = nextValue(argc, argv, i);
+					if (value == nullptr) {
+						break;
+					}
+					config.set(keys[k], value);
+				}
+			}
+			// --input-latency <events> [max p99 ms] measures input-to-present latency and gates on it
+			else if (argument == "--input-latency") {
+				inputLatencyEvents = static_cast<uint32_t>(std::stoul(requireValue(argc, argv, i)));
+				const char* maxP99 = nextValue(argc, argv, i);
+				inputLatencyMaxP99 = maxP99 != nullptr ? std::stod(maxP99) : 0.0;
+			}
+			// --thread-scaling [objects] measures how the frame's CPU stages scale from one worker to every core
+			else if (argument == "--thread-scaling") {
+				threadScaling = true;
+				const char* objects = nextValue(argc, argv, i);
+				if (objects != nullptr) {
+					config.set("scene.objects", objects);
+				}
+			}
+			else if (!config.parseArgument(argument)) {
+				RuntimeConfig::printKeys(std::cerr);
+				throw std::runtime_error("Unknown argument " + argument + "!");
+			}
+		}
+		if (threadScaling && !config.sceneEnabled) {
+			config.set("scene.objects", std::to_string(THREAD_SCALING_DEFAULT_OBJECTS));
+		}
+
+		if (!sweepPath.empty()) {
+			if (!capturePath.empty() || inputLatencyEvents > 0 || threadScaling) {
+				throw std::runtime_error("--sweep only runs the frame loop!");
+			}
+			BenchmarkSweep sweep;
+			sweep.load(sweepPath);
+			// A fresh application per run, so nothing carries over between settings
+			sweep.run(config, GPU_PROFILE_JSON_PATH, [](const RuntimeConfig& runConfig, const std::string& profilePath) {
+				Application app(runConfig);
+				app.setProfilePath(profilePath);
+				app.run();
+				return app.getSummary();
+			});
+			sweep.print(std::cout);
+			sweep.writeCsv(SWEEP_CSV_PATH);
+			return EXIT_SUCCESS;
+		}
+
+		Application app(config);
+		if (!capturePath.empty()) {
+			app.captureFrame(capturePath);
+		}
+		if (inputLatencyEvents > 0) {
+			app.measureInputLatency(inputLatencyEvents, inputLatencyMaxP99);
+		}
+		if (threadScaling) {
+			app.studyThreadScaling();
+		}
 		app.run();
+		if (config.frames > 0 && !threadScaling) {
+			printRunSummary(app.getSummary(), std::cout);
+		}
+		if (!app.passedInputLatencyGate()) {
+			return EXIT_FAILURE;
+		}
 	}
 	catch(const std::exception& e) {
 		std::cerr << e.what() << std::endl;
@@ -100,36 +409,152 @@ int main() {
 
 // Run the program
 void Application::run() {
-	initWindow();
-	initVulkan();
-	mainLoop();
+	// Shader files and the stress scene only depend on the configuration, so they load on workers from the start and
+	// are joined where the pipelines and the scene are created
+	prefetchShaderFiles(SHADER_FILES);
+	if (config.sceneEnabled) {
+		prefetchShaderFiles(SCENE_SHADER_FILES);
+		generatedScene = std::async(std::launch::async, [this]() {
+			GeneratedScene scene;
+			timeline.measure("generateScene", [this, &scene]() { scene = generateScene(config.scene); });
+			return scene;
+		});
+	}
+	// Initialize GLFW
+	timeline.measure("glfwInit", []() { glfwInit(); });
+	// The instance doesn't depend on the window, so create it on a worker while the main thread creates the window
+	std::future<void> instanceCreated = std::async(std::launch::async, [this]() {
+		timeline.measure("loadCapabilityCache", [this]() { capabilities.load(CAPABILITY_CACHE_PATH); });
+		timeline.measure("createInstance", [this]() { createInstance(); });
+	});
+	timeline.measure("initWindow", [this]() { initWindow(); });
+	// A run that fails part way still tears down what it built, so a sweep can go on with its next run
+	try {
+		instanceCreated.get();
+		initVulkan();
+		if (threadScalingEnabled) {
+			uint32_t graphicsFamily = findQueueFamilies(physicalDevice).graphicsFamily.value();
+			threadScaling.run(logicalDevice, deviceTable, graphicsFamily, stressScene, frameArena, swapChainExtent, 0, config.getWorkerCount(), allocator);
+			threadScaling.print(std::cout);
+			threadScaling.writeJson(THREAD_SCALING_JSON_PATH);
+		}
+		else {
+			mainLoop();
+		}
+	}
+	catch (...) {
+		cleanup();
+		throw;
+	}
 	cleanup();
+	if (frameAllocationFailed) {
+		throw std::runtime_error("Heap allocation inside the frame loop after warmup!");
+	}
+	// Still open means the window was closed before the captured frame came up
+	if (recorder.isOpen()) {
+		throw std::runtime_error("No frame captured, the run ended before frame " + std::to_string(CAPTURE_FRAME + 1) + "!");
+	}
 }
 
-// Initialize our Window
+void Application::captureFrame(const std::string& path) {
+	recorder.open(path);
+}
+
+void Application::studyThreadScaling() {
+	if (!config.sceneEnabled) {
+		throw std::runtime_error("Thread scaling needs a stress scene!");
+	}
+	threadScalingEnabled = true;
+}
+
+void Application::measureInputLatency(uint32_t eventCount, double maxP99Milliseconds) {
+	inputLatency.start(eventCount, INPUT_LATENCY_INTERVAL_FRAMES, maxP99Milliseconds);
+}
+
+// Initialize our Window. GLFW windows must be created on the main thread.
 void Application::initWindow() {
-	// Initialize GLFW
-	glfwInit();
 	// Don't create an OpenGL context object & no resize
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 	// Create the window
-	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Vulkan Environment", nullptr, nullptr);
+	window = glfwCreateWindow(static_cast<int>(config.width), static_cast<int>(config.height), "Vulkan Environment", nullptr, nullptr);
+	// Route key presses back to this instance
+	glfwSetWindowUserPointer(window, this);
+	glfwSetKeyCallback(window, keyCallback);
 }
 
 // Initialize Vulkan
+// The instance has already been created by run()
 void Application::initVulkan() {
-	createInstance();
-	setupDebugMessenger();
-	createSurface();
-	selectPhysicalDevice();
-	createLogicalDevice();
+	timeline.measure("setupDebugMessenger", [this]() { setupDebugMessenger(); });
+	timeline.measure("createSurface", [this]() { createSurface(); });
+	timeline.measure("selectPhysicalDevice", [this]() { selectPhysicalDevice(); });
+	timeline.measure("createLogicalDevice", [this]() { createLogicalDevice(); });
+	timeline.measure("createSwapChain", [this]() {
+		createSwapChain();
+		createImageViews();
+		createDepthResources();
+		postProcess.createTargets(logicalDevice, graphicsQueue, findQueueFamilies(physicalDevice).graphicsFamily.value(), memoryTypes, memoryTelemetry, swapChainExtent, msaaSamples, allocator);
+		recorder.recordCreateTargets(swapChainExtent, swapChainImageFormat, depthFormat, msaaSamples);
+		dynamicResolution.create(config.dynamicResolution, config.framesInFlight);
+		dynamicResolution.setOutputExtent(swapChainExtent);
+	});
+	timeline.measure("createFrameResources", [this]() {
+		createUniformRing();
+		createDescriptorSetLayout();
+		createDescriptorPool();
+		createDescriptorSets();
+		createCommandPool();
+		createCommandBuffers();
+		createSyncObjects();
+		// The thread scaling study's frames hold a culling and sort list entry per object
+		size_t frameArenaBytes = FRAME_ARENA_BYTES_PER_FRAME;
+		if (threadScalingEnabled) {
+			frameArenaBytes = std::max(frameArenaBytes, ThreadScalingStudy::getFrameArenaBytes(config.scene.objectCount, config.getWorkerCount()));
+		}
+		frameArena.create(frameArenaBytes, config.framesInFlight);
+		uint32_t graphicsFamily = findQueueFamilies(physicalDevice).graphicsFamily.value();
+		uint32_t timestampValidBits = capabilities.getDevice(physicalDevice).queueFamilies[graphicsFamily].timestampValidBits;
+		profiler.create(logicalDevice, deviceTable, physicalDeviceProperties.limits, timestampValidBits, pipelineStatisticsEnabled, config.framesInFlight, allocator);
+		queueUtilization.create(logicalDevice, deviceTable, physicalDeviceProperties.limits, config.framesInFlight, allocator);
+		graphicsUtilizationQueue = queueUtilization.addQueue("graphics", timestampValidBits);
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		uint32_t computeFamily = computeQueue != VK_NULL_HANDLE ? indices.computeFamily.value() : graphicsFamily;
+		asyncCompute.create(logicalDevice, deviceTable, computeQueue, computeFamily, graphicsFamily, config.framesInFlight, allocator);
+		if (asyncCompute.isAsync()) {
+			computeUtilizationQueue = queueUtilization.addQueue("async compute", capabilities.getDevice(physicalDevice).queueFamilies[computeFamily].timestampValidBits);
+		}
+		// Telemetry is optional, a run without it is still a valid run
+		if (config.telemetry && !telemetryStream.create(TELEMETRY_SOCKET_PATH)) {
+			std::cerr << "Telemetry stream unavailable on " << TELEMETRY_SOCKET_PATH << std::endl;
+		}
+	});
+	timeline.measure("createHudPipeline", [this]() {
+		hud.create(logicalDevice, swapChainImageFormat, ringDescriptorSetLayout, allocator);
+	});
+	timeline.measure("createPostProcessPipelines", [this]() {
+		postProcess.create(logicalDevice, swapChainImageFormat, allocator);
+	});
+	if (config.hudVisible) {
+		hud.toggle();
+	}
+	if (config.sceneEnabled) {
+		timeline.measure("createStressScene", [this]() {
+			uint32_t graphicsFamily = findQueueFamilies(physicalDevice).graphicsFamily.value();
+			stressScene.create(logicalDevice, graphicsQueue, graphicsFamily, asyncCompute.getQueueFamilies(), asyncCompute.getQueueFamilyCount(), memoryTypes, memoryTelemetry, PostProcessChain::SCENE_COLOR_FORMAT, depthFormat, msaaSamples, swapChainExtent, config.framesInFlight, generatedScene.get(), allocator);
+			recorder.recordCreateScene(config.scene, config.framesInFlight);
+		});
+		std::cout << "Stress scene: " << stressScene.getObjectCount() << " objects" << std::endl;
+		if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+			std::cout << "MSAA: " << msaaSamples << " samples, " << (memoryTypes.hasLazilyAllocated() ? "lazily allocated" : "device local") << " transient attachments" << std::endl;
+		}
+	}
 }
 
 // Creates our Vulkan instance
 void Application::createInstance() {
 	// Verify validation layer usage
-	if (enableValidationLayers && !checkValidationLayerSupport()) {
+	if (config.validation && !checkValidationLayerSupport()) {
 		throw std::runtime_error("Validation Layers were requested, but not available!");
 	}
 	// Application Info
@@ -139,8 +564,8 @@ void Application::createInstance() {
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 3, 249);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-	// 1.3.239.0 formatted Major, Minor, Patch, Variant
-	appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 3, 249);
+	// Variant, Major, Minor, Patch; at least 1.3
+	appInfo.apiVersion = config.apiVersion;
 
 	// Create Info
 	VkInstanceCreateInfo createInfo{};
@@ -155,7 +580,7 @@ void Application::createInstance() {
 	// Debug Messenger for Create and Destroy Instance
 	VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
 	// If validation layers are enabled, initialize them 
-	if (enableValidationLayers) {
+	if (config.validation) {
 		// Initialize validation layer amount and names
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
 		createInfo.ppEnabledLayerNames = validationLayers.data();
@@ -168,47 +593,155 @@ void Application::createInstance() {
 		createInfo.enabledLayerCount = 0;
 		createInfo.pNext = nullptr;
 	}
-	if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+	if (vkCreateInstance(&createInfo, allocator, &instance) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create instance!");
 	}
+	instanceTable.load(instance);
 
 }
 
 // Main Loop
 void Application::mainLoop() {
+	uint64_t frameNumber = 0;
+	uint64_t steadyStateAllocations = 0;
+	uint64_t allocatingFrames = 0;
+	auto lastMetricsExport = std::chrono::steady_clock::now();
+	// A run of configured length is summarised after its warmup, short runs after their first half
+	uint64_t summaryWarmupFrames = std::min<uint64_t>(ALLOCATION_WARMUP_FRAMES, config.frames / 2);
+	frameSampler.reset(config.frames > 0 ? static_cast<uint32_t>(config.frames - summaryWarmupFrames) : 0);
+	auto lastFrameStart = std::chrono::steady_clock::now();
+	uint64_t captureFrame = config.frames > 0 ? std::min<uint64_t>(CAPTURE_FRAME, config.frames - 1) : CAPTURE_FRAME;
 	// While the window is open
 	while (!glfwWindowShouldClose(window)) {
-		// Poll events
-		glfwPollEvents();
+		// Only attribute allocations to call sites once the loop has warmed up
+		if (frameNumber == ALLOCATION_WARMUP_FRAMES) {
+			AllocationTracker::resetCallSites();
+			AllocationTracker::setCallSiteTracking(true);
+		}
+		AllocationTracker::beginFrame();
+		flightRecorder.beginFrame(frameNumber);
+		if (frameNumber == captureFrame) {
+			recorder.beginFrame();
+		}
+		// Poll events, after posting any synthetic input due this frame
+		inputLatency.injectInput(window, frameNumber);
+		{
+			FlightRecorder::Scope scope(flightRecorder, "pollEvents");
+			glfwPollEvents();
+		}
+		if (hud.isVisible() && frameNumber % HUD_MEMORY_REFRESH_FRAMES == 0) {
+			hud.updateMemory(physicalDevice, memoryBudgetEnabled);
+		}
+		auto frameStart = std::chrono::steady_clock::now();
+		drawFrame();
+		if (frameNumber > summaryWarmupFrames) {
+			frameSampler.add(std::chrono::duration<double, std::milli>(frameStart - lastFrameStart).count(), frameCpuMilliseconds, profiler.getFrameTime());
+		}
+		lastFrameStart = frameStart;
+		recorder.endFrame();
+		// Heap budgets are refreshed with the export, they change slowly
+		auto now = std::chrono::steady_clock::now();
+		if (std::chrono::duration<double>(now - lastMetricsExport).count() >= MEMORY_METRICS_INTERVAL_SECONDS) {
+			FlightRecorder::Scope scope(flightRecorder, "exportMemoryMetrics");
+			memoryTelemetry.updateBudget(physicalDevice);
+			memoryTelemetry.exportMetrics(MEMORY_METRICS_PATH);
+			lastMetricsExport = now;
+		}
+		flightRecorder.endFrame(AllocationTracker::getFrameAllocationCount(), profiler.getFrameTime());
+		if (inputLatency.isFinished() || (config.frames > 0 && frameNumber + 1 >= config.frames)) {
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+		}
+		if (frameNumber == 0) {
+			timeline.markFirstFrame();
+			timeline.print(std::cout);
+		}
+
+		// Once warmed up, the frame loop should not touch the heap at all
+		uint64_t frameAllocations = AllocationTracker::getFrameAllocationCount();
+		if (frameNumber >= ALLOCATION_WARMUP_FRAMES && frameAllocations > 0) {
+			if (config.strictFrameAllocations) {
+				AllocationTracker::setCallSiteTracking(false);
+				std::cerr << frameAllocations << " heap allocations in frame " << frameNumber << ":" << std::endl;
+				AllocationTracker::printCallSites(std::cerr, 16);
+				frameAllocationFailed = true;
+				break;
+			}
+			steadyStateAllocations += frameAllocations;
+			allocatingFrames++;
+		}
+		frameNumber++;
+	}
+	AllocationTracker::setCallSiteTracking(false);
+	if (steadyStateAllocations > 0) {
+		std::cout << steadyStateAllocations << " heap allocations in " << allocatingFrames << " frames after warmup, by call site:" << std::endl;
+		AllocationTracker::printCallSites(std::cout, 16);
 	}
+	// Let in-flight frames finish before cleanup destroys what they use
+	deviceTable.vkDeviceWaitIdle(logicalDevice);
 }
 
 // Cleanup (Not RAII)
+// Also called for a run that failed part way, so everything not yet created is still null and skipped
 void Application::cleanup() {
 
-	// Destroy logical device
-	vkDestroyDevice(logicalDevice, nullptr);
-	// Destroy our debug messenger
-	if (enableValidationLayers) {
-		//DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+	// Destroy frame resources
+	if (logicalDevice != VK_NULL_HANDLE) {
+		// A failed run may still have frames in flight
+		vkDeviceWaitIdle(logicalDevice);
+		cleanupSwapChain();
+		hud.destroy(logicalDevice, allocator);
+		postProcess.destroy(logicalDevice, allocator);
+		profiler.writeJson(profilePath);
+		profiler.destroy(logicalDevice, allocator);
+		queueUtilization.print(std::cout);
+		queueUtilization.destroy(logicalDevice, allocator);
+		asyncCompute.destroy(logicalDevice, allocator);
+		inputLatency.print(std::cout);
+		inputLatency.writeJson(INPUT_LATENCY_JSON_PATH);
+		stressScene.destroy(logicalDevice, memoryTelemetry, allocator);
+		for (VkSemaphore semaphore : imageAvailableSemaphores) {
+			vkDestroySemaphore(logicalDevice, semaphore, allocator);
+		}
+		for (VkFence fence : inFlightFences) {
+			vkDestroyFence(logicalDevice, fence, allocator);
+		}
+		vkDestroyCommandPool(logicalDevice, commandPool, allocator);
+		vkDestroyDescriptorPool(logicalDevice, descriptorPool, allocator);
+		vkDestroyDescriptorSetLayout(logicalDevice, ringDescriptorSetLayout, allocator);
+		uniformRing.destroy(logicalDevice, memoryTelemetry, allocator);
+		// Anything still live here is a leak; peaks show what the run needed
+		memoryTelemetry.updateBudget(physicalDevice);
+		memoryTelemetry.exportMetrics(MEMORY_METRICS_PATH);
+		memoryTelemetry.print(std::cout);
+		// Destroy logical device
+		vkDestroyDevice(logicalDevice, allocator);
+	}
+	telemetryStream.destroy();
+	frameArena.destroy();
+	if (instance != VK_NULL_HANDLE) {
+		// Destroy our debug messenger
+		if (debugMessenger != VK_NULL_HANDLE) {
+			instanceTable.vkDestroyDebugUtilsMessengerEXT(instance, debugMessenger, allocator);
+		}
+		// Destroy the surface
+		vkDestroySurfaceKHR(instance, surface, allocator);
+		// Destroy the VkInstance
+		vkDestroyInstance(instance, allocator);
 	}
-	// Destroy the surface
-	vkDestroySurfaceKHR(instance, surface, nullptr);
-	// Destroy the VkInstance
-	vkDestroyInstance(instance, nullptr);
+	// Everything the driver allocated should have been returned by now
+	hostAllocator.printStatistics(std::cout);
 	// Destroy the window and terminate GLFW
-	glfwDestroyWindow(window);
+	if (window != nullptr) {
+		glfwDestroyWindow(window);
+	}
 	glfwTerminate();
 }
 
 // Check that validation layers exist
 bool Application::checkValidationLayerSupport() {
-	// Get the number of layers
-	uint32_t layerCount;
-	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
-	std::vector<VkLayerProperties> availableLayers(layerCount);
-	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
-	
+	// Get the available layers, only enumerated when the loader changed since the cached snapshot
+	const std::vector<VkLayerProperties>& availableLayers = capabilities.getInstanceLayers();
+
 	// Check that all of the validation layers exist in the list of available layers.
 	for (const char* layerName : validationLayers) {
 		bool layerFound = false;
@@ -227,22 +760,41 @@ bool Application::checkValidationLayerSupport() {
 
 bool Application::isDeviceSuitable(VkPhysicalDevice device)
 {
+	// Frames are recorded with dynamic rendering, which is core in Vulkan 1.3
+	if (capabilities.getDevice(device).apiVersion < VK_API_VERSION_1_3) {
+		return false;
+	}
 	// Find the queue families for a particular device. If they have values then return true
 	QueueFamilyIndices indices = findQueueFamilies(device);
-	return indices.graphicsFamily.has_value();
+	// The device must be able to present to our surface with at least one format and present mode
+	bool extensionsSupported = checkDeviceExtensionSupport(device);
+	bool swapChainAdequate = false;
+	if (extensionsSupported) {
+		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+	}
+	return indices.isComplete() && extensionsSupported && swapChainAdequate;
+}
+
+bool Application::checkDeviceExtensionSupport(VkPhysicalDevice device) {
+	const std::vector<VkExtensionProperties>& availableExtensions = capabilities.getDevice(device).extensions;
+	// Remove every extension the device has from the required set; anything left over is missing
+	std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+	for (const auto& extension : availableExtensions) {
+		requiredExtensions.erase(extension.extensionName);
+	}
+	return requiredExtensions.empty();
 }
 
 void Application::selectPhysicalDevice() {
-	// Find devices if possible.
-	uint32_t deviceCount = 0;
-	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+	// Find devices if possible. Handles can't be cached, but one call is enough in the common case.
+	std::vector<VkPhysicalDevice> devices = CapabilityCache::enumerate<VkPhysicalDevice>([this](uint32_t* count, VkPhysicalDevice* handles) {
+		return vkEnumeratePhysicalDevices(instance, count, handles);
+	});
 	// No devices found
-	if (deviceCount == 0) {
+	if (devices.empty()) {
 		throw std::runtime_error("Failed to find GPU with Vulkan support!");
 	}
-	// If devices exist, then allocate a vector of size deviceCount to hold their handles.
-	std::vector<VkPhysicalDevice> devices(deviceCount);
-	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
 	// Iterate through our devices and grab the first suitable device.
 	for (const VkPhysicalDevice& device : devices) {
@@ -255,7 +807,16 @@ void Application::selectPhysicalDevice() {
 	if (physicalDevice == VK_NULL_HANDLE) {
 		throw::std::runtime_error("Failed to find a suitable GPU!");
 	}
+	// Query everything allocation needs once, rather than on every allocation
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	memoryTypes.build(physicalDevice);
+	msaaSamples = chooseSampleCount(config.msaaSamples);
 
+	// Persist whatever had to be probed this launch
+	if (capabilities.isDirty()) {
+		capabilities.save(CAPABILITY_CACHE_PATH);
+		capabilities.writeJson(CAPABILITY_JSON_PATH);
+	}
 
 }
 
@@ -263,11 +824,15 @@ QueueFamilyIndices Application::findQueueFamilies(VkPhysicalDevice device)
 {
 	// Get available queue families supported from our physical device
 	QueueFamilyIndices indices;
-	uint32_t queueFamilyCount = 0;
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+	const std::vector<VkQueueFamilyProperties>& queueFamilies = capabilities.getDevice(device).queueFamilies;
 
+	// Compute without graphics is usually separate hardware queues, which is what lets async compute overlap rasterization
+	for (uint32_t family = 0; family < queueFamilies.size(); family++) {
+		if ((queueFamilies[family].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+			indices.computeFamily = family;
+			break;
+		}
+	}
 
 	// Assign an index to our queue families in the vector 
 	// We only want to assign an index if a queue family has VK_QUEUE_GRAPHICS_BIT set.
@@ -296,7 +861,7 @@ std::vector<const char*> Application::getRequiredExtensions() {
 	const char** glfwExtensions;
 	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
-	if (enableValidationLayers) {
+	if (config.validation) {
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
 	return extensions;
@@ -310,13 +875,13 @@ VKAPI_ATTR VkBool32 VKAPI_CALL Application::debugCallback(VkDebugUtilsMessageSev
 }
 
 void Application::setupDebugMessenger() {
-	if(!enableValidationLayers) {
+	if(!config.validation) {
 		return;
 	}
 	VkDebugUtilsMessengerCreateInfoEXT createInfo{};
 	populateDebugMessengerCreateInfo(createInfo);
 
-	if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+	if (instanceTable.vkCreateDebugUtilsMessengerEXT == nullptr || instanceTable.vkCreateDebugUtilsMessengerEXT(instance, &createInfo, allocator, &debugMessenger) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to set up debug messenger!");
 	}
 }
@@ -336,6 +901,9 @@ void Application::createLogicalDevice() {
 	// Construct a set that attempts to store all unique families. We only have a graphics and present family, and if they're the same then the set will only have one value.
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	if (config.asyncCompute && indices.computeFamily.has_value()) {
+		uniqueQueueFamilies.insert(indices.computeFamily.value());
+	}
 
 	// Specify queue priority for multithreading
 	float queuePriority = 1.0f;
@@ -352,15 +920,31 @@ void Application::createLogicalDevice() {
 
 	// Specify features of the used device
 	VkPhysicalDeviceFeatures deviceFeatures{};
+	pipelineStatisticsEnabled = config.pipelineStatistics && capabilities.getDevice(physicalDevice).features.pipelineStatisticsQuery == VK_TRUE;
+	deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsEnabled ? VK_TRUE : VK_FALSE;
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.dynamicRendering = VK_TRUE;
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &vulkan13Features;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
+	// Required extensions, plus the memory budget for the HUD when available
+	std::vector<const char*> enabledExtensions = deviceExtensions;
+	for (const auto& extension : capabilities.getDevice(physicalDevice).extensions) {
+		if (config.memoryBudget && strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+			enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			memoryBudgetEnabled = true;
+		}
+	}
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+
 	// Device validation layers for older Vulkan implementations
-	createInfo.enabledExtensionCount = 0;
-	if (enableValidationLayers) {
+	if (config.validation) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
 		createInfo.ppEnabledLayerNames = validationLayers.data();
 	}
@@ -369,17 +953,654 @@ void Application::createLogicalDevice() {
 	}
 
 	// Info set, bind our logical device to interface with our physical device.
-	if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &logicalDevice) != VK_SUCCESS) {
+	if (vkCreateDevice(physicalDevice, &createInfo, allocator, &logicalDevice) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create logical device!");
 	}
+	memoryTelemetry.init(memoryTypes.getProperties(), physicalDeviceProperties.limits, memoryBudgetEnabled);
+	// Resolve per-frame functions directly from the driver, bypassing the loader trampolines
+	deviceTable.load(logicalDevice, instanceTable);
 	// Retrieve queue handles for each queue family (we only have one queue family, queueFamilyCount = 0.
 	vkGetDeviceQueue(logicalDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(logicalDevice, indices.presentFamily.value(), 0, &presentQueue);
+	computeQueue = VK_NULL_HANDLE;
+	if (config.asyncCompute && indices.computeFamily.has_value()) {
+		vkGetDeviceQueue(logicalDevice, indices.computeFamily.value(), 0, &computeQueue);
+	}
 }
 
 void Application::createSurface()
 {
-	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+	if (glfwCreateWindowSurface(instance, window, allocator, &surface) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create window surface!");
 	}
-}
\ No newline at end of file
+}
+
+// Surface support is queried directly; it depends on the window and isn't part of the capability cache
+SwapChainSupportDetails Application::querySwapChainSupport(VkPhysicalDevice device) {
+	SwapChainSupportDetails details;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+	details.formats = CapabilityCache::enumerate<VkSurfaceFormatKHR>([this, device](uint32_t* count, VkSurfaceFormatKHR* formats) {
+		return vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, count, formats);
+	});
+	details.presentModes = CapabilityCache::enumerate<VkPresentModeKHR>([this, device](uint32_t* count, VkPresentModeKHR* presentModes) {
+		return vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, count, presentModes);
+	});
+	return details;
+}
+
+// Prefer 8-bit sRGB, otherwise take whatever the surface lists first
+VkSurfaceFormatKHR Application::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
+	for (const auto& availableFormat : availableFormats) {
+		if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+			return availableFormat;
+		}
+	}
+	return availableFormats[0];
+}
+
+// The configured mode (mailbox unless set) when the surface has it; FIFO is the only mode guaranteed to exist
+VkPresentModeKHR Application::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+	for (const auto& availablePresentMode : availablePresentModes) {
+		if (availablePresentMode == config.presentMode) {
+			return availablePresentMode;
+		}
+	}
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+VkExtent2D Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
+	// A current extent of UINT32_MAX means the surface takes its size from the swap chain
+	if (capabilities.currentExtent.width != UINT32_MAX) {
+		return capabilities.currentExtent;
+	}
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	VkExtent2D actualExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+	actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+	actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+	return actualExtent;
+}
+
+void Application::createSwapChain() {
+	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+	VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
+
+	// One more than the minimum so we don't wait on the driver to release an image; a max of 0 means no limit
+	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
+		imageCount = swapChainSupport.capabilities.maxImageCount;
+	}
+
+	VkSwapchainCreateInfoKHR createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = surface;
+	createInfo.minImageCount = imageCount;
+	createInfo.imageFormat = surfaceFormat.format;
+	createInfo.imageColorSpace = surfaceFormat.colorSpace;
+	createInfo.imageExtent = extent;
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+	// Images are shared between the graphics and present families if they differ
+	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	if (indices.graphicsFamily != indices.presentFamily) {
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else {
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+	createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	createInfo.presentMode = presentMode;
+	createInfo.clipped = VK_TRUE;
+	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	if (vkCreateSwapchainKHR(logicalDevice, &createInfo, allocator, &swapChain) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create swap chain!");
+	}
+
+	// The implementation may create more images than requested
+	vkGetSwapchainImagesKHR(logicalDevice, swapChain, &imageCount, nullptr);
+	swapChainImages.resize(imageCount);
+	vkGetSwapchainImagesKHR(logicalDevice, swapChain, &imageCount, swapChainImages.data());
+	swapChainImageFormat = surfaceFormat.format;
+	swapChainExtent = extent;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	renderFinishedSemaphores.resize(imageCount);
+	for (uint32_t i = 0; i < imageCount; i++) {
+		if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, allocator, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create render finished semaphore!");
+		}
+	}
+}
+
+void Application::createImageViews() {
+	swapChainImageViews.resize(swapChainImages.size());
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		VkImageViewCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		createInfo.image = swapChainImages[i];
+		createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		createInfo.format = swapChainImageFormat;
+		createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		createInfo.subresourceRange.baseMipLevel = 0;
+		createInfo.subresourceRange.levelCount = 1;
+		createInfo.subresourceRange.baseArrayLayer = 0;
+		createInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(logicalDevice, &createInfo, allocator, &swapChainImageViews[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create image views!");
+		}
+	}
+}
+
+void Application::cleanupSwapChain() {
+	for (VkSemaphore semaphore : renderFinishedSemaphores) {
+		vkDestroySemaphore(logicalDevice, semaphore, allocator);
+	}
+	for (VkImageView imageView : swapChainImageViews) {
+		vkDestroyImageView(logicalDevice, imageView, allocator);
+	}
+	vkDestroyImageView(logicalDevice, depthImageView, allocator);
+	vkDestroyImage(logicalDevice, depthImage, allocator);
+	memoryTelemetry.free(logicalDevice, depthImageMemory, allocator);
+	postProcess.destroyTargets(logicalDevice, memoryTelemetry, allocator);
+	vkDestroySwapchainKHR(logicalDevice, swapChain, allocator);
+}
+
+// The window can't be resized, but the surface still goes out of date when it is minimized or moved between displays
+void Application::recreateSwapChain() {
+	FlightRecorder::Scope scope(flightRecorder, "recreateSwapChain");
+	// A minimized window has no framebuffer; wait until it is restored
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	while (width == 0 || height == 0) {
+		glfwWaitEvents();
+		glfwGetFramebufferSize(window, &width, &height);
+	}
+	deviceTable.vkDeviceWaitIdle(logicalDevice);
+	VkFormat previousFormat = swapChainImageFormat;
+	cleanupSwapChain();
+	createSwapChain();
+	createImageViews();
+	createDepthResources();
+	// A display with another surface format hands back a swap chain the output pipelines weren't built for.
+	// This is the one place the frame loop compiles pipelines.
+	if (swapChainImageFormat != previousFormat) {
+		FlightRecorder::Scope compileScope(flightRecorder, "recreateOutputPipelines", HitchCause::PipelineCompile);
+		hud.destroy(logicalDevice, allocator);
+		postProcess.destroy(logicalDevice, allocator);
+		hud.create(logicalDevice, swapChainImageFormat, ringDescriptorSetLayout, allocator);
+		postProcess.create(logicalDevice, swapChainImageFormat, allocator);
+	}
+	{
+		// Clearing the new bloom target is a transfer submission waited on before the frame goes on
+		FlightRecorder::Scope targetScope(flightRecorder, "createPostProcessTargets", HitchCause::UploadStall);
+		postProcess.createTargets(logicalDevice, graphicsQueue, findQueueFamilies(physicalDevice).graphicsFamily.value(), memoryTypes, memoryTelemetry, swapChainExtent, msaaSamples, allocator);
+	}
+	recorder.recordCreateTargets(swapChainExtent, swapChainImageFormat, depthFormat, msaaSamples);
+	dynamicResolution.setOutputExtent(swapChainExtent);
+}
+
+// D32 is what depth testing wants; one of it and X8_D24 is always supported as a depth attachment
+VkFormat Application::findDepthFormat() {
+	const DeviceCapabilities& device = capabilities.getDevice(physicalDevice);
+	for (VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32 }) {
+		const VkFormatProperties* properties = device.findFormat(format);
+		if (properties != nullptr && (properties->optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)) {
+			return format;
+		}
+	}
+	throw std::runtime_error("Failed to find a supported depth format!");
+}
+
+// The largest power of two up to requested that the scene's color and depth attachments both support
+VkSampleCountFlagBits Application::chooseSampleCount(uint32_t requested) const {
+	const VkPhysicalDeviceLimits& limits = physicalDeviceProperties.limits;
+	VkSampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+	uint32_t samples = requested;
+	while (samples > 1 && !(supported & samples)) {
+		samples >>= 1;
+	}
+	if (samples != requested) {
+		std::cerr << requested << "x MSAA unsupported, using " << samples << "x" << std::endl;
+	}
+	return static_cast<VkSampleCountFlagBits>(samples);
+}
+
+void Application::createDepthResources() {
+	depthFormat = findDepthFormat();
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = depthFormat;
+	imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = msaaSamples;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(logicalDevice, &imageInfo, allocator, &depthImage) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create depth image!");
+	}
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(logicalDevice, depthImage, &memRequirements);
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryTypes.find(MemoryUsage::Transient, memRequirements.memoryTypeBits);
+	if (memoryTelemetry.allocate(logicalDevice, allocInfo, memRequirements.size, MemoryCategory::RenderTargets, allocator, &depthImageMemory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate depth image memory!");
+	}
+	vkBindImageMemory(logicalDevice, depthImage, depthImageMemory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = depthImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = depthFormat;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(logicalDevice, &viewInfo, allocator, &depthImageView) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create depth image view!");
+	}
+}
+
+void Application::createCommandPool() {
+	// Command buffers are re-recorded every frame, so allow resetting them individually
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = findQueueFamilies(physicalDevice).graphicsFamily.value();
+	if (vkCreateCommandPool(logicalDevice, &poolInfo, allocator, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create command pool!");
+	}
+}
+
+void Application::createCommandBuffers() {
+	commandBuffers.resize(config.framesInFlight);
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+	if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate command buffers!");
+	}
+}
+
+// Create the persistently mapped ring that per-draw uniform and storage data is written into
+void Application::createUniformRing() {
+	uniformRing.create(logicalDevice, physicalDeviceProperties.limits, memoryTypes, memoryTelemetry, UNIFORM_RING_BYTES_PER_FRAME, config.framesInFlight, allocator);
+}
+
+// Binding 0 is a dynamic uniform buffer and binding 1 a dynamic storage buffer, both pointing into the ring
+void Application::createDescriptorSetLayout() {
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, allocator, &ringDescriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor set layout!");
+	}
+}
+
+void Application::createDescriptorPool() {
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	poolSizes[1].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	poolInfo.maxSets = 1;
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor pool!");
+	}
+}
+
+// A single set covers every frame: the dynamic offset selects both the frame's region and the allocation within it
+void Application::createDescriptorSets() {
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &ringDescriptorSetLayout;
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &ringDescriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate descriptor sets!");
+	}
+
+	VkDescriptorBufferInfo bufferInfos[2]{};
+	bufferInfos[0].buffer = uniformRing.getBuffer();
+	bufferInfos[0].offset = 0;
+	bufferInfos[0].range = UniformRingBuffer::UNIFORM_BINDING_RANGE;
+	bufferInfos[1].buffer = uniformRing.getBuffer();
+	bufferInfos[1].offset = 0;
+	bufferInfos[1].range = UniformRingBuffer::STORAGE_BINDING_RANGE;
+
+	VkWriteDescriptorSet descriptorWrites[2]{};
+	for (uint32_t i = 0; i < 2; i++) {
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = ringDescriptorSet;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	vkUpdateDescriptorSets(logicalDevice, 2, descriptorWrites, 0, nullptr);
+}
+
+void Application::createSyncObjects() {
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	// Fences start signalled so the first wait on each frame slot returns immediately
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	imageAvailableSemaphores.resize(config.framesInFlight);
+	inFlightFences.resize(config.framesInFlight);
+	for (uint32_t i = 0; i < config.framesInFlight; i++) {
+		if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, allocator, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+			vkCreateFence(logicalDevice, &fenceInfo, allocator, &inFlightFences[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create frame synchronization objects!");
+		}
+	}
+}
+
+void Application::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (deviceTable.vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording command buffer!");
+	}
+	queueUtilization.beginFrame(currentFrame);
+	bool computeOnOtherQueue = asyncCompute.isAsync() && stressScene.isLoaded();
+	uint32_t submission = queueUtilization.beginSubmit(commandBuffer, graphicsUtilizationQueue);
+	profiler.beginFrame(commandBuffer, currentFrame);
+	frameDrawCount = 0;
+	frameTriangleCount = 0;
+	// The GPU time just read back for this slot picks this frame's resolution
+	VkExtent2D renderExtent = dynamicResolution.update(currentFrame, profiler.getFrameTime());
+	float jitter[2];
+	postProcess.getJitter(config.post, jitter);
+	stressScene.setJitter(jitter[0], jitter[1]);
+	recorder.recordSetJitter(jitter[0], jitter[1]);
+
+	// Light binning only needs the camera, so on a compute queue it runs while graphics is still busy with earlier work;
+	// graphics waits for it only at fragment shading
+	if (stressScene.isLoaded()) {
+		VkCommandBuffer computeCommandBuffer = asyncCompute.begin(currentFrame, commandBuffer);
+		uint32_t computeSubmission = UINT32_MAX;
+		if (computeOnOtherQueue) {
+			computeSubmission = queueUtilization.beginSubmit(computeCommandBuffer, computeUtilizationQueue);
+			queueUtilization.addWait(submission, computeSubmission);
+		}
+		if (!computeOnOtherQueue) {
+			profiler.beginPass(commandBuffer, "lightBinning");
+		}
+		stressScene.binLights(computeCommandBuffer, deviceTable, currentFrame, renderExtent);
+		recorder.recordBinLights(currentFrame, renderExtent);
+		if (computeOnOtherQueue) {
+			queueUtilization.endSubmit(computeCommandBuffer, computeSubmission);
+		}
+		else {
+			profiler.endPass(commandBuffer);
+		}
+		asyncCompute.end(currentFrame, computeCommandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+
+	// Scene color, motion and depth are cleared, but the previous frame may still be reading or testing against them
+	postProcess.beginScene(commandBuffer, deviceTable);
+	VkImageMemoryBarrier depthBarrier{};
+	depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+	depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.image = depthImage;
+	depthBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	depthBarrier.subresourceRange.levelCount = 1;
+	depthBarrier.subresourceRange.layerCount = 1;
+	VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	deviceTable.vkCmdPipelineBarrier(commandBuffer, depthStages, depthStages, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+	// With MSAA these are resolved into scene color and motion as the rendering ends
+	VkRenderingAttachmentInfo sceneAttachments[2];
+	postProcess.getSceneAttachments({ { 0.1f, 0.1f, 0.12f, 1.0f } }, sceneAttachments);
+	VkRenderingAttachmentInfo depthAttachment{};
+	depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachment.imageView = depthImageView;
+	depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea.extent = renderExtent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 2;
+	renderingInfo.pColorAttachments = sceneAttachments;
+	renderingInfo.pDepthAttachment = &depthAttachment;
+	deviceTable.vkCmdBeginRendering(commandBuffer, &renderingInfo);
+	profiler.beginPass(commandBuffer, "scene");
+	stressScene.draw(commandBuffer, deviceTable, currentFrame, renderExtent, frameDrawCount, frameTriangleCount);
+	profiler.endPass(commandBuffer);
+	deviceTable.vkCmdEndRendering(commandBuffer);
+	recorder.recordDrawScene(currentFrame, renderExtent);
+	recorder.recordPostProcess(renderExtent, config.post);
+
+	if (config.post.taa) {
+		profiler.beginPass(commandBuffer, "taa");
+		postProcess.endScene(commandBuffer, deviceTable, renderExtent, config.post);
+		profiler.endPass(commandBuffer);
+	}
+	else {
+		postProcess.endScene(commandBuffer, deviceTable, renderExtent, config.post);
+	}
+	profiler.beginPass(commandBuffer, "bloom");
+	postProcess.drawBloom(commandBuffer, deviceTable, config.post);
+	profiler.endPass(commandBuffer);
+
+	// The previous contents of the image are discarded, the composite covers every pixel
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = swapChainImages[imageIndex];
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+	deviceTable.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkRenderingAttachmentInfo colorAttachment{};
+	colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colorAttachment.imageView = swapChainImageViews[imageIndex];
+	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	VkRenderingInfo outputRenderingInfo{};
+	outputRenderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	outputRenderingInfo.renderArea.extent = swapChainExtent;
+	outputRenderingInfo.layerCount = 1;
+	outputRenderingInfo.colorAttachmentCount = 1;
+	outputRenderingInfo.pColorAttachments = &colorAttachment;
+
+	// The HUD is drawn in the same rendering as the composite, so showing it adds no extra load or store of the image
+	deviceTable.vkCmdBeginRendering(commandBuffer, &outputRenderingInfo);
+	profiler.beginPass(commandBuffer, "postProcess");
+	postProcess.draw(commandBuffer, deviceTable, swapChainExtent, config.post);
+	profiler.endPass(commandBuffer);
+	if (hud.isVisible()) {
+		profiler.beginPass(commandBuffer, "hud");
+		hud.setDrawStats(frameDrawCount, frameTriangleCount);
+		hud.setRenderExtent(renderExtent);
+		hud.draw(commandBuffer, deviceTable, uniformRing, ringDescriptorSet, frameArena, swapChainExtent, profiler, queueUtilization);
+		profiler.endPass(commandBuffer);
+	}
+	deviceTable.vkCmdEndRendering(commandBuffer);
+
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	deviceTable.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	profiler.endFrame(commandBuffer);
+	queueUtilization.endSubmit(commandBuffer, submission);
+	if (deviceTable.vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record command buffer!");
+	}
+}
+
+void Application::drawFrame() {
+	// Wait for the GPU to finish with this frame slot before reusing anything it owns
+	{
+		FlightRecorder::Scope scope(flightRecorder, "waitForFrameFence", HitchCause::FenceWait);
+		deviceTable.vkWaitForFences(logicalDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	}
+	// Before the fence is reset, so input carried by the frame that last used it is seen completing
+	inputLatency.pollCompletion(deviceTable, logicalDevice, inFlightFences.data());
+
+	uint32_t imageIndex;
+	VkResult result;
+	{
+		FlightRecorder::Scope scope(flightRecorder, "acquireNextImage", HitchCause::PresentWait);
+		result = deviceTable.vkAcquireNextImageKHR(logicalDevice, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	}
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		recreateSwapChain();
+		return;
+	}
+	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		throw std::runtime_error("Failed to acquire swap chain image!");
+	}
+	// Only reset the fence once work is certain to be submitted with it
+	deviceTable.vkResetFences(logicalDevice, 1, &inFlightFences[currentFrame]);
+
+	// Input received since the last frame is consumed by this one
+	inputLatency.markStage(InputLatencyHarness::Stage::Simulated);
+
+	// CPU frame time covers recording and submission, not the waits on the GPU and presentation engine
+	auto cpuStart = std::chrono::steady_clock::now();
+	uniformRing.beginFrame(currentFrame);
+	frameArena.beginFrame(currentFrame);
+	{
+		// Moving objects' positions are written straight into mapped memory the GPU reads
+		FlightRecorder::Scope scope(flightRecorder, "updateStressScene", HitchCause::UploadStall);
+		stressScene.update(currentFrame);
+	}
+	// The scene reads this frame's positions and recomputes the previous ones from the frame number
+	if (recorder.isCapturingFrame() && stressScene.isLoaded()) {
+		VkDeviceSize regionSize = stressScene.getMotionRegionSize();
+		recorder.recordUpload(CAPTURE_SCENE_MOTION_ID, regionSize * currentFrame, stressScene.getMotionRegion(currentFrame), regionSize);
+		recorder.recordSetSceneFrame(stressScene.getFrameNumber());
+	}
+	{
+		FlightRecorder::Scope scope(flightRecorder, "recordCommandBuffer");
+		deviceTable.vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+		recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+	}
+	inputLatency.markStage(InputLatencyHarness::Stage::Recorded);
+
+	recorder.recordSubmit();
+
+	// Wait for the image before writing color, and for async compute results where they are read; signal the image's
+	// semaphore for presentation
+	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 };
+	uint32_t waitCount = asyncCompute.takeWait(waitSemaphores[1], waitStages[1]) ? 2 : 1;
+	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[imageIndex] };
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+	{
+		FlightRecorder::Scope scope(flightRecorder, "queueSubmit");
+		if (deviceTable.vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to submit frame!");
+		}
+	}
+	inputLatency.markStage(InputLatencyHarness::Stage::Submitted, currentFrame);
+	double cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+	hud.addFrame(cpuMilliseconds, profiler.getFrameTime());
+	frameCpuMilliseconds = cpuMilliseconds;
+	{
+		TelemetryFrameRecord telemetry{};
+		telemetry.cpuMilliseconds = static_cast<float>(cpuMilliseconds);
+		telemetry.drawCount = frameDrawCount;
+		telemetry.triangleCount = frameTriangleCount;
+		memoryTelemetry.getLiveBytes(telemetry.deviceLocalBytes, telemetry.hostBytes);
+		telemetryStream.publish(telemetry, profiler);
+	}
+
+	VkPresentInfoKHR presentInfo{};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &swapChain;
+	presentInfo.pImageIndices = &imageIndex;
+	{
+		FlightRecorder::Scope scope(flightRecorder, "queuePresent", HitchCause::PresentWait);
+		result = deviceTable.vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
+	inputLatency.markStage(InputLatencyHarness::Stage::Presented);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+		recreateSwapChain();
+	}
+	else if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to present swap chain image!");
+	}
+	currentFrame = (currentFrame + 1) % config.framesInFlight;
+}
+
+// F1 toggles the performance HUD
+void Application::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	Application* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+	// Synthetic presses of the latency harness stop here
+	if (app->inputLatency.onKey(key, action)) {
+		return;
+	}
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+		app->hud.toggle();
+		if (app->hud.isVisible()) {
+			app->hud.updateMemory(app->physicalDevice, app->memoryBudgetEnabled);
+		}
+	}
+}
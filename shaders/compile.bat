@@ -0,0 +1,10 @@
+@echo off
+rem Compiles every shader in this directory to SPIR-V next to its source, e.g. hud.vert -> hud.vert.spv
+rem Run by the VulkanTest pre-build step; set GLSLC to override the compiler location.
+setlocal
+if "%GLSLC%"=="" set GLSLC=E:\VulkanSDK\Bin\glslc.exe
+cd /d "%~dp0"
+for %%f in (*.vert *.frag *.comp) do (
+	"%GLSLC%" --target-env=vulkan1.3 -O "%%f" -o "%%f.spv" || exit /b 1
+)
+endlocal
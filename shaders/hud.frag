@@ -0,0 +1,15 @@
+#version 450
+
+layout(location = 0) in vec2 inCell;
+layout(location = 1) flat in uint inGlyph;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	uvec2 cell = min(uvec2(inCell), uvec2(2u, 4u));
+	if ((inGlyph & (1u << (cell.y * 3u + cell.x))) == 0u) {
+		discard;
+	}
+	outColor = inColor;
+}
@@ -0,0 +1,38 @@
+#version 450
+
+// Six vertices per glyph or rectangle in one non-instanced draw; vertex i belongs to quad i / 6 of the HUD batch in
+// the uniform ring.
+// Positions and sizes are packed 16:16 in pixels with the origin at the top left of the framebuffer.
+struct HudQuad {
+	uint position;
+	uint size;
+	// 3x5 glyph bitmap, bit (row * 3 + column). Rectangles set all 15 bits.
+	uint glyph;
+	// RGBA8, unpacked with unpackUnorm4x8
+	uint color;
+};
+
+layout(set = 0, binding = 1) readonly buffer HudBatch {
+	HudQuad quads[];
+};
+
+layout(push_constant) uniform PushConstants {
+	vec2 inverseViewport;
+} push;
+
+layout(location = 0) out vec2 outCell;
+layout(location = 1) flat out uint outGlyph;
+layout(location = 2) out vec4 outColor;
+
+const vec2 corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+void main() {
+	HudQuad quad = quads[gl_VertexIndex / 6];
+	vec2 corner = corners[gl_VertexIndex % 6];
+	vec2 position = vec2(quad.position & 0xFFFFu, quad.position >> 16);
+	vec2 size = vec2(quad.size & 0xFFFFu, quad.size >> 16);
+	gl_Position = vec4((position + corner * size) * push.inverseViewport * 2.0 - 1.0, 0.0, 1.0);
+	outCell = corner * vec2(3.0, 5.0);
+	outGlyph = quad.glyph;
+	outColor = unpackUnorm4x8(quad.color);
+}
@@ -0,0 +1,84 @@
+#version 450
+
+// The fused composite of the post-processing chain (PostProcess.h): upscale, bloom, exposure, tonemapping, grading,
+// FXAA and vignette in one pass. FXAA works on the graded image, so its neighbour taps run the same chain on their own scene
+// and bloom samples rather than reading a stored intermediate.
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+layout(set = 0, binding = 1) uniform sampler2D bloomColor;
+
+layout(push_constant) uniform PushConstants {
+	vec2 uvScale;
+	vec2 jitter;
+	float exposure;
+	float bloomThreshold;
+	float bloomStrength;
+	float saturation;
+	float contrast;
+	float vignette;
+	uint fxaa;
+	uint historyValid;
+} push;
+
+layout(location = 0) in vec2 inUv;
+
+layout(location = 0) out vec4 outColor;
+
+const vec3 LUMA = vec3(0.2126, 0.7152, 0.0722);
+const float FXAA_REDUCE_MIN = 1.0 / 128.0;
+const float FXAA_REDUCE_MUL = 1.0 / 8.0;
+const float FXAA_SPAN_MAX = 8.0;
+
+// Narkowicz's fit of the ACES filmic curve
+vec3 tonemap(vec3 color) {
+	return clamp((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14), 0.0, 1.0);
+}
+
+// Linear output at uv in scene color; the sRGB swap chain encodes it. Taps are clamped half a texel inside the part
+// the scene covers, and the bloom, which covers the whole output, is stretched over that part.
+vec3 graded(vec2 uv) {
+	vec2 texelSize = 1.0 / vec2(textureSize(sceneColor, 0));
+	vec3 color = texture(sceneColor, min(uv, push.uvScale - 0.5 * texelSize)).rgb * push.exposure;
+	if (push.bloomStrength > 0.0) {
+		color += texture(bloomColor, uv / push.uvScale).rgb * push.bloomStrength;
+	}
+	color = tonemap(color);
+	color = mix(vec3(dot(color, LUMA)), color, push.saturation);
+	color = (color - 0.18) * push.contrast + 0.18;
+	return clamp(color, 0.0, 1.0);
+}
+
+// FXAA: the edge direction from the luma gradient of the four diagonal neighbours, then a blend along it.
+// Works in scene texels, before the upscale.
+vec3 antialiased(vec2 uv, vec3 center) {
+	vec2 texelSize = 1.0 / vec2(textureSize(sceneColor, 0));
+	float lumaNW = dot(graded(uv + vec2(-0.5, -0.5) * texelSize), LUMA);
+	float lumaNE = dot(graded(uv + vec2(0.5, -0.5) * texelSize), LUMA);
+	float lumaSW = dot(graded(uv + vec2(-0.5, 0.5) * texelSize), LUMA);
+	float lumaSE = dot(graded(uv + vec2(0.5, 0.5) * texelSize), LUMA);
+	float lumaM = dot(center, LUMA);
+	float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+	float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+	vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+	float directionReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * FXAA_REDUCE_MUL, FXAA_REDUCE_MIN);
+	float inverseMin = 1.0 / (min(abs(direction.x), abs(direction.y)) + directionReduce);
+	direction = clamp(direction * inverseMin, -FXAA_SPAN_MAX, FXAA_SPAN_MAX) * texelSize;
+
+	vec3 inner = 0.5 * (graded(uv + direction * (1.0 / 3.0 - 0.5)) + graded(uv + direction * (2.0 / 3.0 - 0.5)));
+	vec3 outer = inner * 0.5 + 0.25 * (graded(uv - direction * 0.5) + graded(uv + direction * 0.5));
+	// The wider blend overshoots when it crosses another edge; fall back to the narrow one
+	float lumaOuter = dot(outer, LUMA);
+	return lumaOuter < lumaMin || lumaOuter > lumaMax ? inner : outer;
+}
+
+void main() {
+	// Bilinear taps upscale from the rendered resolution
+	vec2 sceneUv = inUv * push.uvScale;
+	vec3 color = graded(sceneUv);
+	if (push.fxaa != 0u) {
+		color = antialiased(sceneUv, color);
+	}
+	vec2 fromCenter = inUv - 0.5;
+	color *= clamp(1.0 - push.vignette * dot(fromCenter, fromCenter) * 2.0, 0.0, 1.0);
+	outColor = vec4(color, 1.0);
+}
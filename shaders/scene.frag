@@ -0,0 +1,84 @@
+#version 450
+
+struct SceneMaterial {
+	vec4 baseColor;
+	float roughness;
+	float metallic;
+	vec2 padding;
+};
+
+struct SceneLight {
+	vec3 position;
+	float radius;
+	// rgb and intensity
+	vec4 color;
+};
+
+layout(set = 0, binding = 2) readonly buffer Materials {
+	SceneMaterial materials[];
+};
+
+layout(set = 0, binding = 3) readonly buffer Lights {
+	SceneLight lights[];
+};
+
+// Per tile light lists from shaders/lightbin.comp: a count, then MAX_LIGHTS_PER_TILE indices
+const uint LIGHT_TILE_SIZE = 16u;
+const uint MAX_LIGHTS_PER_TILE = 64u;
+layout(set = 0, binding = 4) readonly buffer LightBins {
+	uint bins[];
+};
+
+layout(push_constant) uniform PushConstants {
+	mat4 viewProjection;
+	vec3 cameraPosition;
+	uint lightCount;
+	uvec2 extent;
+	uvec2 binTiles;
+	vec2 jitter;
+	float previousSeconds;
+} push;
+
+layout(location = 0) in vec3 inWorldPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) flat in uint inMaterial;
+layout(location = 3) in vec4 inClipPosition;
+layout(location = 4) in vec4 inPreviousClipPosition;
+
+layout(location = 0) out vec4 outColor;
+// Texture coordinates moved since the previous frame
+layout(location = 1) out vec2 outMotion;
+
+// Blinn-Phong against the lights binned to this fragment's tile. Beyond the binned tiles (a render area larger than
+// the bins were created for) every light is shaded, which is slower but still correct.
+void main() {
+	SceneMaterial material = materials[inMaterial];
+	vec3 normal = normalize(inNormal);
+	vec3 viewDirection = normalize(push.cameraPosition - inWorldPosition);
+	float shininess = mix(256.0, 4.0, material.roughness);
+	vec3 specularColor = mix(vec3(0.04), material.baseColor.rgb, material.metallic);
+	vec3 diffuseColor = material.baseColor.rgb * (1.0 - material.metallic);
+
+	uvec2 tile = uvec2(gl_FragCoord.xy) / LIGHT_TILE_SIZE;
+	bool binned = all(lessThan(tile, push.binTiles));
+	uint binOffset = (tile.y * push.binTiles.x + tile.x) * (MAX_LIGHTS_PER_TILE + 1u);
+	uint lightCount = binned ? bins[binOffset] : push.lightCount;
+
+	vec3 color = diffuseColor * 0.05;
+	for (uint i = 0u; i < lightCount; i++) {
+		SceneLight light = lights[binned ? bins[binOffset + 1u + i] : i];
+		vec3 toLight = light.position - inWorldPosition;
+		float distance = length(toLight);
+		if (distance >= light.radius) {
+			continue;
+		}
+		vec3 lightDirection = toLight / distance;
+		float falloff = 1.0 - distance / light.radius;
+		float attenuation = falloff * falloff * light.color.a;
+		float diffuse = max(dot(normal, lightDirection), 0.0);
+		float specular = pow(max(dot(normal, normalize(lightDirection + viewDirection)), 0.0), shininess) * step(0.0, diffuse);
+		color += (diffuseColor * diffuse + specularColor * specular) * light.color.rgb * attenuation;
+	}
+	outColor = vec4(color, 1.0);
+	outMotion = (inClipPosition.xy / inClipPosition.w - inPreviousClipPosition.xy / inPreviousClipPosition.w) * 0.5;
+}
@@ -0,0 +1,71 @@
+#version 450
+
+// Stress scene objects, drawn instanced per mesh. gl_InstanceIndex includes the draw's firstInstance,
+// so it indexes the object buffer directly.
+struct SceneObject {
+	vec4 positionScale;
+	uint material;
+	// Index into the moving objects' positions, or 0xFFFFFFFF for static objects
+	uint motionIndex;
+	float phase;
+	float speed;
+};
+
+layout(set = 0, binding = 0) readonly buffer Objects {
+	SceneObject objects[];
+};
+
+// Rewritten by the CPU every frame
+layout(set = 0, binding = 1) readonly buffer Motion {
+	vec4 movedPositionScale[];
+};
+
+
+layout(push_constant) uniform PushConstants {
+	mat4 viewProjection;
+	vec3 cameraPosition;
+	uint lightCount;
+	uvec2 extent;
+	uvec2 binTiles;
+	vec2 jitter;
+	// Animation time of the previous frame
+	float previousSeconds;
+} push;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 outWorldPosition;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) flat out uint outMaterial;
+// Unjittered clip positions now and in the previous frame, for the motion vector
+layout(location = 3) out vec4 outClipPosition;
+layout(location = 4) out vec4 outPreviousClipPosition;
+
+// animateScene (SceneGenerator.cpp): moving objects orbit their position
+const float MOTION_AMPLITUDE = 1.0;
+const float TWO_PI = 6.28318531;
+
+vec4 animate(SceneObject object, float seconds) {
+	float angle = mod(seconds * object.speed + object.phase, TWO_PI);
+	vec3 offset = vec3(cos(angle), sin(2.0 * angle) * 0.5, sin(angle)) * MOTION_AMPLITUDE;
+	return vec4(object.positionScale.xyz + offset, object.positionScale.w);
+}
+
+void main() {
+	SceneObject object = objects[gl_InstanceIndex];
+	bool moving = object.motionIndex != 0xFFFFFFFFu;
+	vec4 positionScale = moving ? movedPositionScale[object.motionIndex] : object.positionScale;
+	// Recomputed rather than read back, since the previous frame's region may already hold a later frame
+	vec4 lastPositionScale = moving ? animate(object, push.previousSeconds) : object.positionScale;
+	vec3 worldPosition = positionScale.xyz + inPosition * positionScale.w;
+	vec3 previousPosition = lastPositionScale.xyz + inPosition * lastPositionScale.w;
+	// The camera is fixed, so one view projection serves both frames
+	outClipPosition = push.viewProjection * vec4(worldPosition, 1.0);
+	outPreviousClipPosition = push.viewProjection * vec4(previousPosition, 1.0);
+	gl_Position = outClipPosition;
+	gl_Position.xy += push.jitter * outClipPosition.w;
+	outWorldPosition = worldPosition;
+	outNormal = inNormal;
+	outMaterial = object.material;
+}